@@ -7,5 +7,6 @@ void handle_ability_progress(const void *msg);
 void handle_honeycomb_score(const void *msg);
 void handle_mumbo_score(const void *msg);
 void handle_note_save_data(const void *msg);
+void handle_state_digest_request(const void *msg);
 
 #endif
@@ -7,6 +7,7 @@
 RECOMP_IMPORT(".", int native_lib_test(void));
 RECOMP_IMPORT(".", void native_connect_to_server(char *host, char *username, char *lobby_name, char *password));
 RECOMP_IMPORT(".", void native_update_network(void));
+RECOMP_IMPORT(".", void native_set_network_threaded(int enabled));
 RECOMP_IMPORT(".", void native_disconnect_from_server(void));
 RECOMP_IMPORT(".", void native_sync_jiggy(int jiggy_enum_id, int collected_value));
 RECOMP_IMPORT(".", void native_poll_console_input(void));
@@ -16,8 +17,27 @@ RECOMP_IMPORT(".", void native_upload_initial_save_data(void));
 RECOMP_IMPORT(".", void native_send_file_progress_flags(void *data, int size));
 RECOMP_IMPORT(".", void native_send_honeycomb_collected(int world, int honeycomb_id, int xy_packed, int z));
 RECOMP_IMPORT(".", void native_send_mumbo_token_collected(int world, int token_id, int xy_packed, int z));
+RECOMP_IMPORT(".", void native_state_digest_begin(void));
+RECOMP_IMPORT(".", void native_state_digest_add_item(int category, int a, int b));
+RECOMP_IMPORT(".", void native_state_digest_add_bits(int category, int a, void *data, int size));
+RECOMP_IMPORT(".", void native_state_digest_add_blob(int category, void *data, int size));
+RECOMP_IMPORT(".", void native_state_digest_send(void));
 RECOMP_IMPORT(".", unsigned int GetClockMS(void));
 
+// category of a native_state_digest_* call, mirrors DigestCategory in the extlib
+typedef enum
+{
+    DIGEST_NOTES = 0,
+    DIGEST_FILE_PROGRESS = 1,
+    DIGEST_ABILITY_PROGRESS = 2,
+    DIGEST_HONEYCOMB_SCORE = 3,
+    DIGEST_MUMBO_SCORE = 4,
+    DIGEST_JIGGIES = 5,
+    DIGEST_HONEYCOMBS = 6,
+    DIGEST_MUMBO_TOKENS = 7,
+    DIGEST_OPENED_LEVELS = 8,
+} DigestCategory;
+
 int coop_network_is_safe_now(enum map_e map);
 
 void coop_try_connect_if_ready(enum map_e current_map, int frames_in_map);
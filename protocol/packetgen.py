@@ -0,0 +1,346 @@
+#!/usr/bin/env python3
+
+# Generates the packet layouts shared by the client and server from
+# packets.schema (see the top of that file for its format):
+#   src/extlib/lib_packet_schema.h  PacketLayout specialisations and views
+#   server/src/schema.rs            views and encoders
+# Run with --check to fail instead of writing when either is out of date.
+
+import re
+import sys
+from dataclasses import dataclass, field
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parent.parent
+SCHEMA = ROOT / "protocol" / "packets.schema"
+CPP_OUT = ROOT / "src" / "extlib" / "lib_packet_schema.h"
+RUST_OUT = ROOT / "server" / "src" / "schema.rs"
+
+# wire type -> (C++ wire type, Rust type, fixed size or None)
+WIRE_TYPES = {
+    "u8": ("uint8_t", "u8", 1),
+    "i8": ("int8_t", "i8", 1),
+    "u16": ("uint16_t", "u16", 2),
+    "i16": ("int16_t", "i16", 2),
+    "u32": ("uint32_t", "u32", 4),
+    "i32": ("int32_t", "i32", 4),
+    "u64": ("uint64_t", "u64", 8),
+    "f32": ("float", "f32", 4),
+    "var": ("VarU32", None, None),
+    "str": ("std::string", None, None),
+}
+
+# unsigned type LoadWire reads a field of each size as
+CPP_BITS = {1: "uint8_t", 2: "uint16_t", 4: "uint32_t", 8: "uint64_t"}
+
+RUST_LINE_WIDTH = 100
+
+
+@dataclass
+class Field:
+    member: str
+    wire: str
+
+
+@dataclass
+class Packet:
+    name: str
+    owner: str
+    order: str
+    comments: list = field(default_factory=list)
+    fields: list = field(default_factory=list)
+
+    @property
+    def fixed(self):
+        return all(WIRE_TYPES[f.wire][2] is not None for f in self.fields)
+
+    @property
+    def size(self):
+        return sum(WIRE_TYPES[f.wire][2] for f in self.fields)
+
+
+def fail(line_no, message):
+    sys.exit(f"{SCHEMA.name}:{line_no}: {message}")
+
+
+def parse(text):
+    packets = []
+    comments = []
+    current = None
+
+    for line_no, raw in enumerate(text.splitlines(), 1):
+        line = raw.rstrip()
+        stripped = line.strip()
+
+        if not stripped:
+            comments = []
+            continue
+
+        if stripped.startswith("#"):
+            comments.append(stripped[1:].strip())
+            continue
+
+        if not line[0].isspace():
+            match = re.fullmatch(r"packet\s+(\w+)\s*(?::\s*(\w+)\s+)?(big|little)", stripped)
+            if not match:
+                fail(line_no, f"expected 'packet <name> [: <owner>] <big|little>', got '{stripped}'")
+
+            name, owner, order = match.groups()
+            if any(p.name == name for p in packets):
+                fail(line_no, f"packet {name} is declared twice")
+
+            current = Packet(name, owner or name, order, comments)
+            packets.append(current)
+            comments = []
+            continue
+
+        if current is None:
+            fail(line_no, "field outside of a packet")
+
+        parts = stripped.split()
+        if len(parts) != 2 or parts[1] not in WIRE_TYPES:
+            fail(line_no, f"expected '<member> <{'|'.join(WIRE_TYPES)}>', got '{stripped}'")
+        current.fields.append(Field(parts[0], parts[1]))
+        comments = []
+
+    for packet in packets:
+        if not packet.fields:
+            sys.exit(f"{SCHEMA.name}: packet {packet.name} has no fields")
+
+    return packets
+
+
+def snake_case(name):
+    return re.sub(r"(?<=[a-z0-9])(?=[A-Z])", "_", name).lower()
+
+
+# --------------------------------------------------------------------------- #
+# C++
+# --------------------------------------------------------------------------- #
+
+def cpp_order(packet):
+    return "WireOrder::Big" if packet.order == "big" else "WireOrder::Little"
+
+
+def cpp_layout(packet):
+    head = f"struct PacketLayout<{packet.name}> : Layout<"
+    indent = " " * len(head)
+    args = [cpp_order(packet)]
+    for f in packet.fields:
+        args.append(f"Field<&{packet.owner}::{f.member}, {WIRE_TYPES[f.wire][0]}>")
+
+    lines = [f"// {c}" if c else "//" for c in packet.comments]
+    lines.append("template <>")
+    lines.append(head + (",\n" + indent).join(args) + ">")
+    lines.append("{")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def cpp_view(packet):
+    lines = [
+        f"class {packet.name}View",
+        "{",
+        "public:",
+        f"    static constexpr size_t SIZE = {packet.size};",
+        "",
+        "    static bool Fits(size_t len) { return len >= SIZE; }",
+        "",
+        f"    explicit {packet.name}View(const uint8_t *data) : m_data(data) {{}}",
+        "",
+    ]
+
+    offset = 0
+    for f in packet.fields:
+        wire, _, size = WIRE_TYPES[f.wire]
+        load = f"LoadWire<{cpp_order(packet)}, {CPP_BITS[size]}>(m_data + {offset})"
+        if wire == "float":
+            value = f"std::bit_cast<float>({load})"
+        elif wire == CPP_BITS[size]:
+            value = load
+        else:
+            value = f"static_cast<{wire}>({load})"
+        lines.append(f"    {wire} {f.member}() const {{ return {value}; }}")
+        offset += size
+
+    lines += [
+        "",
+        "private:",
+        "    const uint8_t *m_data;",
+        "};",
+        "",
+        f"static_assert({packet.name}View::SIZE == WIRE_SIZE<{packet.name}>);",
+    ]
+    return "\n".join(lines)
+
+
+def generate_cpp(packets):
+    out = [
+        "#ifndef LIB_PACKET_SCHEMA_H",
+        "#define LIB_PACKET_SCHEMA_H",
+        "",
+        "// =========================================================================== //",
+        "// Generated by protocol/packetgen.py from protocol/packets.schema; edit that",
+        "// and rerun the generator instead of changing this file.",
+        "//",
+        "// PacketLayouts for every packet in the schema, and for those made of fixed-size",
+        "// fields a <Packet>View that reads each field straight out of the receive buffer.",
+        "// Check Fits(len) before making one. Included at the bottom of lib_packet_codec.h.",
+        "// =========================================================================== //",
+        "",
+    ]
+
+    for packet in packets:
+        out.append(cpp_layout(packet))
+        out.append("")
+
+    out.append("// =========================================================================== //")
+    out.append("// Views")
+    out.append("// =========================================================================== //")
+    out.append("")
+
+    for packet in packets:
+        if packet.fixed:
+            out.append(cpp_view(packet))
+            out.append("")
+
+    out.append("#endif")
+    return "\n".join(out) + "\n"
+
+
+# --------------------------------------------------------------------------- #
+# Rust
+# --------------------------------------------------------------------------- #
+
+def rust_bytes(count, offset):
+    return "[" + ", ".join(f"self.data[{offset + i}]" for i in range(count)) + "]"
+
+
+def rust_view(packet):
+    view = f"{packet.name}View"
+    endian = "be" if packet.order == "big" else "le"
+    lines = [f"/** {c} */" for c in packet.comments]
+    lines += [
+        f"/** {packet.name}, read in place. */",
+        "#[derive(Debug, Clone, Copy)]",
+        f"pub struct {view}<'a> {{",
+        "    data: &'a [u8],",
+        "}",
+        "",
+        f"impl<'a> {view}<'a> {{",
+        f"    pub const SIZE: usize = {packet.size};",
+        "",
+        "    pub fn new(data: &'a [u8]) -> Result<Self> {",
+        "        if data.len() < Self::SIZE {",
+        "            return Err(anyhow!(",
+        f"                \"Invalid {packet.name}: expected {{}} bytes, got {{}}\",",
+        "                Self::SIZE,",
+        "                data.len()",
+        "            ));",
+        "        }",
+        "        Ok(Self { data })",
+        "    }",
+    ]
+
+    offset = 0
+    for f in packet.fields:
+        _, rust, size = WIRE_TYPES[f.wire]
+        if rust == "u8":
+            value = f"self.data[{offset}]"
+        elif rust == "i8":
+            value = f"self.data[{offset}] as i8"
+        else:
+            value = f"{rust}::from_{endian}_bytes({rust_bytes(size, offset)})"
+
+        lines.append("")
+        lines.append(f"    pub fn {snake_case(f.member)}(&self) -> {rust} {{")
+        if len(f"        {value}") > RUST_LINE_WIDTH:
+            lines.append(f"        {rust}::from_{endian}_bytes([")
+            for i in range(size):
+                lines.append(f"            self.data[{offset + i}],")
+            lines.append("        ])")
+        else:
+            lines.append(f"        {value}")
+        lines.append("    }")
+        offset += size
+
+    lines.append("}")
+    return "\n".join(lines)
+
+
+def rust_encoder(packet):
+    endian = "be" if packet.order == "big" else "le"
+    name = f"encode_{snake_case(packet.name)}"
+    params = ["buf: &mut Vec<u8>"] + [
+        f"{snake_case(f.member)}: {WIRE_TYPES[f.wire][1]}" for f in packet.fields
+    ]
+
+    lines = [f"/** Appends a {packet.name} in its wire layout. */"]
+    if len(params) > 7:
+        lines.append("#[allow(clippy::too_many_arguments)]")
+
+    one_line = f"pub fn {name}({', '.join(params)}) {{"
+    if len(one_line) <= RUST_LINE_WIDTH:
+        lines.append(one_line)
+    else:
+        lines.append(f"pub fn {name}(")
+        lines += [f"    {p}," for p in params]
+        lines.append(") {")
+
+    for f in packet.fields:
+        member = snake_case(f.member)
+        if WIRE_TYPES[f.wire][1] == "u8":
+            lines.append(f"    buf.push({member});")
+        else:
+            lines.append(f"    buf.extend_from_slice(&{member}.to_{endian}_bytes());")
+
+    lines.append("}")
+    return "\n".join(lines)
+
+
+def generate_rust(packets):
+    out = [
+        "// Generated by protocol/packetgen.py from protocol/packets.schema; edit that",
+        "// and rerun the generator instead of changing this file.",
+        "//",
+        "// For each packet made of fixed-size fields, a <Packet>View reading the fields",
+        "// straight out of the payload and an encode_<packet> appending one to a buffer.",
+        "",
+        "#![allow(dead_code)]",
+        "",
+        "use anyhow::{anyhow, Result};",
+    ]
+
+    for packet in packets:
+        if packet.fixed:
+            out.append("")
+            out.append(rust_view(packet))
+            out.append("")
+            out.append(rust_encoder(packet))
+
+    return "\n".join(out) + "\n"
+
+
+def main():
+    check = "--check" in sys.argv[1:]
+    packets = parse(SCHEMA.read_text(encoding="utf-8"))
+
+    stale = []
+    for path, text in ((CPP_OUT, generate_cpp(packets)), (RUST_OUT, generate_rust(packets))):
+        current = path.read_text(encoding="utf-8") if path.exists() else None
+        if current == text:
+            continue
+
+        stale.append(path.relative_to(ROOT))
+        if not check:
+            path.write_text(text, encoding="utf-8", newline="\n")
+
+    if check and stale:
+        sys.exit("out of date, run protocol/packetgen.py: " + ", ".join(str(p) for p in stale))
+
+    for path in stale:
+        print(f"wrote {path}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,123 @@
+//! compress.rs on the full-sync samples in protocol/full_sync_samples.txt:
+//! bytes on the wire with and without the Compressed wrapper, and the time to
+//! compress and decompress a whole sync. The client's side of the same
+//! measurement is src/extlib/bench/bench_bulk_compress.cpp.
+//!
+//!   cargo bench --bench compress
+
+#![allow(dead_code)]
+
+#[path = "../src/compress.rs"]
+mod compress;
+#[path = "../src/packets.rs"]
+mod packets;
+#[path = "../src/protocol.rs"]
+mod protocol;
+#[path = "../src/schema.rs"]
+mod schema;
+
+use std::hint::black_box;
+use std::time::Instant;
+
+use protocol::PacketType;
+
+const SAMPLES: &str = include_str!("../../protocol/full_sync_samples.txt");
+const ROUNDS: u32 = 20000;
+
+struct Sample {
+    name: String,
+    messages: Vec<(PacketType, Vec<u8>)>,
+}
+
+/** Samples in file order, one per name. */
+fn load_samples() -> Vec<Sample> {
+    let mut samples: Vec<Sample> = Vec::new();
+
+    for line in SAMPLES.lines() {
+        let fields: Vec<&str> = line.split_whitespace().collect();
+        if line.starts_with('#') || fields.len() != 3 {
+            continue;
+        }
+
+        let packet_type = PacketType::from(fields[1].parse::<u8>().expect("bad packet type"));
+        let payload: Vec<u8> = (0..fields[2].len() / 2)
+            .map(|i| u8::from_str_radix(&fields[2][i * 2..i * 2 + 2], 16).expect("bad hex"))
+            .collect();
+
+        match samples.iter_mut().find(|s| s.name == fields[0]) {
+            Some(sample) => sample.messages.push((packet_type, payload)),
+            None => samples.push(Sample {
+                name: fields[0].to_string(),
+                messages: vec![(packet_type, payload)],
+            }),
+        }
+    }
+    samples
+}
+
+/** Best of five passes of f, which does ROUNDS syncs, in ns per sync. */
+fn ns_per_sync(mut f: impl FnMut()) -> f64 {
+    (0..5)
+        .map(|_| {
+            let start = Instant::now();
+            f();
+            start.elapsed().as_nanos() as f64 / ROUNDS as f64
+        })
+        .fold(f64::MAX, f64::min)
+}
+
+fn main() {
+    println!(
+        "{:<10} {:>5} {:>8} {:>8} {:>6} {:>10} {:>10}",
+        "sample", "msgs", "raw B", "wire B", "wire%", "pack ns", "unpack ns"
+    );
+
+    for sample in load_samples() {
+        let mut raw = 0;
+        let mut wire = 0;
+        let mut compressed = Vec::new();
+
+        for (packet_type, payload) in &sample.messages {
+            raw += payload.len();
+            match compress::compress_message(*packet_type, payload) {
+                Some(packed) => {
+                    let (back_type, back) =
+                        compress::decompress_message(&packed).expect("doesn't round trip");
+                    assert!(
+                        back_type == *packet_type && back == *payload,
+                        "doesn't round trip"
+                    );
+                    wire += packed.len();
+                    compressed.push(packed);
+                }
+                None => wire += payload.len(),
+            }
+        }
+
+        let pack_ns = ns_per_sync(|| {
+            for _ in 0..ROUNDS {
+                for (packet_type, payload) in &sample.messages {
+                    black_box(compress::compress_message(*packet_type, black_box(payload)));
+                }
+            }
+        });
+        let unpack_ns = ns_per_sync(|| {
+            for _ in 0..ROUNDS {
+                for packed in &compressed {
+                    black_box(compress::decompress_message(black_box(packed)).ok());
+                }
+            }
+        });
+
+        println!(
+            "{:<10} {:>5} {:>8} {:>8} {:>5.0}% {:>10.0} {:>10.0}",
+            sample.name,
+            sample.messages.len(),
+            raw,
+            wire,
+            100.0 * wire as f64 / raw as f64,
+            pack_ns,
+            unpack_ns
+        );
+    }
+}
@@ -0,0 +1,123 @@
+use anyhow::{anyhow, Result};
+
+use crate::packets::{read_var_u32, write_var_u32};
+use crate::protocol::{PacketType, FRAGMENT_MAX_MESSAGE_SIZE};
+
+/**
+ * Run-length coding for bulk lobby state, the same as the client's
+ * lib_bulk_compress.h. A control byte c, then c + 1 literal bytes when
+ * c < 0x80, or one byte repeated c - 0x80 + 3 times.
+ */
+const PACK_BITS_MIN_RUN: usize = 3;
+const PACK_BITS_MAX_RUN: usize = 0x7F + PACK_BITS_MIN_RUN;
+const PACK_BITS_MAX_LITERALS: usize = 0x80;
+
+pub fn pack_bits(src: &[u8], out: &mut Vec<u8>) {
+    let mut i = 0;
+    while i < src.len() {
+        let mut run = 1;
+        while i + run < src.len() && run < PACK_BITS_MAX_RUN && src[i + run] == src[i] {
+            run += 1;
+        }
+
+        if run >= PACK_BITS_MIN_RUN {
+            out.push((0x80 + run - PACK_BITS_MIN_RUN) as u8);
+            out.push(src[i]);
+            i += run;
+            continue;
+        }
+
+        // literals up to the next run worth coding
+        let start = i;
+        while i < src.len() && i - start < PACK_BITS_MAX_LITERALS {
+            if i + 2 < src.len() && src[i] == src[i + 1] && src[i] == src[i + 2] {
+                break;
+            }
+            i += 1;
+        }
+
+        out.push((i - start - 1) as u8);
+        out.extend_from_slice(&src[start..i]);
+    }
+}
+
+/** Unpacks src, which has to come out exactly raw_size bytes. */
+pub fn unpack_bits(src: &[u8], raw_size: usize) -> Result<Vec<u8>> {
+    let mut out = Vec::with_capacity(raw_size);
+    let mut i = 0;
+
+    while i < src.len() {
+        let control = src[i] as usize;
+        i += 1;
+
+        if control < 0x80 {
+            let count = control + 1;
+            if count > src.len() - i || count > raw_size - out.len() {
+                return Err(anyhow!("Packed literals run past the end"));
+            }
+            out.extend_from_slice(&src[i..i + count]);
+            i += count;
+        } else {
+            let count = control - 0x80 + PACK_BITS_MIN_RUN;
+            if i == src.len() || count > raw_size - out.len() {
+                return Err(anyhow!("Packed run runs past the end"));
+            }
+            out.resize(out.len() + count, src[i]);
+            i += 1;
+        }
+    }
+
+    if out.len() != raw_size {
+        return Err(anyhow!(
+            "Packed data came out {} bytes, expected {}",
+            out.len(),
+            raw_size
+        ));
+    }
+    Ok(out)
+}
+
+/**
+ * The Compressed payload [u8 inner type][varint size][packed payload]
+ * standing for this message, if it's bulk state and packing makes it smaller.
+ */
+pub fn compress_message(packet_type: PacketType, payload: &[u8]) -> Option<Vec<u8>> {
+    if !packet_type.is_compressible() {
+        return None;
+    }
+
+    let mut packed = Vec::with_capacity(payload.len());
+    packed.push(packet_type as u8);
+    write_var_u32(&mut packed, payload.len() as u32);
+    pack_bits(payload, &mut packed);
+
+    if packed.len() < payload.len() {
+        Some(packed)
+    } else {
+        None
+    }
+}
+
+/** The message a Compressed payload stands for. */
+pub fn decompress_message(payload: &[u8]) -> Result<(PacketType, Vec<u8>)> {
+    let inner_type = PacketType::from(
+        *payload
+            .first()
+            .ok_or_else(|| anyhow!("Empty Compressed packet"))?,
+    );
+    if !inner_type.is_compressible() {
+        return Err(anyhow!("{:?} can't be compressed", inner_type));
+    }
+
+    let mut offset = 1;
+    let raw_size = read_var_u32(payload, &mut offset)? as usize;
+    if raw_size > FRAGMENT_MAX_MESSAGE_SIZE {
+        return Err(anyhow!(
+            "Compressed {:?} is {} bytes unpacked",
+            inner_type,
+            raw_size
+        ));
+    }
+
+    Ok((inner_type, unpack_bits(&payload[offset..], raw_size)?))
+}
@@ -17,6 +17,12 @@ pub struct ServerConfig {
     pub lobby_idle_timeout_seconds: u64,
     pub enable_persistence: bool,
     pub persistence_dir: String,
+    #[serde(default = "default_session_resume_seconds")]
+    pub session_resume_seconds: u64,
+}
+
+fn default_session_resume_seconds() -> u64 {
+    300
 }
 
 #[derive(Debug, Clone, Serialize, Deserialize)]
@@ -37,6 +43,7 @@ impl Default for Config {
                 lobby_idle_timeout_seconds: 300,
                 enable_persistence: true,
                 persistence_dir: "./lobbies".to_string(),
+                session_resume_seconds: default_session_resume_seconds(),
             },
             logging: LoggingConfig {
                 level:"info".to_string(),
@@ -1,7 +1,15 @@
 ﻿use serde::{Deserialize, Serialize};
-use std::collections::HashMap;
+use std::collections::{HashMap, HashSet};
 use std::time::Instant;
 
+use crate::protocol::{
+    state_digest_bucket, state_digest_item, PacketType, STATE_DIGEST_ABILITY_PROGRESS,
+    STATE_DIGEST_BUCKETS, STATE_DIGEST_CATEGORIES, STATE_DIGEST_FILE_PROGRESS,
+    STATE_DIGEST_HONEYCOMBS, STATE_DIGEST_HONEYCOMB_SCORE, STATE_DIGEST_JIGGIES,
+    STATE_DIGEST_MUMBO_SCORE, STATE_DIGEST_MUMBO_TOKENS, STATE_DIGEST_NOTES,
+    STATE_DIGEST_OPENED_LEVELS,
+};
+
 // position value tolerance
 const POS_TOLERANCE: i16 = 10;
 
@@ -588,4 +596,173 @@ impl Lobby {
 
         changed
     }
+
+    /**
+     * Tracks the levels whose open flags (0x31 for MM to 0x39 for CCW) are set
+     * in a file progress blob. Returns the world ids that weren't open yet.
+     */
+    pub fn open_levels_from_file_progress(&mut self, flags: &[u8]) -> Vec<i32> {
+        const FILEPROG_31_MM_OPEN: usize = 0x31;
+        const FILEPROG_39_CCW_OPEN: usize = 0x39;
+        const JIGSAW_COSTS: [i32; 9] = [1, 2, 5, 7, 8, 9, 10, 12, 15];
+
+        let mut opened = Vec::new();
+
+        for flag_index in FILEPROG_31_MM_OPEN..=FILEPROG_39_CCW_OPEN {
+            let byte_index = flag_index / 8;
+            let bit_index = flag_index % 8;
+
+            if byte_index < flags.len() && (flags[byte_index] & (1 << bit_index)) != 0 {
+                let world_id = (flag_index - FILEPROG_31_MM_OPEN + 1) as i32;
+                let jiggy_cost = JIGSAW_COSTS[(world_id - 1) as usize];
+
+                if self.add_opened_level(world_id, jiggy_cost) {
+                    opened.push(world_id);
+                }
+            }
+        }
+
+        opened
+    }
+
+    /**
+     * Items of one digest category, each once, as a client that has all of
+     * it would record them (see state_digest_item). Progress blobs count
+     * their set bits as (0, bit), note save data as (level, bit).
+     */
+    pub fn state_digest_items(&self, category: usize) -> Vec<(i32, i32)> {
+        fn bits(major: i32, blob: &[u8]) -> impl Iterator<Item = (i32, i32)> + '_ {
+            blob.iter()
+                .enumerate()
+                .flat_map(move |(byte_index, &byte)| {
+                    (0..8)
+                        .filter(move |bit| byte & (1 << bit) != 0)
+                        .map(move |bit| (major, (byte_index * 8 + bit) as i32))
+                })
+        }
+
+        let flags = &self.save_flags;
+        let items: Vec<(i32, i32)> = match category {
+            STATE_DIGEST_NOTES => flags
+                .note_save_data
+                .iter()
+                .enumerate()
+                .flat_map(|(level, data)| bits(level as i32, data))
+                .collect(),
+            STATE_DIGEST_FILE_PROGRESS => bits(0, &flags.file_progress_flags).collect(),
+            STATE_DIGEST_ABILITY_PROGRESS => bits(0, &flags.ability_progress).collect(),
+            STATE_DIGEST_HONEYCOMB_SCORE => bits(0, &flags.honeycomb_score).collect(),
+            STATE_DIGEST_MUMBO_SCORE => bits(0, &flags.mumbo_score).collect(),
+            STATE_DIGEST_JIGGIES => self
+                .collected_jiggies
+                .iter()
+                .map(|j| (j.level_id, j.jiggy_id))
+                .collect(),
+            STATE_DIGEST_HONEYCOMBS => self
+                .collected_honeycombs
+                .iter()
+                .map(|h| (h.map_id, h.honeycomb_id))
+                .collect(),
+            STATE_DIGEST_MUMBO_TOKENS => self
+                .collected_mumbo_tokens
+                .iter()
+                .map(|t| (t.map_id, t.token_id))
+                .collect(),
+            STATE_DIGEST_OPENED_LEVELS => {
+                self.opened_levels.iter().map(|l| (l.world_id, 0)).collect()
+            }
+            _ => Vec::new(),
+        };
+
+        let mut seen = HashSet::new();
+        items
+            .into_iter()
+            .filter(|item| seen.insert(*item))
+            .collect()
+    }
+
+    /** Digest of each category: the wrapping sum of its items' hashes. */
+    pub fn state_digests(&self) -> [u64; STATE_DIGEST_CATEGORIES] {
+        let mut digests = [0u64; STATE_DIGEST_CATEGORIES];
+        for (category, digest) in digests.iter_mut().enumerate() {
+            *digest = self
+                .state_digest_buckets(category)
+                .iter()
+                .fold(0u64, |sum, &bucket| sum.wrapping_add(bucket));
+        }
+        digests
+    }
+
+    /** One category's digest split by state_digest_bucket. */
+    pub fn state_digest_buckets(&self, category: usize) -> [u64; STATE_DIGEST_BUCKETS] {
+        let mut buckets = [0u64; STATE_DIGEST_BUCKETS];
+        for (a, b) in self.state_digest_items(category) {
+            let bucket = &mut buckets[state_digest_bucket(a)];
+            *bucket = bucket.wrapping_add(state_digest_item(a, b));
+        }
+        buckets
+    }
+
+    /** The progress blob a FileProgressFlags..MumboScore packet carries. */
+    pub fn progress_blob(&self, blob_type: PacketType) -> Option<&[u8]> {
+        match blob_type {
+            PacketType::FileProgressFlags => Some(&self.save_flags.file_progress_flags),
+            PacketType::AbilityProgress => Some(&self.save_flags.ability_progress),
+            PacketType::HoneycombScore => Some(&self.save_flags.honeycomb_score),
+            PacketType::MumboScore => Some(&self.save_flags.mumbo_score),
+            _ => None,
+        }
+    }
+
+    /**
+     * Sets bits from a ProgressBits packet in the progress blob it names,
+     * doing the same bookkeeping as the full blob would. Returns the bits that
+     * weren't set before, which is all the other players need to hear about.
+     */
+    pub fn set_progress_bits(&mut self, blob_type: PacketType, bits: &[u32]) -> Vec<u32> {
+        let blob = match self.progress_blob(blob_type) {
+            Some(blob) => blob,
+            None => return Vec::new(),
+        };
+
+        let fresh: Vec<u32> = bits
+            .iter()
+            .copied()
+            .filter(|&bit| {
+                let byte_index = (bit / 8) as usize;
+                byte_index < blob.len() && (blob[byte_index] & (1 << (bit % 8))) == 0
+            })
+            .collect();
+
+        if fresh.is_empty() {
+            return fresh;
+        }
+
+        let mut sparse = vec![0u8; blob.len()];
+        for &bit in &fresh {
+            sparse[(bit / 8) as usize] |= 1 << (bit % 8);
+        }
+
+        match blob_type {
+            PacketType::FileProgressFlags => {
+                self.update_file_progress_flags(&sparse);
+                self.open_levels_from_file_progress(&sparse);
+                self.has_initial_save_data = true;
+            }
+            PacketType::AbilityProgress => {
+                self.update_ability_progress(&sparse);
+            }
+            PacketType::HoneycombScore => {
+                self.update_honeycomb_score(&sparse);
+                self.has_initial_save_data = true;
+            }
+            PacketType::MumboScore => {
+                self.update_mumbo_score(&sparse);
+                self.has_initial_save_data = true;
+            }
+            _ => {}
+        }
+
+        fresh
+    }
 }
@@ -1,9 +1,12 @@
+mod compress;
 mod config;
 mod lobby;
 mod network;
 mod packets;
 mod player;
 mod protocol;
+mod schema;
+mod session;
 mod state;
 
 use anyhow::Result;
@@ -7,19 +7,51 @@ use tokio::net::UdpSocket;
 use tokio::time;
 use tracing::{debug, error, info, warn};
 
+use crate::compress::{compress_message, decompress_message};
 use crate::config::Config;
+use crate::lobby::Lobby;
 use crate::packets::*;
-use crate::protocol::PacketType;
+use crate::protocol::{
+    state_digest_bucket, state_digest_is_bucketed, PacketType, BUNDLE_MTU,
+    BUNDLE_RECORD_HEADER_SIZE, CAPABILITY_COMPACT_COLLECTIBLES, CAPABILITY_COMPACT_PUPPETS,
+    CAPABILITY_COMPRESSION, CAPABILITY_PROGRESS_BITS, FRAGMENT_CHUNK_SIZE, FRAGMENT_HEADER_SIZE,
+    FRAGMENT_MAX_MESSAGE_SIZE, PROTOCOL_VERSION, PUPPET_COMPACT_HEADER_SIZE, PUPPET_SHAPE_DELTA,
+    RELIABLE_ACK_BLOCK_SIZE, SERVER_CAPABILITIES, STATE_DIGEST_ABILITY_PROGRESS,
+    STATE_DIGEST_BUCKETS, STATE_DIGEST_CATEGORIES, STATE_DIGEST_FILE_PROGRESS,
+    STATE_DIGEST_HONEYCOMBS, STATE_DIGEST_HONEYCOMB_SCORE, STATE_DIGEST_JIGGIES,
+    STATE_DIGEST_MUMBO_SCORE, STATE_DIGEST_MUMBO_TOKENS, STATE_DIGEST_NOTES,
+    STATE_DIGEST_OPENED_LEVELS, STATE_EVENT_HEADER_SIZE,
+};
+use crate::schema::{
+    encode_broadcast_honeycomb, encode_broadcast_jiggy, encode_broadcast_level_opened,
+    encode_broadcast_mumbo_token, encode_broadcast_note, encode_broadcast_note_pos,
+};
 use crate::state::ServerState;
 
 pub struct NetworkServer {
     socket: Arc<UdpSocket>,
     state: Arc<ServerState>,
 
-    last_reliable_seq: tokio::sync::Mutex<HashMap<(SocketAddr, u8), u32>>,
+    last_reliable_seq: tokio::sync::Mutex<HashMap<SocketAddr, ReliableWindow>>,
 
-    reliable_next_seq: std::sync::atomic::AtomicU32,
+    reliable_next_seq: tokio::sync::Mutex<HashMap<SocketAddr, u32>>,
     reliable_pending: tokio::sync::Mutex<HashMap<(SocketAddr, u32), PendingReliable>>,
+
+    next_fragment_id: std::sync::atomic::AtomicU16,
+    fragments: tokio::sync::Mutex<HashMap<(SocketAddr, u16), FragmentAssembly>>,
+}
+
+/**
+ * A fragmented message being put back together. Every chunk but the last is
+ * FRAGMENT_CHUNK_SIZE, so each one is copied straight to index * chunk size.
+ */
+struct FragmentAssembly {
+    count: u16,
+    received: u16,
+    started_ms: u64,
+    size: usize,
+    data: Vec<u8>,
+    have: Vec<bool>,
 }
 
 #[derive(Clone)]
@@ -30,42 +62,77 @@ struct PendingReliable {
     attempts: u8,
 }
 
+/**
+ * Sliding window of recently received reliable sequence numbers for one client.
+ * Clients retransmit on their own timer, so the same seq can arrive more than once
+ * and out of order; a bare "highest seen" check would drop late-but-new packets.
+ */
+#[derive(Default)]
+struct ReliableWindow {
+    highest: u32,
+    seen: u128,
+    initialized: bool,
+}
+
+impl ReliableWindow {
+    const SIZE: u32 = 128;
+
+    /// Marks `seq` as received. Returns false if it was already seen (or too old to tell).
+    fn check_and_mark(&mut self, seq: u32) -> bool {
+        if !self.initialized {
+            self.initialized = true;
+            self.highest = seq;
+            self.seen = 1;
+            return true;
+        }
+
+        if seq > self.highest {
+            let shift = seq - self.highest;
+            self.seen = if shift >= Self::SIZE {
+                0
+            } else {
+                self.seen << shift
+            };
+            self.seen |= 1;
+            self.highest = seq;
+            return true;
+        }
+
+        let offset = self.highest - seq;
+        if offset >= Self::SIZE {
+            return false;
+        }
+
+        let bit = 1u128 << offset;
+        if self.seen & bit != 0 {
+            return false;
+        }
+
+        self.seen |= bit;
+        true
+    }
+}
+
 impl NetworkServer {
     pub fn new(socket: Arc<UdpSocket>, config: Config) -> Self {
         Self {
             socket,
             state: Arc::new(ServerState::new(config)),
             last_reliable_seq: tokio::sync::Mutex::new(HashMap::new()),
-            reliable_next_seq: std::sync::atomic::AtomicU32::new(1),
+            reliable_next_seq: tokio::sync::Mutex::new(HashMap::new()),
             reliable_pending: tokio::sync::Mutex::new(HashMap::new()),
+            next_fragment_id: std::sync::atomic::AtomicU16::new(0),
+            fragments: tokio::sync::Mutex::new(HashMap::new()),
         }
     }
 
-    fn is_reliable_type(packet_type: PacketType) -> bool {
-        matches!(
-            packet_type,
-            PacketType::JiggyCollected
-                | PacketType::NoteCollected
-                | PacketType::NoteCollectedPos
-                | PacketType::NoteSaveData
-                | PacketType::FileProgressFlags
-                | PacketType::AbilityProgress
-                | PacketType::HoneycombScore
-                | PacketType::MumboScore
-                | PacketType::HoneycombCollected
-                | PacketType::MumboTokenCollected
-                | PacketType::LevelOpened
-                | PacketType::FullSyncRequest
-        )
-    }
-
     async fn maybe_strip_reliable_prefix(
         &self,
         packet_type: PacketType,
         payload: &[u8],
         addr: SocketAddr,
     ) -> Result<Option<Vec<u8>>> {
-        if !Self::is_reliable_type(packet_type) {
+        if !packet_type.is_reliable() {
             return Ok(Some(payload.to_vec()));
         }
 
@@ -80,12 +147,9 @@ impl NetworkServer {
 
         {
             let mut map = self.last_reliable_seq.lock().await;
-            let key = (addr, packet_type as u8);
-            let last = map.get(&key).copied().unwrap_or(0);
-            if seq <= last {
+            if !map.entry(addr).or_default().check_and_mark(seq) {
                 return Ok(None);
             }
-            map.insert(key, seq);
         }
 
         Ok(Some(payload[4..].to_vec()))
@@ -210,6 +274,121 @@ impl NetworkServer {
         }
     }
 
+    /**
+     * Clears everything a coalesced ack block covers from the retry queue.
+     * Layout (LE): u32 highest seq received, u64 mask where bit N means
+     * (highest - 1 - N) was received as well.
+     */
+    async fn apply_reliable_ack_block(&self, block: &[u8], addr: SocketAddr) {
+        if block.len() < RELIABLE_ACK_BLOCK_SIZE {
+            return;
+        }
+
+        let highest = u32::from_le_bytes([block[0], block[1], block[2], block[3]]);
+        let mask = u64::from_le_bytes([
+            block[4], block[5], block[6], block[7], block[8], block[9], block[10], block[11],
+        ]);
+
+        let mut pending = self.reliable_pending.lock().await;
+        pending.remove(&(addr, highest));
+
+        for bit in 0..64u32 {
+            if mask & (1u64 << bit) != 0 {
+                pending.remove(&(addr, highest.wrapping_sub(1 + bit)));
+            }
+        }
+
+        debug!(
+            "reliable ack block <- {} highest={} mask={:016x} (pending after={})",
+            addr,
+            highest,
+            mask,
+            pending.len()
+        );
+    }
+
+    /**
+     * Stores one fragment. Returns the whole [type][payload] message once the
+     * last missing piece arrives.
+     */
+    async fn accept_fragment(&self, payload: &[u8], addr: SocketAddr) -> Option<Vec<u8>> {
+        const FRAGMENT_TIMEOUT_MS: u64 = 20_000;
+        const MAX_ASSEMBLIES_PER_ADDR: usize = 8;
+
+        if payload.len() <= FRAGMENT_HEADER_SIZE {
+            return None;
+        }
+
+        let id = u16::from_le_bytes([payload[0], payload[1]]);
+        let index = u16::from_le_bytes([payload[2], payload[3]]) as usize;
+        let count = u16::from_le_bytes([payload[4], payload[5]]) as usize;
+        let chunk = &payload[FRAGMENT_HEADER_SIZE..];
+
+        let is_last = index + 1 == count;
+        if count == 0
+            || index >= count
+            || count * FRAGMENT_CHUNK_SIZE > FRAGMENT_MAX_MESSAGE_SIZE
+            || chunk.len() > FRAGMENT_CHUNK_SIZE
+            || (!is_last && chunk.len() != FRAGMENT_CHUNK_SIZE)
+        {
+            return None;
+        }
+
+        let now = Self::now_ms();
+        let mut fragments = self.fragments.lock().await;
+
+        fragments.retain(|_, a| now.saturating_sub(a.started_ms) < FRAGMENT_TIMEOUT_MS);
+
+        if fragments
+            .get(&(addr, id))
+            .map_or(false, |a| a.count as usize != count)
+        {
+            fragments.remove(&(addr, id));
+        }
+
+        if !fragments.contains_key(&(addr, id)) {
+            let held = fragments.keys().filter(|(a, _)| *a == addr).count();
+            if held >= MAX_ASSEMBLIES_PER_ADDR {
+                debug!("Too many partial messages from {}, dropping fragment", addr);
+                return None;
+            }
+
+            fragments.insert(
+                (addr, id),
+                FragmentAssembly {
+                    count: count as u16,
+                    received: 0,
+                    started_ms: now,
+                    size: 0,
+                    data: vec![0u8; count * FRAGMENT_CHUNK_SIZE],
+                    have: vec![false; count],
+                },
+            );
+        }
+
+        let assembly = fragments.get_mut(&(addr, id))?;
+        if assembly.have[index] {
+            return None;
+        }
+
+        let offset = index * FRAGMENT_CHUNK_SIZE;
+        assembly.data[offset..offset + chunk.len()].copy_from_slice(chunk);
+        assembly.have[index] = true;
+        assembly.received += 1;
+
+        if is_last {
+            assembly.size = offset + chunk.len();
+        }
+
+        if assembly.received < assembly.count {
+            return None;
+        }
+
+        let mut done = fragments.remove(&(addr, id))?;
+        done.data.truncate(done.size);
+        Some(done.data)
+    }
+
     async fn cleanup_loop(&self) {
         let mut interval = time::interval(Duration::from_secs(30));
 
@@ -217,6 +396,7 @@ impl NetworkServer {
             interval.tick().await;
 
             self.state.cleanup_timed_out_players().await;
+            self.state.cleanup_expired_sessions();
             self.state.cleanup_idle_lobbies().await;
 
             if let Err(e) = self.state.save_all_lobbies().await {
@@ -230,7 +410,40 @@ impl NetworkServer {
             return Ok(());
         }
 
-        let packet_type = PacketType::from(data[0]);
+        if PacketType::from(data[0]) != PacketType::Bundle {
+            return self.handle_message(data, addr).await;
+        }
+
+        let mut offset = 1;
+        while offset + BUNDLE_RECORD_HEADER_SIZE <= data.len() {
+            let record_len = u16::from_le_bytes([data[offset], data[offset + 1]]) as usize;
+            offset += BUNDLE_RECORD_HEADER_SIZE;
+
+            if record_len == 0 || offset + record_len > data.len() {
+                break;
+            }
+
+            let record = &data[offset..offset + record_len];
+            offset += record_len;
+
+            if PacketType::from(record[0]) == PacketType::Bundle {
+                continue;
+            }
+
+            if let Err(e) = self.handle_message(record, addr).await {
+                warn!("Error handling bundled message from {}: {}", addr, e);
+            }
+        }
+
+        Ok(())
+    }
+
+    async fn handle_message(&self, data: &[u8], addr: SocketAddr) -> Result<()> {
+        if data.is_empty() {
+            return Ok(());
+        }
+
+        let mut packet_type = PacketType::from(data[0]);
         let payload = &data[1..];
 
         let payload_buf_opt = match packet_type {
@@ -248,6 +461,18 @@ impl NetworkServer {
                 }
                 Some(Vec::new())
             }
+            PacketType::ReliableAckBatch => {
+                self.apply_reliable_ack_block(payload, addr).await;
+                Some(Vec::new())
+            }
+            PacketType::PuppetUpdateAck | PacketType::PuppetUpdateCompactAck => {
+                if payload.len() < RELIABLE_ACK_BLOCK_SIZE {
+                    return Ok(());
+                }
+                self.apply_reliable_ack_block(&payload[..RELIABLE_ACK_BLOCK_SIZE], addr)
+                    .await;
+                Some(payload[RELIABLE_ACK_BLOCK_SIZE..].to_vec())
+            }
             _ => {
                 self.maybe_strip_reliable_prefix(packet_type, payload, addr)
                     .await?
@@ -258,7 +483,25 @@ impl NetworkServer {
             return Ok(());
         }
 
-        let payload_buf = payload_buf_opt.unwrap();
+        let mut payload_buf = payload_buf_opt.unwrap();
+
+        if packet_type == PacketType::Fragment {
+            let message = match self.accept_fragment(&payload_buf, addr).await {
+                Some(message) => message,
+                None => return Ok(()),
+            };
+
+            packet_type = PacketType::from(message[0]);
+            if packet_type == PacketType::Fragment || packet_type == PacketType::Bundle {
+                return Ok(());
+            }
+            payload_buf = message[1..].to_vec();
+        }
+
+        if packet_type == PacketType::Compressed {
+            (packet_type, payload_buf) = decompress_message(&payload_buf)?;
+        }
+
         let payload = payload_buf.as_slice();
 
         match packet_type {
@@ -266,27 +509,55 @@ impl NetworkServer {
             PacketType::Ping => self.handle_ping(addr).await?,
             PacketType::JiggyCollected => self.handle_jiggy_collected(payload, addr).await?,
             PacketType::HoneycombCollected => {
-                self.handle_honeycomb_collected(payload, addr).await?
+                let hc = HoneycombCollectedPacket::deserialize(payload)?;
+                self.handle_honeycomb_collected(hc, addr).await?
+            }
+            PacketType::HoneycombCollectedCompact => {
+                let hc = HoneycombCollectedPacket::deserialize_compact(payload)?;
+                self.handle_honeycomb_collected(hc, addr).await?
             }
             PacketType::MumboTokenCollected => {
-                self.handle_mumbo_token_collected(payload, addr).await?
+                let tok = MumboTokenCollectedPacket::deserialize(payload)?;
+                self.handle_mumbo_token_collected(tok, addr).await?
+            }
+            PacketType::MumboTokenCollectedCompact => {
+                let tok = MumboTokenCollectedPacket::deserialize_compact(payload)?;
+                self.handle_mumbo_token_collected(tok, addr).await?
             }
             PacketType::NoteCollectedPos => self.handle_note_collected_pos(payload, addr).await?,
-            PacketType::NoteCollected => self.handle_note_collected(payload, addr).await?,
-            PacketType::FullSyncRequest => self.handle_full_sync_request(addr).await?,
+            PacketType::NoteCollected => {
+                let note = NotePacket::deserialize(payload)?;
+                self.handle_note_collected(note, addr).await?
+            }
+            PacketType::NoteCollectedCompact => {
+                let note = NotePacket::deserialize_compact(payload)?;
+                self.handle_note_collected(note, addr).await?
+            }
+            PacketType::FullSyncRequest => self.handle_full_sync_request(payload, addr).await?,
+            PacketType::FullSyncBucketsRequest => {
+                self.handle_full_sync_buckets_request(payload, addr).await?
+            }
             PacketType::NoteSaveData => self.handle_note_save_data(payload, addr).await?,
             PacketType::FileProgressFlags => self.handle_file_progress_flags(payload, addr).await?,
             PacketType::AbilityProgress => self.handle_ability_progress(payload, addr).await?,
             PacketType::HoneycombScore => self.handle_honeycomb_score(payload, addr).await?,
             PacketType::MumboScore => self.handle_mumbo_score(payload, addr).await?,
-            PacketType::PuppetUpdate => self.handle_puppet_update(payload, addr).await?,
+            PacketType::ProgressBits => self.handle_progress_bits(payload, addr).await?,
+            PacketType::PuppetUpdate | PacketType::PuppetUpdateAck => {
+                self.handle_puppet_update(PacketType::PuppetUpdate, payload, addr)
+                    .await?
+            }
+            PacketType::PuppetUpdateCompact | PacketType::PuppetUpdateCompactAck => {
+                self.handle_puppet_update(PacketType::PuppetUpdateCompact, payload, addr)
+                    .await?
+            }
             PacketType::PuppetSyncRequest => self.handle_puppet_sync_request(addr).await?,
             PacketType::LevelOpened => self.handle_level_opened(payload, addr).await?,
             PacketType::PlayerInfoRequest => self.handle_player_info_request(payload, addr).await?,
             PacketType::PlayerInfoResponse => {
                 self.handle_player_info_response(payload, addr).await?
             }
-            PacketType::ReliableAck => {}
+            PacketType::ReliableAck | PacketType::ReliableAckBatch => {}
             _ => {
                 debug!("Unknown packet type: {:?} from {}", packet_type, addr);
             }
@@ -317,7 +588,21 @@ impl NetworkServer {
                 );
                 return Ok(());
             }
+        }
+
+        let resume = login.resume.and_then(|(token, applied)| {
+            self.state
+                .prepare_resume(token, &login.lobby_name, &login.username, applied)
+        });
+
+        // a player that hasn't timed out yet keeps its id and its lobby slot
+        let rebound = match &resume {
+            Some(plan) => self.state.rebind_player(plan.player_id, addr).await,
+            None => false,
+        };
 
+        if !rebound {
+            let lob = lobby.read().await;
             if lob.player_count() >= self.state.config().server.max_players_per_lobby {
                 warn!(
                     "Connection failed for {}: lobby {} is full",
@@ -332,8 +617,16 @@ impl NetworkServer {
             .get_or_create_player(addr, &login.username, &login.lobby_name)
             .await;
 
+        // clients from before versioning get only what they always had
+        let capabilities = if login.protocol_version >= 1 {
+            login.capabilities & SERVER_CAPABILITIES
+        } else {
+            0
+        };
+
         let player_id = {
-            let p = player.read().await;
+            let mut p = player.write().await;
+            p.capabilities = capabilities;
             p.id
         };
 
@@ -344,27 +637,192 @@ impl NetworkServer {
             needs
         };
 
-        self.send_packet(PacketType::Pong, &[], addr).await?;
+        match resume {
+            Some(plan) => {
+                self.state.attach_session(plan.token, player_id, addr);
+                self.send_handshake_accepted(
+                    player_id,
+                    plan.token,
+                    plan.applied_state_seq,
+                    true,
+                    capabilities,
+                    addr,
+                )
+                .await?;
+
+                for entry in &plan.missed {
+                    self.send_state_event_to_peer(
+                        entry.state_seq,
+                        entry.packet_type,
+                        &entry.payload,
+                        addr,
+                    )
+                    .await?;
+                }
 
-        if lobby_needs_initial_save_data {
-            info!(
-                "Lobby {} needs initial save data; requesting upload from {}",
-                login.lobby_name, login.username
-            );
-            self.send_packet(PacketType::InitialSaveDataRequest, &[], addr)
+                info!(
+                    "Resumed session for {} at {}: replayed {} missed updates instead of a full sync",
+                    login.username,
+                    addr,
+                    plan.missed.len()
+                );
+            }
+            None => {
+                let (token, state_seq) =
+                    self.state
+                        .open_session(&login.lobby_name, &login.username, player_id, addr);
+                self.send_handshake_accepted(
+                    player_id,
+                    token,
+                    state_seq,
+                    false,
+                    capabilities,
+                    addr,
+                )
                 .await?;
-        } else {
-            self.send_full_lobby_state(&login.lobby_name, addr).await?;
+
+                // otherwise the client asks for the full state itself, saying
+                // what it already has
+                if lobby_needs_initial_save_data {
+                    info!(
+                        "Lobby {} needs initial save data; requesting upload from {}",
+                        login.lobby_name, login.username
+                    );
+                    self.send_packet(PacketType::InitialSaveDataRequest, &[], addr)
+                        .await?;
+                }
+            }
         }
 
-        self.broadcast_player_connected(&login.lobby_name, &login.username, player_id, addr)
-            .await?;
+        if !rebound {
+            self.broadcast_player_connected(&login.lobby_name, &login.username, player_id, addr)
+                .await?;
+        }
 
         self.send_player_list(&login.lobby_name, addr).await?;
 
         Ok(())
     }
 
+    /**
+     * Acknowledges a handshake; the client stays in its handshaking state
+     * until this arrives. Layout (BE): u32 player id, u64 session token,
+     * u32 state seq the client is up to, u8 1 if this resumed its old session,
+     * u8 low byte of the negotiated capabilities (all that clients from before
+     * versioning read), u16 PROTOCOL_VERSION, u32 negotiated capabilities.
+     */
+    async fn send_handshake_accepted(
+        &self,
+        player_id: u32,
+        token: u64,
+        state_seq: u32,
+        resumed: bool,
+        capabilities: u32,
+        addr: SocketAddr,
+    ) -> Result<()> {
+        let mut payload = Vec::with_capacity(24);
+        payload.extend_from_slice(&player_id.to_be_bytes());
+        payload.extend_from_slice(&token.to_be_bytes());
+        payload.extend_from_slice(&state_seq.to_be_bytes());
+        payload.push(resumed as u8);
+        payload.push(capabilities as u8);
+        payload.extend_from_slice(&PROTOCOL_VERSION.to_be_bytes());
+        payload.extend_from_slice(&capabilities.to_be_bytes());
+
+        self.send_packet_reliable(PacketType::HandshakeAccepted, &payload, addr)
+            .await
+    }
+
+    /** CAPABILITY_* bits negotiated with the player at addr, none if unknown. */
+    async fn peer_capabilities(&self, addr: SocketAddr) -> u32 {
+        match self.state.get_player_by_addr(&addr) {
+            Some(player) => player.read().await.capabilities,
+            None => 0,
+        }
+    }
+
+    /**
+     * Sends a journaled state change in the form the peer negotiated: a
+     * ProgressBits they have no capability for becomes the progress blob
+     * packet it stands for, collectibles go compact and bulk state goes
+     * Compressed when they can.
+     */
+    async fn send_state_event_to_peer(
+        &self,
+        state_seq: u32,
+        packet_type: PacketType,
+        payload: &[u8],
+        addr: SocketAddr,
+    ) -> Result<()> {
+        let capabilities = self.peer_capabilities(addr).await;
+
+        if packet_type == PacketType::ProgressBits
+            && payload.len() > 4
+            && capabilities & CAPABILITY_PROGRESS_BITS == 0
+        {
+            let bits = ProgressBitsPacket::deserialize(&payload[4..])?;
+            let player = self.state.get_player_by_addr(&addr);
+            let lobby = match player {
+                Some(player) => {
+                    let lobby_name = player.read().await.lobby_name.clone();
+                    self.state.get_lobby(&lobby_name)
+                }
+                None => None,
+            };
+
+            if let Some(lobby_arc) = lobby {
+                let size = lobby_arc
+                    .read()
+                    .await
+                    .progress_blob(bits.blob_type)
+                    .map_or(0, |blob| blob.len());
+
+                let mut legacy = payload[..4].to_vec();
+                legacy.extend_from_slice(&bits.to_sparse_blob(size));
+                return self
+                    .send_state_event(state_seq, bits.blob_type, &legacy, addr)
+                    .await;
+            }
+        }
+
+        if capabilities & CAPABILITY_COMPACT_COLLECTIBLES != 0 {
+            if let Some((compact_type, compact)) =
+                compact_collectible_broadcast(packet_type, payload)
+            {
+                return self
+                    .send_state_event(state_seq, compact_type, &compact, addr)
+                    .await;
+            }
+        }
+
+        if capabilities & CAPABILITY_COMPRESSION != 0 {
+            if let Some(packed) = compress_message(packet_type, payload) {
+                return self
+                    .send_state_event(state_seq, PacketType::Compressed, &packed, addr)
+                    .await;
+            }
+        }
+
+        self.send_state_event(state_seq, packet_type, payload, addr)
+            .await
+    }
+
+    async fn send_state_event(
+        &self,
+        state_seq: u32,
+        packet_type: PacketType,
+        payload: &[u8],
+        addr: SocketAddr,
+    ) -> Result<()> {
+        let mut wrapped = Vec::with_capacity(STATE_EVENT_HEADER_SIZE + 1 + payload.len());
+        wrapped.extend_from_slice(&state_seq.to_le_bytes());
+        wrapped.push(packet_type as u8);
+        wrapped.extend_from_slice(payload);
+
+        self.send_packet_reliable(PacketType::StateEvent, &wrapped, addr)
+            .await
+    }
+
     async fn handle_ping(&self, addr: SocketAddr) -> Result<()> {
         self.send_packet(PacketType::Pong, &[], addr).await
     }
@@ -396,9 +854,12 @@ impl NetworkServer {
 
         if added {
             let mut payload = Vec::new();
-            payload.extend_from_slice(&player_id.to_be_bytes());
-            payload.extend_from_slice(&jiggy.jiggy_enum_id.to_be_bytes());
-            payload.extend_from_slice(&jiggy.collected_value.to_be_bytes());
+            encode_broadcast_jiggy(
+                &mut payload,
+                player_id,
+                jiggy.jiggy_enum_id,
+                jiggy.collected_value,
+            );
 
             self.broadcast_to_lobby_except(&lobby_name, addr, PacketType::JiggyCollected, &payload)
                 .await?;
@@ -407,9 +868,11 @@ impl NetworkServer {
         Ok(())
     }
 
-    async fn handle_honeycomb_collected(&self, payload: &[u8], addr: SocketAddr) -> Result<()> {
-        let hc = HoneycombCollectedPacket::deserialize(payload)?;
-
+    async fn handle_honeycomb_collected(
+        &self,
+        hc: HoneycombCollectedPacket,
+        addr: SocketAddr,
+    ) -> Result<()> {
         let player = self.state.get_player_by_addr(&addr);
         if player.is_none() {
             return Ok(());
@@ -441,12 +904,15 @@ impl NetworkServer {
 
         if added {
             let mut payload = Vec::new();
-            payload.extend_from_slice(&player_id.to_be_bytes());
-            payload.extend_from_slice(&hc.map_id.to_be_bytes());
-            payload.extend_from_slice(&hc.honeycomb_id.to_be_bytes());
-            payload.extend_from_slice(&hc.x.to_be_bytes());
-            payload.extend_from_slice(&hc.y.to_be_bytes());
-            payload.extend_from_slice(&hc.z.to_be_bytes());
+            encode_broadcast_honeycomb(
+                &mut payload,
+                player_id,
+                hc.map_id,
+                hc.honeycomb_id,
+                hc.x,
+                hc.y,
+                hc.z,
+            );
 
             self.broadcast_to_lobby_except(
                 &lobby_name,
@@ -460,9 +926,11 @@ impl NetworkServer {
         Ok(())
     }
 
-    async fn handle_mumbo_token_collected(&self, payload: &[u8], addr: SocketAddr) -> Result<()> {
-        let tok = MumboTokenCollectedPacket::deserialize(payload)?;
-
+    async fn handle_mumbo_token_collected(
+        &self,
+        tok: MumboTokenCollectedPacket,
+        addr: SocketAddr,
+    ) -> Result<()> {
         let player = self.state.get_player_by_addr(&addr);
         if player.is_none() {
             return Ok(());
@@ -494,12 +962,15 @@ impl NetworkServer {
 
         if added {
             let mut payload = Vec::new();
-            payload.extend_from_slice(&player_id.to_be_bytes());
-            payload.extend_from_slice(&tok.map_id.to_be_bytes());
-            payload.extend_from_slice(&tok.token_id.to_be_bytes());
-            payload.extend_from_slice(&tok.x.to_be_bytes());
-            payload.extend_from_slice(&tok.y.to_be_bytes());
-            payload.extend_from_slice(&tok.z.to_be_bytes());
+            encode_broadcast_mumbo_token(
+                &mut payload,
+                player_id,
+                tok.map_id,
+                tok.token_id,
+                tok.x,
+                tok.y,
+                tok.z,
+            );
 
             self.broadcast_to_lobby_except(
                 &lobby_name,
@@ -545,9 +1016,12 @@ impl NetworkServer {
             );
 
             let mut payload = Vec::new();
-            payload.extend_from_slice(&player_id.to_be_bytes());
-            payload.extend_from_slice(&level.world_id.to_be_bytes());
-            payload.extend_from_slice(&level.jiggy_cost.to_be_bytes());
+            encode_broadcast_level_opened(
+                &mut payload,
+                player_id,
+                level.world_id,
+                level.jiggy_cost,
+            );
 
             self.broadcast_to_lobby_except(&lobby_name, addr, PacketType::LevelOpened, &payload)
                 .await?;
@@ -594,11 +1068,7 @@ impl NetworkServer {
             );
 
             let mut payload = Vec::new();
-            payload.extend_from_slice(&player_id.to_be_bytes());
-            payload.extend_from_slice(&note.map_id.to_be_bytes());
-            payload.extend_from_slice(&note.x.to_be_bytes());
-            payload.extend_from_slice(&note.y.to_be_bytes());
-            payload.extend_from_slice(&note.z.to_be_bytes());
+            encode_broadcast_note_pos(&mut payload, player_id, note.map_id, note.x, note.y, note.z);
 
             self.broadcast_to_lobby_except(
                 &lobby_name,
@@ -612,9 +1082,7 @@ impl NetworkServer {
         Ok(())
     }
 
-    async fn handle_note_collected(&self, payload: &[u8], addr: SocketAddr) -> Result<()> {
-        let note = NotePacket::deserialize(payload)?;
-
+    async fn handle_note_collected(&self, note: NotePacket, addr: SocketAddr) -> Result<()> {
         let player = self.state.get_player_by_addr(&addr);
         if player.is_none() {
             return Ok(());
@@ -631,13 +1099,15 @@ impl NetworkServer {
             note.map_id, note.note_index, username, lobby_name
         );
 
-        // Manually serialize broadcast
         let mut payload = Vec::new();
-        payload.extend_from_slice(&player_id.to_be_bytes());
-        payload.extend_from_slice(&note.map_id.to_be_bytes());
-        payload.extend_from_slice(&note.level_id.to_be_bytes());
-        payload.extend_from_slice(&(if note.is_dynamic { 1i32 } else { 0i32 }).to_be_bytes());
-        payload.extend_from_slice(&note.note_index.to_be_bytes());
+        encode_broadcast_note(
+            &mut payload,
+            player_id,
+            note.map_id,
+            note.level_id,
+            note.is_dynamic as i32,
+            note.note_index,
+        );
 
         info!(
             "Broadcasting note: player_id={}, map={}, level={}, is_dynamic={}, note_index={}",
@@ -702,30 +1172,11 @@ impl NetworkServer {
                 let was_initial = !l.has_initial_save_data;
                 l.has_initial_save_data = true;
 
-                const FILEPROG_31_MM_OPEN: usize = 0x31;
-                const FILEPROG_39_CCW_OPEN: usize = 0x39;
-                const JIGSAW_COSTS: [i32; 9] = [1, 2, 5, 7, 8, 9, 10, 12, 15];
-
-                for flag_index in FILEPROG_31_MM_OPEN..=FILEPROG_39_CCW_OPEN {
-                    let byte_index = flag_index / 8;
-                    let bit_index = flag_index % 8;
-
-                    if byte_index < data.flags.len() {
-                        let is_set = (data.flags[byte_index] & (1 << bit_index)) != 0;
-                        if is_set {
-                            let world_id = (flag_index - FILEPROG_31_MM_OPEN + 1) as i32;
-                            let jiggy_cost = JIGSAW_COSTS[(world_id - 1) as usize];
-
-                            // Add opened level if not already tracked
-                            if !l.is_level_opened(world_id) {
-                                l.add_opened_level(world_id, jiggy_cost);
-                                info!(
-                                    "Extracted opened level from file progress: World={}, Cost={}",
-                                    world_id, jiggy_cost
-                                );
-                            }
-                        }
-                    }
+                for world_id in l.open_levels_from_file_progress(&data.flags) {
+                    info!(
+                        "Extracted opened level from file progress: World={}",
+                        world_id
+                    );
                 }
 
                 was_initial
@@ -749,7 +1200,7 @@ impl NetworkServer {
                 "Initial save data received from {}, sending full state back",
                 lobby_name
             );
-            self.send_full_lobby_state(&lobby_name, addr).await?;
+            self.send_full_lobby_state(&lobby_name, addr, None).await?;
         }
 
         Ok(())
@@ -861,7 +1312,47 @@ impl NetworkServer {
         Ok(())
     }
 
-    async fn handle_full_sync_request(&self, addr: SocketAddr) -> Result<()> {
+    async fn handle_progress_bits(&self, payload: &[u8], addr: SocketAddr) -> Result<()> {
+        let data = ProgressBitsPacket::deserialize(payload)?;
+
+        let player = self.state.get_player_by_addr(&addr);
+        if player.is_none() {
+            return Ok(());
+        }
+
+        let player_arc = player.unwrap();
+        let (lobby_name, player_id) = {
+            let p = player_arc.read().await;
+            (p.lobby_name.clone(), p.id)
+        };
+
+        let lobby = self.state.get_lobby(&lobby_name);
+        let fresh = if let Some(lobby_arc) = lobby {
+            let mut l = lobby_arc.write().await;
+            l.set_progress_bits(data.blob_type, &data.bits)
+        } else {
+            Vec::new()
+        };
+
+        // pass on only what the lobby didn't already have
+        if !fresh.is_empty() {
+            let forward = ProgressBitsPacket {
+                blob_type: data.blob_type,
+                bits: fresh,
+            };
+
+            let mut payload = Vec::new();
+            payload.extend_from_slice(&player_id.to_be_bytes());
+            payload.extend_from_slice(&forward.serialize());
+
+            self.broadcast_to_lobby_except(&lobby_name, addr, PacketType::ProgressBits, &payload)
+                .await?;
+        }
+
+        Ok(())
+    }
+
+    async fn handle_full_sync_request(&self, payload: &[u8], addr: SocketAddr) -> Result<()> {
         let player = self.state.get_player_by_addr(&addr);
         if player.is_none() {
             return Ok(());
@@ -873,10 +1364,21 @@ impl NetworkServer {
             p.lobby_name.clone()
         };
 
-        self.send_full_lobby_state(&lobby_name, addr).await
+        let have = FullSyncRequestPacket::deserialize(payload)?.digests;
+        self.send_full_lobby_state(&lobby_name, addr, have).await
     }
 
-    async fn handle_puppet_update(&self, payload: &[u8], addr: SocketAddr) -> Result<()> {
+    /**
+     * Forwards a puppet update to the rest of the lobby as-is; `forward_type`
+     * says whether it's the full or the compact encoding. Compact keyframes
+     * are acked back to the sender, which then sends deltas against them.
+     */
+    async fn handle_puppet_update(
+        &self,
+        forward_type: PacketType,
+        payload: &[u8],
+        addr: SocketAddr,
+    ) -> Result<()> {
         let player = self.state.get_player_by_addr(&addr);
         if player.is_none() {
             return Ok(());
@@ -888,9 +1390,39 @@ impl NetworkServer {
             (p.lobby_name.clone(), p.id)
         };
 
+        // (is a delta, baseline id) for compact updates
+        let compact_header = if forward_type == PacketType::PuppetUpdateCompact {
+            if payload.len() < PUPPET_COMPACT_HEADER_SIZE {
+                return Ok(());
+            }
+            Some((payload[0] & PUPPET_SHAPE_DELTA != 0, payload[1]))
+        } else {
+            None
+        };
+
         {
             let mut p = player_arc.write().await;
-            p.last_puppet_state = Some(payload.to_vec());
+            match compact_header {
+                Some((true, baseline_id)) => {
+                    // a late joiner can only use it on top of the keyframe we kept
+                    let builds_on_kept = matches!(
+                        &p.last_puppet_state,
+                        Some((PacketType::PuppetUpdateCompact, keyframe)) if keyframe[1] == baseline_id
+                    );
+                    if builds_on_kept {
+                        p.last_puppet_delta = Some(payload.to_vec());
+                    }
+                }
+                _ => {
+                    p.last_puppet_state = Some((forward_type, payload.to_vec()));
+                    p.last_puppet_delta = None;
+                }
+            }
+        }
+
+        if let Some((false, baseline_id)) = compact_header {
+            self.send_packet(PacketType::PuppetBaselineAck, &[baseline_id], addr)
+                .await?;
         }
 
         let mut forwarded_payload = Vec::with_capacity(4 + payload.len());
@@ -903,9 +1435,16 @@ impl NetworkServer {
             .await;
 
         for target_addr in addresses {
+            // nothing to forward to a peer that can't decode it
+            if forward_type == PacketType::PuppetUpdateCompact
+                && self.peer_capabilities(target_addr).await & CAPABILITY_COMPACT_PUPPETS == 0
+            {
+                continue;
+            }
+
             if target_addr != addr {
                 if let Err(e) = self
-                    .send_packet(PacketType::PuppetUpdate, &forwarded_payload, target_addr)
+                    .send_packet(forward_type, &forwarded_payload, target_addr)
                     .await
                 {
                     debug!("Failed to forward puppet update to {}: {}", target_addr, e);
@@ -929,6 +1468,7 @@ impl NetworkServer {
         };
 
         let players = self.state.get_lobby_players(&lobby_name).await;
+        let compact = self.peer_capabilities(addr).await & CAPABILITY_COMPACT_PUPPETS != 0;
 
         for other_player in players {
             let other_addr = other_player.read().await.address;
@@ -937,25 +1477,30 @@ impl NetworkServer {
                 continue;
             }
 
-            let puppet_state = {
+            let (other_id, puppet_state, puppet_delta) = {
                 let p = other_player.read().await;
-                p.last_puppet_state.clone()
+                (
+                    p.id,
+                    p.last_puppet_state.clone(),
+                    p.last_puppet_delta.clone(),
+                )
             };
 
-            if let Some(state) = puppet_state {
-                let other_id = {
-                    let p = other_player.read().await;
-                    p.id
-                };
+            // the keyframe first, so the newest delta has something to apply to
+            let replay = puppet_state
+                .into_iter()
+                .chain(puppet_delta.map(|delta| (PacketType::PuppetUpdateCompact, delta)));
+
+            for (state_type, state) in replay {
+                if state_type == PacketType::PuppetUpdateCompact && !compact {
+                    continue;
+                }
 
                 let mut forwarded_payload = Vec::with_capacity(4 + state.len());
                 forwarded_payload.extend_from_slice(&other_id.to_le_bytes());
                 forwarded_payload.extend_from_slice(&state);
 
-                if let Err(e) = self
-                    .send_packet(PacketType::PuppetUpdate, &forwarded_payload, addr)
-                    .await
-                {
+                if let Err(e) = self.send_packet(state_type, &forwarded_payload, addr).await {
                     warn!("Failed to send puppet state to {}: {}", addr, e);
                 }
             }
@@ -965,7 +1510,18 @@ impl NetworkServer {
         Ok(())
     }
 
-    async fn send_full_lobby_state(&self, lobby_name: &str, addr: SocketAddr) -> Result<()> {
+    /**
+     * Streams the lobby's state to one player. With the digests from their
+     * FullSyncRequest, categories they already have are skipped, and for the
+     * set categories that differ they're sent the bucket digests to narrow
+     * it down with (see handle_full_sync_buckets_request).
+     */
+    async fn send_full_lobby_state(
+        &self,
+        lobby_name: &str,
+        addr: SocketAddr,
+        have: Option<[u64; STATE_DIGEST_CATEGORIES]>,
+    ) -> Result<()> {
         let lobby = self.state.get_lobby(lobby_name);
         if lobby.is_none() {
             return Ok(());
@@ -974,98 +1530,207 @@ impl NetworkServer {
         let lobby_arc = lobby.unwrap();
         let l = lobby_arc.read().await;
 
-        for level_index in 0..9 {
-            let save_data = &l.save_flags.note_save_data[level_index];
-            let packet = NoteSaveDataPacket {
-                level_index: level_index as i32,
-                save_data: save_data.clone(),
-            };
-            let payload = packet.serialize();
-            self.send_packet_serialized(PacketType::NoteSaveData, &payload, addr)
-                .await?;
+        let digests = l.state_digests();
+        let mut skipped = 0;
+        let mut narrowed = 0;
+
+        for category in 0..STATE_DIGEST_CATEGORIES {
+            match have {
+                Some(have) if have[category] == digests[category] => skipped += 1,
+                Some(_) if state_digest_is_bucketed(category) => {
+                    let mut payload = Vec::with_capacity(1 + STATE_DIGEST_BUCKETS * 8);
+                    payload.push(category as u8);
+                    for bucket in l.state_digest_buckets(category) {
+                        payload.extend_from_slice(&bucket.to_le_bytes());
+                    }
+
+                    self.send_packet_serialized(PacketType::StateDigestBuckets, &payload, addr)
+                        .await?;
+                    narrowed += 1;
+                }
+                _ => {
+                    self.send_lobby_category(&l, category, u16::MAX, addr)
+                        .await?
+                }
+            }
         }
 
-        let fp = FileProgressFlagsPacket {
-            flags: l.save_flags.file_progress_flags.clone(),
-        };
-        let fp_payload = fp.serialize();
-        self.send_packet_serialized(PacketType::FileProgressFlags, &fp_payload, addr)
-            .await?;
+        info!(
+            "Sent full state to player at {} ({} jiggies, {} honeycombs, {} tokens, {} opened levels; {} of {} categories already up to date, {} narrowed to buckets)",
+            addr,
+            l.collected_jiggies.len(),
+            l.collected_honeycombs.len(),
+            l.collected_mumbo_tokens.len(),
+            l.opened_levels.len(),
+            skipped,
+            STATE_DIGEST_CATEGORIES,
+            narrowed
+        );
 
-        let ap = AbilityProgressPacket {
-            bytes: l.save_flags.ability_progress.clone(),
-        };
-        let ap_payload = ap.serialize();
-        self.send_packet_serialized(PacketType::AbilityProgress, &ap_payload, addr)
-            .await?;
+        Ok(())
+    }
 
-        let hc = HoneycombScorePacket {
-            bytes: l.save_flags.honeycomb_score.clone(),
-        };
-        let hc_payload = hc.serialize();
-        self.send_packet_serialized(PacketType::HoneycombScore, &hc_payload, addr)
-            .await?;
+    /**
+     * Sends one category of lobby state, limited to the buckets whose bit is
+     * set in the mask. Progress blobs go whole whatever the mask.
+     */
+    async fn send_lobby_category(
+        &self,
+        l: &Lobby,
+        category: usize,
+        buckets: u16,
+        addr: SocketAddr,
+    ) -> Result<()> {
+        let in_buckets = |a: i32| buckets & (1 << state_digest_bucket(a)) != 0;
+        let capabilities = self.peer_capabilities(addr).await;
+        let compact = capabilities & CAPABILITY_COMPACT_COLLECTIBLES != 0;
+        let compress = capabilities & CAPABILITY_COMPRESSION != 0;
+        // progress blobs go out as from player 0, like the broadcasts they stand in for
+        let blob = |bytes: &[u8]| [&0u32.to_be_bytes()[..], bytes].concat();
+
+        match category {
+            STATE_DIGEST_NOTES => {
+                for level_index in 0..9 {
+                    if !in_buckets(level_index as i32) {
+                        continue;
+                    }
 
-        let ms = MumboScorePacket {
-            bytes: l.save_flags.mumbo_score.clone(),
-        };
-        let ms_payload = ms.serialize();
-        self.send_packet_serialized(PacketType::MumboScore, &ms_payload, addr)
-            .await?;
+                    let save_data = &l.save_flags.note_save_data[level_index];
+                    let packet = NoteSaveDataPacket {
+                        level_index: level_index as i32,
+                        save_data: save_data.clone(),
+                    };
+                    let payload = packet.serialize();
+                    self.send_bulk(compress, PacketType::NoteSaveData, &payload, addr)
+                        .await?;
+                }
+            }
+            STATE_DIGEST_FILE_PROGRESS => {
+                let payload = blob(&l.save_flags.file_progress_flags);
+                self.send_bulk(compress, PacketType::FileProgressFlags, &payload, addr)
+                    .await?;
+            }
+            STATE_DIGEST_ABILITY_PROGRESS => {
+                let payload = blob(&l.save_flags.ability_progress);
+                self.send_bulk(compress, PacketType::AbilityProgress, &payload, addr)
+                    .await?;
+            }
+            STATE_DIGEST_HONEYCOMB_SCORE => {
+                let payload = blob(&l.save_flags.honeycomb_score);
+                self.send_bulk(compress, PacketType::HoneycombScore, &payload, addr)
+                    .await?;
+            }
+            STATE_DIGEST_MUMBO_SCORE => {
+                let payload = blob(&l.save_flags.mumbo_score);
+                self.send_bulk(compress, PacketType::MumboScore, &payload, addr)
+                    .await?;
+            }
+            STATE_DIGEST_JIGGIES => {
+                for jiggy in &l.collected_jiggies {
+                    if !in_buckets(jiggy.level_id) {
+                        continue;
+                    }
 
-        for jiggy in &l.collected_jiggies {
-            let broadcast = BroadcastJiggy {
-                jiggy_enum_id: jiggy.level_id,
-                collected_value: jiggy.jiggy_id,
-                collector: jiggy.collected_by.clone(),
-            };
-            let jiggy_payload = broadcast.serialize(0);
-            self.send_packet_serialized(PacketType::JiggyCollected, &jiggy_payload, addr)
-                .await?;
-        }
+                    let broadcast = BroadcastJiggy {
+                        jiggy_enum_id: jiggy.level_id,
+                        collected_value: jiggy.jiggy_id,
+                        collector: jiggy.collected_by.clone(),
+                    };
+                    let jiggy_payload = broadcast.serialize(0);
+                    self.send_packet_serialized(PacketType::JiggyCollected, &jiggy_payload, addr)
+                        .await?;
+                }
+            }
+            STATE_DIGEST_HONEYCOMBS => {
+                for hc in &l.collected_honeycombs {
+                    if !in_buckets(hc.map_id) {
+                        continue;
+                    }
 
-        for hc in &l.collected_honeycombs {
-            let mut payload = Vec::new();
-            payload.extend_from_slice(&0u32.to_be_bytes());
-            payload.extend_from_slice(&hc.map_id.to_be_bytes());
-            payload.extend_from_slice(&hc.honeycomb_id.to_be_bytes());
-            payload.extend_from_slice(&hc.x.to_be_bytes());
-            payload.extend_from_slice(&hc.y.to_be_bytes());
-            payload.extend_from_slice(&hc.z.to_be_bytes());
-            self.send_packet_serialized(PacketType::HoneycombCollected, &payload, addr)
-                .await?;
+                    let mut payload = Vec::new();
+                    encode_broadcast_honeycomb(
+                        &mut payload,
+                        0,
+                        hc.map_id,
+                        hc.honeycomb_id,
+                        hc.x,
+                        hc.y,
+                        hc.z,
+                    );
+                    self.send_collectible(compact, PacketType::HoneycombCollected, &payload, addr)
+                        .await?;
+                }
+            }
+            STATE_DIGEST_MUMBO_TOKENS => {
+                for tok in &l.collected_mumbo_tokens {
+                    if !in_buckets(tok.map_id) {
+                        continue;
+                    }
+
+                    let mut payload = Vec::new();
+                    encode_broadcast_mumbo_token(
+                        &mut payload,
+                        0,
+                        tok.map_id,
+                        tok.token_id,
+                        tok.x,
+                        tok.y,
+                        tok.z,
+                    );
+                    self.send_collectible(compact, PacketType::MumboTokenCollected, &payload, addr)
+                        .await?;
+                }
+            }
+            STATE_DIGEST_OPENED_LEVELS => {
+                for opened in &l.opened_levels {
+                    if !in_buckets(opened.world_id) {
+                        continue;
+                    }
+
+                    let broadcast = BroadcastLevelOpened {
+                        world_id: opened.world_id,
+                        jiggy_cost: opened.jiggy_cost,
+                    };
+                    let payload = broadcast.serialize(0);
+                    self.send_packet_serialized(PacketType::LevelOpened, &payload, addr)
+                        .await?;
+                }
+            }
+            _ => {}
         }
 
-        for tok in &l.collected_mumbo_tokens {
-            let mut payload = Vec::new();
-            payload.extend_from_slice(&0u32.to_be_bytes());
-            payload.extend_from_slice(&tok.map_id.to_be_bytes());
-            payload.extend_from_slice(&tok.token_id.to_be_bytes());
-            payload.extend_from_slice(&tok.x.to_be_bytes());
-            payload.extend_from_slice(&tok.y.to_be_bytes());
-            payload.extend_from_slice(&tok.z.to_be_bytes());
-            self.send_packet_serialized(PacketType::MumboTokenCollected, &payload, addr)
-                .await?;
+        Ok(())
+    }
+
+    async fn handle_full_sync_buckets_request(
+        &self,
+        payload: &[u8],
+        addr: SocketAddr,
+    ) -> Result<()> {
+        let request = FullSyncBucketsRequestPacket::deserialize(payload)?;
+
+        let player = self.state.get_player_by_addr(&addr);
+        if player.is_none() {
+            return Ok(());
         }
 
-        for opened in &l.opened_levels {
-            let packet = LevelOpenedPacket {
-                world_id: opened.world_id,
-                jiggy_cost: opened.jiggy_cost,
-            };
-            let payload = packet.serialize();
-            self.send_packet_serialized(PacketType::LevelOpened, &payload, addr)
+        let player_arc = player.unwrap();
+        let lobby_name = {
+            let p = player_arc.read().await;
+            p.lobby_name.clone()
+        };
+
+        let lobby = self.state.get_lobby(&lobby_name);
+        if let Some(lobby_arc) = lobby {
+            let l = lobby_arc.read().await;
+            self.send_lobby_category(&l, request.category, request.buckets, addr)
                 .await?;
-        }
 
-        info!(
-            "Sent full state to player at {} (9 levels of note data + save blobs + {} jiggies + {} honeycombs + {} tokens + {} opened levels)",
-            addr,
-            l.collected_jiggies.len(),
-            l.collected_honeycombs.len(),
-            l.collected_mumbo_tokens.len(),
-            l.opened_levels.len()
-        );
+            debug!(
+                "Sent state category {} buckets {:#06x} to {}",
+                request.category, request.buckets, addr
+            );
+        }
 
         Ok(())
     }
@@ -1143,6 +1808,23 @@ impl NetworkServer {
         packet_type: PacketType,
         payload: &[u8],
     ) -> Result<()> {
+        if packet_type.is_lobby_state() {
+            let deliveries =
+                self.state
+                    .journal_state_change(lobby_name, except_addr, packet_type, payload);
+
+            for (addr, state_seq) in deliveries {
+                if let Err(e) = self
+                    .send_state_event_to_peer(state_seq, packet_type, payload, addr)
+                    .await
+                {
+                    warn!("Failed to send to {}: {}", addr, e);
+                }
+            }
+
+            return Ok(());
+        }
+
         let addresses = self.state.get_lobby_players_except(lobby_name, 0).await;
 
         for addr in addresses {
@@ -1159,6 +1841,48 @@ impl NetworkServer {
         Ok(())
     }
 
+    /** Sends bulk lobby state, as Compressed if `compress` and that comes out smaller. */
+    async fn send_bulk(
+        &self,
+        compress: bool,
+        packet_type: PacketType,
+        payload: &[u8],
+        addr: SocketAddr,
+    ) -> Result<()> {
+        if compress {
+            if let Some(packed) = compress_message(packet_type, payload) {
+                return self
+                    .send_packet_serialized(PacketType::Compressed, &packed, addr)
+                    .await;
+            }
+        }
+
+        self.send_packet_serialized(packet_type, payload, addr)
+            .await
+    }
+
+    /** Sends a collectible broadcast, in its compact form if `compact` and it fits. */
+    async fn send_collectible(
+        &self,
+        compact: bool,
+        packet_type: PacketType,
+        payload: &[u8],
+        addr: SocketAddr,
+    ) -> Result<()> {
+        if compact {
+            if let Some((compact_type, compact_payload)) =
+                compact_collectible_broadcast(packet_type, payload)
+            {
+                return self
+                    .send_packet_serialized(compact_type, &compact_payload, addr)
+                    .await;
+            }
+        }
+
+        self.send_packet_serialized(packet_type, payload, addr)
+            .await
+    }
+
     async fn send_packet_serialized(
         &self,
         packet_type: PacketType,
@@ -1175,7 +1899,7 @@ impl NetworkServer {
         payload: &[u8],
         addr: SocketAddr,
     ) -> Result<()> {
-        if Self::is_reliable_type(packet_type) {
+        if packet_type.is_reliable() {
             self.send_packet_reliable(packet_type, payload, addr).await
         } else {
             self.send_packet(packet_type, payload, addr).await
@@ -1187,6 +1911,49 @@ impl NetworkServer {
         packet_type: PacketType,
         payload: &[u8],
         addr: SocketAddr,
+    ) -> Result<()> {
+        if 1 + 4 + payload.len() <= BUNDLE_MTU - 1 - BUNDLE_RECORD_HEADER_SIZE {
+            return self.queue_reliable(packet_type, payload, addr).await;
+        }
+
+        let mut message = Vec::with_capacity(1 + payload.len());
+        message.push(packet_type as u8);
+        message.extend_from_slice(payload);
+
+        if message.len() > FRAGMENT_MAX_MESSAGE_SIZE {
+            warn!(
+                "Dropping {:?} to {}: {} bytes is too large even to fragment",
+                packet_type,
+                addr,
+                payload.len()
+            );
+            return Ok(());
+        }
+
+        let id = self
+            .next_fragment_id
+            .fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+        let count = message.len().div_ceil(FRAGMENT_CHUNK_SIZE);
+
+        for (index, chunk) in message.chunks(FRAGMENT_CHUNK_SIZE).enumerate() {
+            let mut fragment = Vec::with_capacity(FRAGMENT_HEADER_SIZE + chunk.len());
+            fragment.extend_from_slice(&id.to_le_bytes());
+            fragment.extend_from_slice(&(index as u16).to_le_bytes());
+            fragment.extend_from_slice(&(count as u16).to_le_bytes());
+            fragment.extend_from_slice(chunk);
+
+            self.queue_reliable(PacketType::Fragment, &fragment, addr)
+                .await?;
+        }
+
+        Ok(())
+    }
+
+    async fn queue_reliable(
+        &self,
+        packet_type: PacketType,
+        payload: &[u8],
+        addr: SocketAddr,
     ) -> Result<()> {
         const MAX_PENDING_PER_ADDR: usize = 256;
 
@@ -1198,9 +1965,13 @@ impl NetworkServer {
             }
         }
 
-        let seq = self
-            .reliable_next_seq
-            .fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+        let seq = {
+            let mut next = self.reliable_next_seq.lock().await;
+            let counter = next.entry(addr).or_insert(1);
+            let seq = *counter;
+            *counter = counter.wrapping_add(1);
+            seq
+        };
 
         {
             let mut pending = self.reliable_pending.lock().await;
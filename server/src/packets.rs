@@ -1,5 +1,14 @@
 ﻿use anyhow::{anyhow, Result};
 
+use crate::protocol::{PacketType, STATE_DIGEST_CATEGORIES};
+use crate::schema::{
+    encode_broadcast_jiggy, encode_broadcast_level_opened, encode_broadcast_note,
+    encode_broadcast_note_pos, encode_player_info_request_packet,
+    encode_player_info_response_packet, HoneycombCollectedPacketView, JiggyPacketView,
+    LevelOpenedPacketView, MumboTokenCollectedPacketView, NotePacketPosView, NotePacketView,
+    PlayerInfoRequestPacketView, PlayerInfoResponsePacketView,
+};
+
 fn read_u32_be(data: &[u8], offset: usize) -> Result<u32> {
     if offset + 4 > data.len() {
         return Err(anyhow!("Not enough data to read u32"));
@@ -40,8 +49,37 @@ pub fn write_u32_be(buf: &mut Vec<u8>, value: u32) {
     buf.push(value as u8);
 }
 
-fn write_i32_be(buf: &mut Vec<u8>, value: i32) {
-    write_u32_be(buf, value as u32);
+/** LEB128: 7 bits a byte, low bits first, top bit set while more follow. */
+pub fn read_var_u32(data: &[u8], offset: &mut usize) -> Result<u32> {
+    let mut value: u32 = 0;
+    let mut shift = 0;
+
+    while shift < 35 {
+        let byte = *data
+            .get(*offset)
+            .ok_or_else(|| anyhow!("Not enough data to read varint"))?;
+        *offset += 1;
+
+        if shift == 28 && byte > 0x0F {
+            return Err(anyhow!("Varint doesn't fit u32"));
+        }
+
+        value |= ((byte & 0x7F) as u32) << shift;
+        if byte & 0x80 == 0 {
+            return Ok(value);
+        }
+        shift += 7;
+    }
+
+    Err(anyhow!("Varint doesn't fit u32"))
+}
+
+pub fn write_var_u32(buf: &mut Vec<u8>, mut value: u32) {
+    while value >= 0x80 {
+        buf.push((value as u8) | 0x80);
+        value >>= 7;
+    }
+    buf.push(value as u8);
 }
 
 #[derive(Debug, Clone)]
@@ -49,6 +87,16 @@ pub struct LoginPacket {
     pub lobby_name: String,
     pub password: String,
     pub username: String,
+
+    /**
+     * Session token and last applied state seq, sent by a client that's
+     * reconnecting and wants to resume rather than start over
+     */
+    pub resume: Option<(u64, u32)>,
+
+    /** PROTOCOL_VERSION and CAPABILITY_* bits, both 0 from older clients. */
+    pub protocol_version: u16,
+    pub capabilities: u32,
 }
 
 impl LoginPacket {
@@ -100,11 +148,38 @@ impl LoginPacket {
             return Err(anyhow!("Invalid LoginPacket: not enough data for username"));
         }
         let username = String::from_utf8(data[offset..offset + user_len].to_vec())?;
+        offset += user_len;
+
+        // Resume block: u64 token, u32 last applied state seq. Optional from
+        // older clients; newer ones always send it, with token 0 for none
+        let mut resume = None;
+        if offset + 12 <= data.len() {
+            let token = ((read_u32_be(data, offset)? as u64) << 32)
+                | (read_u32_be(data, offset + 4)? as u64);
+            let applied = read_u32_be(data, offset + 8)?;
+            if token != 0 {
+                resume = Some((token, applied));
+            }
+            offset += 12;
+        }
+
+        // Then u16 protocol version, u32 capability bits
+        let (protocol_version, capabilities) = if offset + 6 <= data.len() {
+            (
+                u16::from_be_bytes([data[offset], data[offset + 1]]),
+                read_u32_be(data, offset + 2)?,
+            )
+        } else {
+            (0, 0)
+        };
 
         Ok(LoginPacket {
             lobby_name,
             password,
             username,
+            resume,
+            protocol_version,
+            capabilities,
         })
     }
 }
@@ -117,12 +192,10 @@ pub struct JiggyPacket {
 
 impl JiggyPacket {
     pub fn deserialize(data: &[u8]) -> Result<Self> {
-        if data.len() < 8 {
-            return Err(anyhow!("Invalid JiggyPacket: expected 8 bytes"));
-        }
+        let view = JiggyPacketView::new(data)?;
         Ok(JiggyPacket {
-            jiggy_enum_id: read_i32_le(data, 0)?,
-            collected_value: read_i32_le(data, 4)?,
+            jiggy_enum_id: view.jiggy_enum_id(),
+            collected_value: view.collected_value(),
         })
     }
 }
@@ -137,17 +210,32 @@ pub struct NotePacket {
 
 impl NotePacket {
     pub fn deserialize(data: &[u8]) -> Result<Self> {
-        if data.len() < 13 {
-            return Err(anyhow!(
-                "Invalid NotePacket: expected 13 bytes, got {}",
-                data.len()
-            ));
-        }
+        let view = NotePacketView::new(data)?;
+        Ok(NotePacket {
+            map_id: view.map_id(),
+            level_id: view.level_id(),
+            is_dynamic: view.is_dynamic() != 0,
+            note_index: view.note_index(),
+        })
+    }
+
+    /** The NoteCollectedCompact form, see compact_collectible_broadcast. */
+    pub fn deserialize_compact(data: &[u8]) -> Result<Self> {
+        let mut offset = 0;
+        let map_id = read_var_u32(data, &mut offset)? as i32;
+        let level_id = read_var_u32(data, &mut offset)? as i32;
+        let is_dynamic = *data
+            .get(offset)
+            .ok_or_else(|| anyhow!("Invalid compact NotePacket: no dynamic flag"))?
+            != 0;
+        offset += 1;
+        let note_index = read_var_u32(data, &mut offset)? as i32;
+
         Ok(NotePacket {
-            map_id: i32::from_le_bytes([data[0], data[1], data[2], data[3]]),
-            level_id: i32::from_le_bytes([data[4], data[5], data[6], data[7]]),
-            is_dynamic: data[8] != 0,
-            note_index: i32::from_le_bytes([data[9], data[10], data[11], data[12]]),
+            map_id,
+            level_id,
+            is_dynamic,
+            note_index,
         })
     }
 }
@@ -162,14 +250,12 @@ pub struct NotePacketPos {
 
 impl NotePacketPos {
     pub fn deserialize(data: &[u8]) -> Result<Self> {
-        if data.len() < 10 {
-            return Err(anyhow!("Invalid NotePacketPos: expected 10 bytes"));
-        }
+        let view = NotePacketPosView::new(data)?;
         Ok(NotePacketPos {
-            map_id: read_i32_le(data, 0)?,
-            x: read_i16_le(data, 4)? as i32,
-            y: read_i16_le(data, 6)? as i32,
-            z: read_i16_le(data, 8)? as i32,
+            map_id: view.map_id(),
+            x: view.x() as i32,
+            y: view.y() as i32,
+            z: view.z() as i32,
         })
     }
 }
@@ -182,21 +268,12 @@ pub struct LevelOpenedPacket {
 
 impl LevelOpenedPacket {
     pub fn deserialize(data: &[u8]) -> Result<Self> {
-        if data.len() < 8 {
-            return Err(anyhow!("Invalid LevelOpenedPacket: expected 8 bytes"));
-        }
+        let view = LevelOpenedPacketView::new(data)?;
         Ok(LevelOpenedPacket {
-            world_id: read_i32_le(data, 0)?,
-            jiggy_cost: read_i32_le(data, 4)?,
+            world_id: view.world_id(),
+            jiggy_cost: view.jiggy_cost(),
         })
     }
-
-    pub fn serialize(&self) -> Vec<u8> {
-        let mut payload = Vec::new();
-        payload.extend_from_slice(&self.world_id.to_be_bytes());
-        payload.extend_from_slice(&self.jiggy_cost.to_be_bytes());
-        payload
-    }
 }
 
 #[derive(Debug, Clone)]
@@ -210,10 +287,6 @@ impl FileProgressFlagsPacket {
             flags: data.to_vec(),
         })
     }
-
-    pub fn serialize(&self) -> Vec<u8> {
-        self.flags.clone()
-    }
 }
 
 #[derive(Debug, Clone)]
@@ -227,10 +300,6 @@ impl AbilityProgressPacket {
             bytes: data.to_vec(),
         })
     }
-
-    pub fn serialize(&self) -> Vec<u8> {
-        self.bytes.clone()
-    }
 }
 
 #[derive(Debug, Clone)]
@@ -244,10 +313,6 @@ impl HoneycombScorePacket {
             bytes: data.to_vec(),
         })
     }
-
-    pub fn serialize(&self) -> Vec<u8> {
-        self.bytes.clone()
-    }
 }
 
 #[derive(Debug, Clone)]
@@ -261,9 +326,133 @@ impl MumboScorePacket {
             bytes: data.to_vec(),
         })
     }
+}
+
+/**
+ * Digests of the lobby state the client already has, one u64 LE per
+ * STATE_DIGEST_* category. Older clients send nothing, meaning they have
+ * nothing.
+ */
+#[derive(Debug, Clone)]
+pub struct FullSyncRequestPacket {
+    pub digests: Option<[u64; STATE_DIGEST_CATEGORIES]>,
+}
+
+impl FullSyncRequestPacket {
+    pub fn deserialize(data: &[u8]) -> Result<Self> {
+        if data.len() < STATE_DIGEST_CATEGORIES * 8 {
+            return Ok(FullSyncRequestPacket { digests: None });
+        }
+
+        let mut digests = [0u64; STATE_DIGEST_CATEGORIES];
+        for (i, digest) in digests.iter_mut().enumerate() {
+            let mut bytes = [0u8; 8];
+            bytes.copy_from_slice(&data[i * 8..i * 8 + 8]);
+            *digest = u64::from_le_bytes(bytes);
+        }
+
+        Ok(FullSyncRequestPacket {
+            digests: Some(digests),
+        })
+    }
+}
+
+/**
+ * The buckets of one digest category a client wants streamed, after
+ * comparing the StateDigestBuckets it was sent with its own.
+ */
+#[derive(Debug, Clone)]
+pub struct FullSyncBucketsRequestPacket {
+    pub category: usize,
+    pub buckets: u16,
+}
+
+impl FullSyncBucketsRequestPacket {
+    pub fn deserialize(data: &[u8]) -> Result<Self> {
+        if data.len() < 3 {
+            return Err(anyhow!("Not enough data for full sync buckets request"));
+        }
+
+        let category = data[0] as usize;
+        if category >= STATE_DIGEST_CATEGORIES {
+            return Err(anyhow!("Unknown state digest category {}", category));
+        }
+
+        Ok(FullSyncBucketsRequestPacket {
+            category,
+            buckets: u16::from_le_bytes([data[1], data[2]]),
+        })
+    }
+}
+
+/**
+ * Bits newly set in one of the progress blobs. Layout: u8 blob packet type,
+ * then LEB128 varints: the first bit index, then the gap to each next one - 1.
+ * Bits are kept in ascending order.
+ */
+#[derive(Debug, Clone)]
+pub struct ProgressBitsPacket {
+    pub blob_type: PacketType,
+    pub bits: Vec<u32>,
+}
+
+impl ProgressBitsPacket {
+    pub fn deserialize(data: &[u8]) -> Result<Self> {
+        if data.is_empty() {
+            return Err(anyhow!("Not enough data for progress bits"));
+        }
+
+        let blob_type = PacketType::from(data[0]);
+        match blob_type {
+            PacketType::FileProgressFlags
+            | PacketType::AbilityProgress
+            | PacketType::HoneycombScore
+            | PacketType::MumboScore => {}
+            _ => return Err(anyhow!("Progress bits for unknown blob {}", data[0])),
+        }
+
+        let mut bits = Vec::new();
+        let mut offset = 1;
+        let mut next: u64 = 0;
+
+        while offset < data.len() {
+            let bit = next + read_var_u32(data, &mut offset)? as u64;
+            if bit > u32::MAX as u64 {
+                return Err(anyhow!("Progress bit index out of range"));
+            }
+
+            bits.push(bit as u32);
+            next = bit + 1;
+        }
+
+        Ok(ProgressBitsPacket { blob_type, bits })
+    }
 
     pub fn serialize(&self) -> Vec<u8> {
-        self.bytes.clone()
+        let mut buf = Vec::with_capacity(1 + self.bits.len() * 2);
+        buf.push(self.blob_type as u8);
+
+        let mut next = 0;
+        for &bit in &self.bits {
+            write_var_u32(&mut buf, bit - next);
+            next = bit + 1;
+        }
+
+        buf
+    }
+
+    /**
+     * The bits as a blob of the given size with only them set. Progress is
+     * only ever ORed in, so clients apply it like the full blob.
+     */
+    pub fn to_sparse_blob(&self, size: usize) -> Vec<u8> {
+        let mut blob = vec![0u8; size];
+        for &bit in &self.bits {
+            if let Some(byte) = blob.get_mut((bit / 8) as usize) {
+                *byte |= 1 << (bit % 8);
+            }
+        }
+        blob
     }
 }
 
@@ -278,17 +467,24 @@ pub struct HoneycombCollectedPacket {
 
 impl HoneycombCollectedPacket {
     pub fn deserialize(data: &[u8]) -> Result<Self> {
-        if data.len() < 20 {
-            return Err(anyhow!(
-                "Invalid HoneycombCollectedPacket: expected 20 bytes"
-            ));
-        }
+        let view = HoneycombCollectedPacketView::new(data)?;
+        Ok(HoneycombCollectedPacket {
+            map_id: view.map_id(),
+            honeycomb_id: view.honeycomb_id(),
+            x: view.x(),
+            y: view.y(),
+            z: view.z(),
+        })
+    }
+
+    pub fn deserialize_compact(data: &[u8]) -> Result<Self> {
+        let (map_id, honeycomb_id, x, y, z) = read_compact_collectible(data)?;
         Ok(HoneycombCollectedPacket {
-            map_id: read_i32_le(data, 0)?,
-            honeycomb_id: read_i32_le(data, 4)?,
-            x: read_i32_le(data, 8)?,
-            y: read_i32_le(data, 12)?,
-            z: read_i32_le(data, 16)?,
+            map_id,
+            honeycomb_id,
+            x,
+            y,
+            z,
         })
     }
 }
@@ -304,21 +500,91 @@ pub struct MumboTokenCollectedPacket {
 
 impl MumboTokenCollectedPacket {
     pub fn deserialize(data: &[u8]) -> Result<Self> {
-        if data.len() < 20 {
-            return Err(anyhow!(
-                "Invalid MumboTokenCollectedPacket: expected 20 bytes"
-            ));
-        }
+        let view = MumboTokenCollectedPacketView::new(data)?;
+        Ok(MumboTokenCollectedPacket {
+            map_id: view.map_id(),
+            token_id: view.token_id(),
+            x: view.x(),
+            y: view.y(),
+            z: view.z(),
+        })
+    }
+
+    pub fn deserialize_compact(data: &[u8]) -> Result<Self> {
+        let (map_id, token_id, x, y, z) = read_compact_collectible(data)?;
         Ok(MumboTokenCollectedPacket {
-            map_id: read_i32_le(data, 0)?,
-            token_id: read_i32_le(data, 4)?,
-            x: read_i32_le(data, 8)?,
-            y: read_i32_le(data, 12)?,
-            z: read_i32_le(data, 16)?,
+            map_id,
+            token_id,
+            x,
+            y,
+            z,
         })
     }
 }
 
+/** [varint map][varint id][i16 LE x, y, z] */
+fn read_compact_collectible(data: &[u8]) -> Result<(i32, i32, i32, i32, i32)> {
+    let mut offset = 0;
+    let map_id = read_var_u32(data, &mut offset)? as i32;
+    let id = read_var_u32(data, &mut offset)? as i32;
+
+    Ok((
+        map_id,
+        id,
+        read_i16_le(data, offset)? as i32,
+        read_i16_le(data, offset + 2)? as i32,
+        read_i16_le(data, offset + 4)? as i32,
+    ))
+}
+
+/**
+ * Re-encodes a HoneycombCollected, MumboTokenCollected or NoteCollected
+ * broadcast for a client with CAPABILITY_COMPACT_COLLECTIBLES: the player id
+ * and ids become varints and the coordinates i16 (BE), so
+ * [varint player][varint map][varint id][i16 x][i16 y][i16 z] and
+ * [varint player][varint map][varint level][u8 dynamic][varint note index].
+ * None for any other type, or when the coordinates don't fit.
+ */
+pub fn compact_collectible_broadcast(
+    packet_type: PacketType,
+    payload: &[u8],
+) -> Option<(PacketType, Vec<u8>)> {
+    let field = |index: usize| read_u32_be(payload, index * 4).ok();
+    let mut buf = Vec::with_capacity(16);
+
+    match packet_type {
+        PacketType::HoneycombCollected | PacketType::MumboTokenCollected => {
+            let mut coords = [0i16; 3];
+            for (i, coord) in coords.iter_mut().enumerate() {
+                *coord = i16::try_from(field(3 + i)? as i32).ok()?;
+            }
+
+            for i in 0..3 {
+                write_var_u32(&mut buf, field(i)?);
+            }
+            for coord in coords {
+                buf.extend_from_slice(&coord.to_be_bytes());
+            }
+
+            let compact_type = if packet_type == PacketType::HoneycombCollected {
+                PacketType::HoneycombCollectedCompact
+            } else {
+                PacketType::MumboTokenCollectedCompact
+            };
+            Some((compact_type, buf))
+        }
+        PacketType::NoteCollected => {
+            for i in 0..3 {
+                write_var_u32(&mut buf, field(i)?);
+            }
+            buf.push((field(3)? != 0) as u8);
+            write_var_u32(&mut buf, field(4)?);
+            Some((PacketType::NoteCollectedCompact, buf))
+        }
+        _ => None,
+    }
+}
+
 #[derive(Debug, Clone)]
 pub struct NoteSaveDataPacket {
     pub level_index: i32,
@@ -356,9 +622,12 @@ pub struct BroadcastJiggy {
 impl BroadcastJiggy {
     pub fn serialize(&self, player_id: u32) -> Vec<u8> {
         let mut buf = Vec::new();
-        write_u32_be(&mut buf, player_id);
-        write_i32_be(&mut buf, self.jiggy_enum_id);
-        write_i32_be(&mut buf, self.collected_value);
+        encode_broadcast_jiggy(
+            &mut buf,
+            player_id,
+            self.jiggy_enum_id,
+            self.collected_value,
+        );
         buf
     }
 }
@@ -375,11 +644,14 @@ pub struct BroadcastNote {
 impl BroadcastNote {
     pub fn serialize(&self, player_id: u32) -> Vec<u8> {
         let mut buf = Vec::new();
-        write_u32_be(&mut buf, player_id);
-        write_i32_be(&mut buf, self.map_id);
-        write_i32_be(&mut buf, self.level_id);
-        write_i32_be(&mut buf, if self.is_dynamic { 1 } else { 0 });
-        write_i32_be(&mut buf, self.note_index);
+        encode_broadcast_note(
+            &mut buf,
+            player_id,
+            self.map_id,
+            self.level_id,
+            self.is_dynamic as i32,
+            self.note_index,
+        );
         buf
     }
 }
@@ -396,11 +668,7 @@ pub struct BroadcastNotePos {
 impl BroadcastNotePos {
     pub fn serialize(&self, player_id: u32) -> Vec<u8> {
         let mut buf = Vec::new();
-        write_u32_be(&mut buf, player_id);
-        write_i32_be(&mut buf, self.map_id);
-        write_i32_be(&mut buf, self.x);
-        write_i32_be(&mut buf, self.y);
-        write_i32_be(&mut buf, self.z);
+        encode_broadcast_note_pos(&mut buf, player_id, self.map_id, self.x, self.y, self.z);
         buf
     }
 }
@@ -414,9 +682,7 @@ pub struct BroadcastLevelOpened {
 impl BroadcastLevelOpened {
     pub fn serialize(&self, player_id: u32) -> Vec<u8> {
         let mut buf = Vec::new();
-        write_u32_be(&mut buf, player_id);
-        write_i32_be(&mut buf, self.world_id);
-        write_i32_be(&mut buf, self.jiggy_cost);
+        encode_broadcast_level_opened(&mut buf, player_id, self.world_id, self.jiggy_cost);
         buf
     }
 }
@@ -453,14 +719,6 @@ impl PlayerDisconnectedBroadcast {
     }
 }
 
-fn write_f32_be(buf: &mut Vec<u8>, value: f32) {
-    write_u32_be(buf, value.to_bits());
-}
-
-fn read_f32_be(data: &[u8], offset: usize) -> Result<f32> {
-    Ok(f32::from_bits(read_u32_be(data, offset)?))
-}
-
 #[derive(Debug, Clone)]
 pub struct PlayerInfoRequest {
     pub target_player_id: u32,
@@ -469,19 +727,20 @@ pub struct PlayerInfoRequest {
 
 impl PlayerInfoRequest {
     pub fn deserialize(data: &[u8]) -> Result<Self> {
-        if data.len() < 8 {
-            return Err(anyhow!("Invalid PlayerInfoRequest: expected 8 bytes"));
-        }
+        let view = PlayerInfoRequestPacketView::new(data)?;
         Ok(PlayerInfoRequest {
-            target_player_id: read_u32_be(data, 0)?,
-            requester_player_id: read_u32_be(data, 4)?,
+            target_player_id: view.target_player_id(),
+            requester_player_id: view.requester_player_id(),
         })
     }
 
     pub fn serialize(&self) -> Vec<u8> {
         let mut buf = Vec::new();
-        write_u32_be(&mut buf, self.target_player_id);
-        write_u32_be(&mut buf, self.requester_player_id);
+        encode_player_info_request_packet(
+            &mut buf,
+            self.target_player_id,
+            self.requester_player_id,
+        );
         buf
     }
 }
@@ -499,37 +758,30 @@ pub struct PlayerInfoResponse {
 
 impl PlayerInfoResponse {
     pub fn deserialize(data: &[u8]) -> Result<Self> {
-        if data.len() < 24 {
-            return Err(anyhow!("Invalid PlayerInfoResponse: expected 24 bytes"));
-        }
-        let target_player_id = read_u32_be(data, 0)?;
-        let map_id = i16::from_be_bytes([data[4], data[5]]);
-        let level_id = i16::from_be_bytes([data[6], data[7]]);
-        let x = read_f32_be(data, 8)?;
-        let y = read_f32_be(data, 12)?;
-        let z = read_f32_be(data, 16)?;
-        let yaw = read_f32_be(data, 20)?;
-
+        let view = PlayerInfoResponsePacketView::new(data)?;
         Ok(PlayerInfoResponse {
-            target_player_id,
-            map_id,
-            level_id,
-            x,
-            y,
-            z,
-            yaw,
+            target_player_id: view.target_player_id(),
+            map_id: view.map_id(),
+            level_id: view.level_id(),
+            x: view.x(),
+            y: view.y(),
+            z: view.z(),
+            yaw: view.yaw(),
         })
     }
 
     pub fn serialize(&self) -> Vec<u8> {
         let mut buf = Vec::new();
-        write_u32_be(&mut buf, self.target_player_id);
-        buf.extend_from_slice(&self.map_id.to_be_bytes());
-        buf.extend_from_slice(&self.level_id.to_be_bytes());
-        write_f32_be(&mut buf, self.x);
-        write_f32_be(&mut buf, self.y);
-        write_f32_be(&mut buf, self.z);
-        write_f32_be(&mut buf, self.yaw);
+        encode_player_info_response_packet(
+            &mut buf,
+            self.target_player_id,
+            self.map_id,
+            self.level_id,
+            self.x,
+            self.y,
+            self.z,
+            self.yaw,
+        );
         buf
     }
 }
@@ -1,6 +1,8 @@
 use std::net::SocketAddr;
 use std::time::Instant;
 
+use crate::protocol::PacketType;
+
 #[derive(Debug, Clone)]
 pub struct Player {
     pub id: u32,
@@ -9,7 +11,12 @@ pub struct Player {
     pub lobby_name: String,
     pub last_seen: Instant,
     pub connected_at: Instant,
-    pub last_puppet_state: Option<Vec<u8>>,
+    /** Last puppet update and the type it came as (full or compact). */
+    pub last_puppet_state: Option<(PacketType, Vec<u8>)>,
+    /** Newest compact delta taken against the keyframe in last_puppet_state. */
+    pub last_puppet_delta: Option<Vec<u8>>,
+    /** CAPABILITY_* bits negotiated in this player's handshake. */
+    pub capabilities: u32,
 }
 
 impl Player {
@@ -24,6 +31,8 @@ impl Player {
             last_seen: now,
             connected_at: now,
             last_puppet_state: None,
+            last_puppet_delta: None,
+            capabilities: 0,
         }
     }
 
@@ -6,6 +6,9 @@ pub enum PacketType {
     PlayerDisconnected = 4,
     Ping = 5,
     Pong = 6,
+    HandshakeAccepted = 7,
+    StateDigestBuckets = 8,
+    FullSyncBucketsRequest = 9,
     FullSyncRequest = 10,
     NoteSaveData = 11,
     InitialSaveDataRequest = 12,
@@ -15,8 +18,16 @@ pub enum PacketType {
     MumboScore = 16,
     HoneycombCollected = 17,
     MumboTokenCollected = 18,
+    ProgressBits = 19,
     PuppetUpdate = 20,
     PuppetSyncRequest = 21,
+    PuppetUpdateAck = 22,
+    PuppetUpdateCompact = 23,
+    PuppetUpdateCompactAck = 24,
+    PuppetBaselineAck = 25,
+    HoneycombCollectedCompact = 26,
+    MumboTokenCollectedCompact = 27,
+    Compressed = 28,
     PlayerPosition = 50,
     JiggyCollected = 51,
     NoteCollected = 52,
@@ -25,40 +36,249 @@ pub enum PacketType {
     PlayerInfoRequest = 55,
     PlayerInfoResponse = 56,
     PlayerListUpdate = 57,
+    NoteCollectedCompact = 58,
     ReliableAck = 60,
+    ReliableAckBatch = 61,
+    Bundle = 62,
+    Fragment = 63,
+    StateEvent = 64,
     Unknown = 255,
 }
 
+/**
+ * Size of the coalesced ack block carried by ReliableAckBatch,
+ * PuppetUpdateAck and PuppetUpdateCompactAck.
+ */
+pub const RELIABLE_ACK_BLOCK_SIZE: usize = 12;
+
+/**
+ * Version of the handshake and the packets negotiated through it. Clients
+ * that send no version (and no capabilities) are version 0.
+ */
+pub const PROTOCOL_VERSION: u16 = 1;
+
+/**
+ * Capability bits a client sends in its handshake. The session gets the ones
+ * both sides have, sent back in HandshakeAccepted; a client only uses those,
+ * and the server only sends it packets it has the capability for.
+ */
+pub const CAPABILITY_COMPACT_PUPPETS: u32 = 0x01;
+pub const CAPABILITY_PROGRESS_BITS: u32 = 0x02;
+pub const CAPABILITY_COMPACT_COLLECTIBLES: u32 = 0x04;
+pub const CAPABILITY_COMPRESSION: u32 = 0x08;
+
+/** Everything this server can do. */
+pub const SERVER_CAPABILITIES: u32 = CAPABILITY_COMPACT_PUPPETS
+    | CAPABILITY_PROGRESS_BITS
+    | CAPABILITY_COMPACT_COLLECTIBLES
+    | CAPABILITY_COMPRESSION;
+
+/**
+ * PuppetUpdateCompact payloads start with [u8 shape bits][u8 baseline id].
+ * Without PUPPET_SHAPE_DELTA the rest is a keyframe, which the server acks
+ * with PuppetBaselineAck [u8 baseline id]; with it, the rest is a delta
+ * against the keyframe carrying that id. The server only reads the header.
+ */
+pub const PUPPET_COMPACT_HEADER_SIZE: usize = 2;
+pub const PUPPET_SHAPE_DELTA: u8 = 0x02;
+
+/**
+ * Bundle datagrams carry several messages: [Bundle] then repeated
+ * [u16 LE len][message bytes], each record being a complete standalone
+ * message (type, reliable seq if any, payload). Bundles don't nest.
+ */
+pub const BUNDLE_RECORD_HEADER_SIZE: usize = 2;
+
+/** Largest datagram either side builds without fragmenting. */
+pub const BUNDLE_MTU: usize = 1200;
+
+/**
+ * Reliable messages that don't fit in BUNDLE_MTU are split into Fragment
+ * packets: [u16 LE message id][u16 LE index][u16 LE count][chunk]. Each
+ * fragment is its own reliable packet, and the chunks concatenated in index
+ * order give the original [type][payload] message without a reliable seq.
+ */
+pub const FRAGMENT_HEADER_SIZE: usize = 6;
+pub const FRAGMENT_CHUNK_SIZE: usize = 1024;
+pub const FRAGMENT_MAX_MESSAGE_SIZE: usize = 64 * 1024;
+
+/**
+ * Lobby changes reach each client wrapped in a StateEvent:
+ * [u32 LE state seq][type][payload], numbered per session so a client that
+ * reconnects can say how far it got (see session.rs).
+ */
+pub const STATE_EVENT_HEADER_SIZE: usize = 4;
+
+/**
+ * FullSyncRequest can carry a u64 LE digest per category of lobby state the
+ * client already has (STATE_DIGEST_*, see Lobby::state_digests). Categories
+ * whose digest matches the lobby's are left out of the full sync.
+ */
+pub const STATE_DIGEST_NOTES: usize = 0;
+pub const STATE_DIGEST_FILE_PROGRESS: usize = 1;
+pub const STATE_DIGEST_ABILITY_PROGRESS: usize = 2;
+pub const STATE_DIGEST_HONEYCOMB_SCORE: usize = 3;
+pub const STATE_DIGEST_MUMBO_SCORE: usize = 4;
+pub const STATE_DIGEST_JIGGIES: usize = 5;
+pub const STATE_DIGEST_HONEYCOMBS: usize = 6;
+pub const STATE_DIGEST_MUMBO_TOKENS: usize = 7;
+pub const STATE_DIGEST_OPENED_LEVELS: usize = 8;
+pub const STATE_DIGEST_CATEGORIES: usize = 9;
+
+/**
+ * The set categories (everything but the progress blobs, which only ever go
+ * whole) split into buckets by an item's first half: the level slot for
+ * notes, the map for honeycombs and tokens. A category's digest is the sum
+ * of its bucket digests. When it differs, the server answers with
+ * StateDigestBuckets [u8 category][u64 LE digest per bucket] and the client
+ * asks for the buckets that differ with FullSyncBucketsRequest
+ * [u8 category][u16 LE bucket mask].
+ */
+pub const STATE_DIGEST_BUCKETS: usize = 16;
+
+pub fn state_digest_bucket(a: i32) -> usize {
+    (a as u32 as usize) % STATE_DIGEST_BUCKETS
+}
+
+pub fn state_digest_is_bucketed(category: usize) -> bool {
+    matches!(
+        category,
+        STATE_DIGEST_NOTES
+            | STATE_DIGEST_JIGGIES
+            | STATE_DIGEST_HONEYCOMBS
+            | STATE_DIGEST_MUMBO_TOKENS
+            | STATE_DIGEST_OPENED_LEVELS
+    )
+}
+
+/**
+ * Hash of one (a, b) item of a digest category (splitmix64 of the pair);
+ * a category's digest is the wrapping sum over its set of items. Must match
+ * StateDigestItem in the client's lib_state_digest.h.
+ */
+pub fn state_digest_item(a: i32, b: i32) -> u64 {
+    let mut z = ((a as u32 as u64) << 32) | (b as u32 as u64);
+    z = z.wrapping_add(0x9E3779B97F4A7C15);
+    z = (z ^ (z >> 30)).wrapping_mul(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)).wrapping_mul(0x94D049BB133111EB);
+    z ^ (z >> 31)
+}
+
+/**
+ * Per-type protocol properties. This is the one place the server records
+ * them; it mirrors PacketTable::ROWS in the client's lib_packet_table.cpp.
+ */
+#[derive(Debug, Clone, Copy)]
+pub struct PacketDescriptor {
+    pub packet_type: PacketType,
+    /** Carries a 4-byte LE sequence after the type byte and must be acked. */
+    pub reliable: bool,
+    /**
+     * Broadcasts of this type change lobby state, so they're journaled per
+     * session and sent as StateEvents.
+     */
+    pub lobby_state: bool,
+}
+
+const fn row(packet_type: PacketType, reliable: bool, lobby_state: bool) -> PacketDescriptor {
+    PacketDescriptor {
+        packet_type,
+        reliable,
+        lobby_state,
+    }
+}
+
+const PACKET_ROWS: [PacketDescriptor; 41] = [
+    row(PacketType::Handshake, false, false),
+    row(PacketType::PlayerConnected, false, false),
+    row(PacketType::PlayerDisconnected, false, false),
+    row(PacketType::Ping, false, false),
+    row(PacketType::Pong, false, false),
+    row(PacketType::HandshakeAccepted, true, false),
+    row(PacketType::StateDigestBuckets, true, false),
+    row(PacketType::FullSyncBucketsRequest, true, false),
+    row(PacketType::FullSyncRequest, true, false),
+    row(PacketType::NoteSaveData, true, true),
+    row(PacketType::InitialSaveDataRequest, false, false),
+    row(PacketType::FileProgressFlags, true, true),
+    row(PacketType::AbilityProgress, true, true),
+    row(PacketType::HoneycombScore, true, true),
+    row(PacketType::MumboScore, true, true),
+    row(PacketType::HoneycombCollected, true, true),
+    row(PacketType::MumboTokenCollected, true, true),
+    row(PacketType::ProgressBits, true, true),
+    row(PacketType::PuppetUpdate, false, false),
+    row(PacketType::PuppetSyncRequest, false, false),
+    row(PacketType::PuppetUpdateAck, false, false),
+    row(PacketType::PuppetUpdateCompact, false, false),
+    row(PacketType::PuppetUpdateCompactAck, false, false),
+    row(PacketType::PuppetBaselineAck, false, false),
+    row(PacketType::HoneycombCollectedCompact, true, true),
+    row(PacketType::MumboTokenCollectedCompact, true, true),
+    row(PacketType::Compressed, true, false),
+    row(PacketType::PlayerPosition, false, false),
+    row(PacketType::JiggyCollected, true, true),
+    row(PacketType::NoteCollected, true, true),
+    row(PacketType::NoteCollectedPos, true, true),
+    row(PacketType::LevelOpened, true, true),
+    row(PacketType::PlayerInfoRequest, false, false),
+    row(PacketType::PlayerInfoResponse, false, false),
+    row(PacketType::PlayerListUpdate, false, false),
+    row(PacketType::NoteCollectedCompact, true, true),
+    row(PacketType::ReliableAck, false, false),
+    row(PacketType::ReliableAckBatch, false, false),
+    row(PacketType::Bundle, false, false),
+    row(PacketType::Fragment, true, false),
+    row(PacketType::StateEvent, true, false),
+];
+
+const fn build_packet_table() -> [PacketDescriptor; 256] {
+    let mut table = [row(PacketType::Unknown, false, false); 256];
+    let mut i = 0;
+    while i < PACKET_ROWS.len() {
+        table[PACKET_ROWS[i].packet_type as usize] = PACKET_ROWS[i];
+        i += 1;
+    }
+    table
+}
+
+/** Rows spread out by type byte; anything not listed maps to Unknown. */
+static PACKETS_BY_TYPE: [PacketDescriptor; 256] = build_packet_table();
+
+impl PacketType {
+    pub fn descriptor(self) -> &'static PacketDescriptor {
+        &PACKETS_BY_TYPE[self as usize]
+    }
+
+    pub fn is_reliable(self) -> bool {
+        self.descriptor().reliable
+    }
+
+    pub fn is_lobby_state(self) -> bool {
+        self.descriptor().lobby_state
+    }
+
+    /**
+     * Bulk state that can travel as Compressed [u8 inner type][varint size]
+     * [packed payload] between peers with CAPABILITY_COMPRESSION (see
+     * compress.rs). Either side may send it, and it's handled exactly as the
+     * inner packet would have been.
+     */
+    pub fn is_compressible(self) -> bool {
+        matches!(
+            self,
+            PacketType::NoteSaveData
+                | PacketType::FileProgressFlags
+                | PacketType::AbilityProgress
+                | PacketType::HoneycombScore
+                | PacketType::MumboScore
+        )
+    }
+}
+
 impl From<u8> for PacketType {
     fn from(val: u8) -> Self {
-        match val {
-            1 => PacketType::Handshake,
-            3 => PacketType::PlayerConnected,
-            4 => PacketType::PlayerDisconnected,
-            5 => PacketType::Ping,
-            6 => PacketType::Pong,
-            10 => PacketType::FullSyncRequest,
-            11 => PacketType::NoteSaveData,
-            12 => PacketType::InitialSaveDataRequest,
-            13 => PacketType::FileProgressFlags,
-            14 => PacketType::AbilityProgress,
-            15 => PacketType::HoneycombScore,
-            16 => PacketType::MumboScore,
-            17 => PacketType::HoneycombCollected,
-            18 => PacketType::MumboTokenCollected,
-            20 => PacketType::PuppetUpdate,
-            21 => PacketType::PuppetSyncRequest,
-            50 => PacketType::PlayerPosition,
-            51 => PacketType::JiggyCollected,
-            52 => PacketType::NoteCollected,
-            53 => PacketType::NoteCollectedPos,
-            54 => PacketType::LevelOpened,
-            55 => PacketType::PlayerInfoRequest,
-            56 => PacketType::PlayerInfoResponse,
-            57 => PacketType::PlayerListUpdate,
-            60 => PacketType::ReliableAck,
-            _ => PacketType::Unknown,
-        }
+        PACKETS_BY_TYPE[val as usize].packet_type
     }
 }
 
@@ -0,0 +1,1013 @@
+// Generated by protocol/packetgen.py from protocol/packets.schema; edit that
+// and rerun the generator instead of changing this file.
+//
+// For each packet made of fixed-size fields, a <Packet>View reading the fields
+// straight out of the payload and an encode_<packet> appending one to a buffer.
+
+#![allow(dead_code)]
+
+use anyhow::{anyhow, Result};
+
+/** JiggyPacket, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct JiggyPacketView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> JiggyPacketView<'a> {
+    pub const SIZE: usize = 8;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid JiggyPacket: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn jiggy_enum_id(&self) -> i32 {
+        i32::from_le_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn collected_value(&self) -> i32 {
+        i32::from_le_bytes([self.data[4], self.data[5], self.data[6], self.data[7]])
+    }
+}
+
+/** Appends a JiggyPacket in its wire layout. */
+pub fn encode_jiggy_packet(buf: &mut Vec<u8>, jiggy_enum_id: i32, collected_value: i32) {
+    buf.extend_from_slice(&jiggy_enum_id.to_le_bytes());
+    buf.extend_from_slice(&collected_value.to_le_bytes());
+}
+
+/** NotePacket, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct NotePacketView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> NotePacketView<'a> {
+    pub const SIZE: usize = 13;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid NotePacket: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn map_id(&self) -> i32 {
+        i32::from_le_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn level_id(&self) -> i32 {
+        i32::from_le_bytes([self.data[4], self.data[5], self.data[6], self.data[7]])
+    }
+
+    pub fn is_dynamic(&self) -> u8 {
+        self.data[8]
+    }
+
+    pub fn note_index(&self) -> i32 {
+        i32::from_le_bytes([self.data[9], self.data[10], self.data[11], self.data[12]])
+    }
+}
+
+/** Appends a NotePacket in its wire layout. */
+pub fn encode_note_packet(
+    buf: &mut Vec<u8>,
+    map_id: i32,
+    level_id: i32,
+    is_dynamic: u8,
+    note_index: i32,
+) {
+    buf.extend_from_slice(&map_id.to_le_bytes());
+    buf.extend_from_slice(&level_id.to_le_bytes());
+    buf.push(is_dynamic);
+    buf.extend_from_slice(&note_index.to_le_bytes());
+}
+
+/** NotePacketPos, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct NotePacketPosView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> NotePacketPosView<'a> {
+    pub const SIZE: usize = 10;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid NotePacketPos: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn map_id(&self) -> i32 {
+        i32::from_le_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn x(&self) -> i16 {
+        i16::from_le_bytes([self.data[4], self.data[5]])
+    }
+
+    pub fn y(&self) -> i16 {
+        i16::from_le_bytes([self.data[6], self.data[7]])
+    }
+
+    pub fn z(&self) -> i16 {
+        i16::from_le_bytes([self.data[8], self.data[9]])
+    }
+}
+
+/** Appends a NotePacketPos in its wire layout. */
+pub fn encode_note_packet_pos(buf: &mut Vec<u8>, map_id: i32, x: i16, y: i16, z: i16) {
+    buf.extend_from_slice(&map_id.to_le_bytes());
+    buf.extend_from_slice(&x.to_le_bytes());
+    buf.extend_from_slice(&y.to_le_bytes());
+    buf.extend_from_slice(&z.to_le_bytes());
+}
+
+/** LevelOpenedPacket, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct LevelOpenedPacketView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> LevelOpenedPacketView<'a> {
+    pub const SIZE: usize = 8;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid LevelOpenedPacket: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn world_id(&self) -> i32 {
+        i32::from_le_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn jiggy_cost(&self) -> i32 {
+        i32::from_le_bytes([self.data[4], self.data[5], self.data[6], self.data[7]])
+    }
+}
+
+/** Appends a LevelOpenedPacket in its wire layout. */
+pub fn encode_level_opened_packet(buf: &mut Vec<u8>, world_id: i32, jiggy_cost: i32) {
+    buf.extend_from_slice(&world_id.to_le_bytes());
+    buf.extend_from_slice(&jiggy_cost.to_le_bytes());
+}
+
+/** HoneycombCollectedPacket, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct HoneycombCollectedPacketView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> HoneycombCollectedPacketView<'a> {
+    pub const SIZE: usize = 20;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid HoneycombCollectedPacket: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn map_id(&self) -> i32 {
+        i32::from_le_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn honeycomb_id(&self) -> i32 {
+        i32::from_le_bytes([self.data[4], self.data[5], self.data[6], self.data[7]])
+    }
+
+    pub fn x(&self) -> i32 {
+        i32::from_le_bytes([self.data[8], self.data[9], self.data[10], self.data[11]])
+    }
+
+    pub fn y(&self) -> i32 {
+        i32::from_le_bytes([self.data[12], self.data[13], self.data[14], self.data[15]])
+    }
+
+    pub fn z(&self) -> i32 {
+        i32::from_le_bytes([self.data[16], self.data[17], self.data[18], self.data[19]])
+    }
+}
+
+/** Appends a HoneycombCollectedPacket in its wire layout. */
+pub fn encode_honeycomb_collected_packet(
+    buf: &mut Vec<u8>,
+    map_id: i32,
+    honeycomb_id: i32,
+    x: i32,
+    y: i32,
+    z: i32,
+) {
+    buf.extend_from_slice(&map_id.to_le_bytes());
+    buf.extend_from_slice(&honeycomb_id.to_le_bytes());
+    buf.extend_from_slice(&x.to_le_bytes());
+    buf.extend_from_slice(&y.to_le_bytes());
+    buf.extend_from_slice(&z.to_le_bytes());
+}
+
+/** MumboTokenCollectedPacket, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct MumboTokenCollectedPacketView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> MumboTokenCollectedPacketView<'a> {
+    pub const SIZE: usize = 20;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid MumboTokenCollectedPacket: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn map_id(&self) -> i32 {
+        i32::from_le_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn token_id(&self) -> i32 {
+        i32::from_le_bytes([self.data[4], self.data[5], self.data[6], self.data[7]])
+    }
+
+    pub fn x(&self) -> i32 {
+        i32::from_le_bytes([self.data[8], self.data[9], self.data[10], self.data[11]])
+    }
+
+    pub fn y(&self) -> i32 {
+        i32::from_le_bytes([self.data[12], self.data[13], self.data[14], self.data[15]])
+    }
+
+    pub fn z(&self) -> i32 {
+        i32::from_le_bytes([self.data[16], self.data[17], self.data[18], self.data[19]])
+    }
+}
+
+/** Appends a MumboTokenCollectedPacket in its wire layout. */
+pub fn encode_mumbo_token_collected_packet(
+    buf: &mut Vec<u8>,
+    map_id: i32,
+    token_id: i32,
+    x: i32,
+    y: i32,
+    z: i32,
+) {
+    buf.extend_from_slice(&map_id.to_le_bytes());
+    buf.extend_from_slice(&token_id.to_le_bytes());
+    buf.extend_from_slice(&x.to_le_bytes());
+    buf.extend_from_slice(&y.to_le_bytes());
+    buf.extend_from_slice(&z.to_le_bytes());
+}
+
+/** HandshakeAcceptedPacket, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct HandshakeAcceptedPacketView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> HandshakeAcceptedPacketView<'a> {
+    pub const SIZE: usize = 17;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid HandshakeAcceptedPacket: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn player_id(&self) -> u32 {
+        u32::from_be_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn session_token(&self) -> u64 {
+        u64::from_be_bytes([
+            self.data[4],
+            self.data[5],
+            self.data[6],
+            self.data[7],
+            self.data[8],
+            self.data[9],
+            self.data[10],
+            self.data[11],
+        ])
+    }
+
+    pub fn state_seq(&self) -> u32 {
+        u32::from_be_bytes([self.data[12], self.data[13], self.data[14], self.data[15]])
+    }
+
+    pub fn resumed(&self) -> u8 {
+        self.data[16]
+    }
+}
+
+/** Appends a HandshakeAcceptedPacket in its wire layout. */
+pub fn encode_handshake_accepted_packet(
+    buf: &mut Vec<u8>,
+    player_id: u32,
+    session_token: u64,
+    state_seq: u32,
+    resumed: u8,
+) {
+    buf.extend_from_slice(&player_id.to_be_bytes());
+    buf.extend_from_slice(&session_token.to_be_bytes());
+    buf.extend_from_slice(&state_seq.to_be_bytes());
+    buf.push(resumed);
+}
+
+/** level and map go out in the opposite order to the struct */
+/** PuppetUpdatePacket, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct PuppetUpdatePacketView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> PuppetUpdatePacketView<'a> {
+    pub const SIZE: usize = 42;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid PuppetUpdatePacket: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn x(&self) -> f32 {
+        f32::from_be_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn y(&self) -> f32 {
+        f32::from_be_bytes([self.data[4], self.data[5], self.data[6], self.data[7]])
+    }
+
+    pub fn z(&self) -> f32 {
+        f32::from_be_bytes([self.data[8], self.data[9], self.data[10], self.data[11]])
+    }
+
+    pub fn yaw(&self) -> f32 {
+        f32::from_be_bytes([self.data[12], self.data[13], self.data[14], self.data[15]])
+    }
+
+    pub fn pitch(&self) -> f32 {
+        f32::from_be_bytes([self.data[16], self.data[17], self.data[18], self.data[19]])
+    }
+
+    pub fn roll(&self) -> f32 {
+        f32::from_be_bytes([self.data[20], self.data[21], self.data[22], self.data[23]])
+    }
+
+    pub fn anim_duration(&self) -> f32 {
+        f32::from_be_bytes([self.data[24], self.data[25], self.data[26], self.data[27]])
+    }
+
+    pub fn anim_timer(&self) -> f32 {
+        f32::from_be_bytes([self.data[28], self.data[29], self.data[30], self.data[31]])
+    }
+
+    pub fn level_id(&self) -> i16 {
+        i16::from_be_bytes([self.data[32], self.data[33]])
+    }
+
+    pub fn map_id(&self) -> i16 {
+        i16::from_be_bytes([self.data[34], self.data[35]])
+    }
+
+    pub fn anim_id(&self) -> i16 {
+        i16::from_be_bytes([self.data[36], self.data[37]])
+    }
+
+    pub fn model_id(&self) -> u8 {
+        self.data[38]
+    }
+
+    pub fn flags(&self) -> u8 {
+        self.data[39]
+    }
+
+    pub fn playback_type(&self) -> u8 {
+        self.data[40]
+    }
+
+    pub fn playback_direction(&self) -> u8 {
+        self.data[41]
+    }
+}
+
+/** Appends a PuppetUpdatePacket in its wire layout. */
+#[allow(clippy::too_many_arguments)]
+pub fn encode_puppet_update_packet(
+    buf: &mut Vec<u8>,
+    x: f32,
+    y: f32,
+    z: f32,
+    yaw: f32,
+    pitch: f32,
+    roll: f32,
+    anim_duration: f32,
+    anim_timer: f32,
+    level_id: i16,
+    map_id: i16,
+    anim_id: i16,
+    model_id: u8,
+    flags: u8,
+    playback_type: u8,
+    playback_direction: u8,
+) {
+    buf.extend_from_slice(&x.to_be_bytes());
+    buf.extend_from_slice(&y.to_be_bytes());
+    buf.extend_from_slice(&z.to_be_bytes());
+    buf.extend_from_slice(&yaw.to_be_bytes());
+    buf.extend_from_slice(&pitch.to_be_bytes());
+    buf.extend_from_slice(&roll.to_be_bytes());
+    buf.extend_from_slice(&anim_duration.to_be_bytes());
+    buf.extend_from_slice(&anim_timer.to_be_bytes());
+    buf.extend_from_slice(&level_id.to_be_bytes());
+    buf.extend_from_slice(&map_id.to_be_bytes());
+    buf.extend_from_slice(&anim_id.to_be_bytes());
+    buf.push(model_id);
+    buf.push(flags);
+    buf.push(playback_type);
+    buf.push(playback_direction);
+}
+
+/** PuppetUpdateCompactPacket, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct PuppetUpdateCompactPacketView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> PuppetUpdateCompactPacketView<'a> {
+    pub const SIZE: usize = 20;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid PuppetUpdateCompactPacket: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn x(&self) -> i16 {
+        i16::from_be_bytes([self.data[0], self.data[1]])
+    }
+
+    pub fn y(&self) -> i16 {
+        i16::from_be_bytes([self.data[2], self.data[3]])
+    }
+
+    pub fn z(&self) -> i16 {
+        i16::from_be_bytes([self.data[4], self.data[5]])
+    }
+
+    pub fn yaw(&self) -> u16 {
+        u16::from_be_bytes([self.data[6], self.data[7]])
+    }
+
+    pub fn anim_duration_ms(&self) -> u16 {
+        u16::from_be_bytes([self.data[8], self.data[9]])
+    }
+
+    pub fn anim_timer(&self) -> u16 {
+        u16::from_be_bytes([self.data[10], self.data[11]])
+    }
+
+    pub fn level_id(&self) -> u8 {
+        self.data[12]
+    }
+
+    pub fn map_id(&self) -> u8 {
+        self.data[13]
+    }
+
+    pub fn anim_id(&self) -> u16 {
+        u16::from_be_bytes([self.data[14], self.data[15]])
+    }
+
+    pub fn model_id(&self) -> u8 {
+        self.data[16]
+    }
+
+    pub fn flags(&self) -> u8 {
+        self.data[17]
+    }
+
+    pub fn playback_type(&self) -> u8 {
+        self.data[18]
+    }
+
+    pub fn playback_direction(&self) -> u8 {
+        self.data[19]
+    }
+}
+
+/** Appends a PuppetUpdateCompactPacket in its wire layout. */
+#[allow(clippy::too_many_arguments)]
+pub fn encode_puppet_update_compact_packet(
+    buf: &mut Vec<u8>,
+    x: i16,
+    y: i16,
+    z: i16,
+    yaw: u16,
+    anim_duration_ms: u16,
+    anim_timer: u16,
+    level_id: u8,
+    map_id: u8,
+    anim_id: u16,
+    model_id: u8,
+    flags: u8,
+    playback_type: u8,
+    playback_direction: u8,
+) {
+    buf.extend_from_slice(&x.to_be_bytes());
+    buf.extend_from_slice(&y.to_be_bytes());
+    buf.extend_from_slice(&z.to_be_bytes());
+    buf.extend_from_slice(&yaw.to_be_bytes());
+    buf.extend_from_slice(&anim_duration_ms.to_be_bytes());
+    buf.extend_from_slice(&anim_timer.to_be_bytes());
+    buf.push(level_id);
+    buf.push(map_id);
+    buf.extend_from_slice(&anim_id.to_be_bytes());
+    buf.push(model_id);
+    buf.push(flags);
+    buf.push(playback_type);
+    buf.push(playback_direction);
+}
+
+/** BroadcastJiggy, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct BroadcastJiggyView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> BroadcastJiggyView<'a> {
+    pub const SIZE: usize = 12;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid BroadcastJiggy: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn player_id(&self) -> u32 {
+        u32::from_be_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn jiggy_enum_id(&self) -> i32 {
+        i32::from_be_bytes([self.data[4], self.data[5], self.data[6], self.data[7]])
+    }
+
+    pub fn collected_value(&self) -> i32 {
+        i32::from_be_bytes([self.data[8], self.data[9], self.data[10], self.data[11]])
+    }
+}
+
+/** Appends a BroadcastJiggy in its wire layout. */
+pub fn encode_broadcast_jiggy(
+    buf: &mut Vec<u8>,
+    player_id: u32,
+    jiggy_enum_id: i32,
+    collected_value: i32,
+) {
+    buf.extend_from_slice(&player_id.to_be_bytes());
+    buf.extend_from_slice(&jiggy_enum_id.to_be_bytes());
+    buf.extend_from_slice(&collected_value.to_be_bytes());
+}
+
+/** BroadcastNote, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct BroadcastNoteView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> BroadcastNoteView<'a> {
+    pub const SIZE: usize = 20;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid BroadcastNote: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn player_id(&self) -> u32 {
+        u32::from_be_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn map_id(&self) -> i32 {
+        i32::from_be_bytes([self.data[4], self.data[5], self.data[6], self.data[7]])
+    }
+
+    pub fn level_id(&self) -> i32 {
+        i32::from_be_bytes([self.data[8], self.data[9], self.data[10], self.data[11]])
+    }
+
+    pub fn is_dynamic(&self) -> i32 {
+        i32::from_be_bytes([self.data[12], self.data[13], self.data[14], self.data[15]])
+    }
+
+    pub fn note_index(&self) -> i32 {
+        i32::from_be_bytes([self.data[16], self.data[17], self.data[18], self.data[19]])
+    }
+}
+
+/** Appends a BroadcastNote in its wire layout. */
+pub fn encode_broadcast_note(
+    buf: &mut Vec<u8>,
+    player_id: u32,
+    map_id: i32,
+    level_id: i32,
+    is_dynamic: i32,
+    note_index: i32,
+) {
+    buf.extend_from_slice(&player_id.to_be_bytes());
+    buf.extend_from_slice(&map_id.to_be_bytes());
+    buf.extend_from_slice(&level_id.to_be_bytes());
+    buf.extend_from_slice(&is_dynamic.to_be_bytes());
+    buf.extend_from_slice(&note_index.to_be_bytes());
+}
+
+/** BroadcastNotePos, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct BroadcastNotePosView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> BroadcastNotePosView<'a> {
+    pub const SIZE: usize = 20;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid BroadcastNotePos: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn player_id(&self) -> u32 {
+        u32::from_be_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn map_id(&self) -> i32 {
+        i32::from_be_bytes([self.data[4], self.data[5], self.data[6], self.data[7]])
+    }
+
+    pub fn x(&self) -> i32 {
+        i32::from_be_bytes([self.data[8], self.data[9], self.data[10], self.data[11]])
+    }
+
+    pub fn y(&self) -> i32 {
+        i32::from_be_bytes([self.data[12], self.data[13], self.data[14], self.data[15]])
+    }
+
+    pub fn z(&self) -> i32 {
+        i32::from_be_bytes([self.data[16], self.data[17], self.data[18], self.data[19]])
+    }
+}
+
+/** Appends a BroadcastNotePos in its wire layout. */
+pub fn encode_broadcast_note_pos(
+    buf: &mut Vec<u8>,
+    player_id: u32,
+    map_id: i32,
+    x: i32,
+    y: i32,
+    z: i32,
+) {
+    buf.extend_from_slice(&player_id.to_be_bytes());
+    buf.extend_from_slice(&map_id.to_be_bytes());
+    buf.extend_from_slice(&x.to_be_bytes());
+    buf.extend_from_slice(&y.to_be_bytes());
+    buf.extend_from_slice(&z.to_be_bytes());
+}
+
+/** BroadcastLevelOpened, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct BroadcastLevelOpenedView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> BroadcastLevelOpenedView<'a> {
+    pub const SIZE: usize = 12;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid BroadcastLevelOpened: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn player_id(&self) -> u32 {
+        u32::from_be_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn world_id(&self) -> i32 {
+        i32::from_be_bytes([self.data[4], self.data[5], self.data[6], self.data[7]])
+    }
+
+    pub fn jiggy_cost(&self) -> i32 {
+        i32::from_be_bytes([self.data[8], self.data[9], self.data[10], self.data[11]])
+    }
+}
+
+/** Appends a BroadcastLevelOpened in its wire layout. */
+pub fn encode_broadcast_level_opened(
+    buf: &mut Vec<u8>,
+    player_id: u32,
+    world_id: i32,
+    jiggy_cost: i32,
+) {
+    buf.extend_from_slice(&player_id.to_be_bytes());
+    buf.extend_from_slice(&world_id.to_be_bytes());
+    buf.extend_from_slice(&jiggy_cost.to_be_bytes());
+}
+
+/** BroadcastHoneycomb, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct BroadcastHoneycombView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> BroadcastHoneycombView<'a> {
+    pub const SIZE: usize = 24;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid BroadcastHoneycomb: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn player_id(&self) -> u32 {
+        u32::from_be_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn map_id(&self) -> i32 {
+        i32::from_be_bytes([self.data[4], self.data[5], self.data[6], self.data[7]])
+    }
+
+    pub fn honeycomb_id(&self) -> i32 {
+        i32::from_be_bytes([self.data[8], self.data[9], self.data[10], self.data[11]])
+    }
+
+    pub fn x(&self) -> i32 {
+        i32::from_be_bytes([self.data[12], self.data[13], self.data[14], self.data[15]])
+    }
+
+    pub fn y(&self) -> i32 {
+        i32::from_be_bytes([self.data[16], self.data[17], self.data[18], self.data[19]])
+    }
+
+    pub fn z(&self) -> i32 {
+        i32::from_be_bytes([self.data[20], self.data[21], self.data[22], self.data[23]])
+    }
+}
+
+/** Appends a BroadcastHoneycomb in its wire layout. */
+pub fn encode_broadcast_honeycomb(
+    buf: &mut Vec<u8>,
+    player_id: u32,
+    map_id: i32,
+    honeycomb_id: i32,
+    x: i32,
+    y: i32,
+    z: i32,
+) {
+    buf.extend_from_slice(&player_id.to_be_bytes());
+    buf.extend_from_slice(&map_id.to_be_bytes());
+    buf.extend_from_slice(&honeycomb_id.to_be_bytes());
+    buf.extend_from_slice(&x.to_be_bytes());
+    buf.extend_from_slice(&y.to_be_bytes());
+    buf.extend_from_slice(&z.to_be_bytes());
+}
+
+/** BroadcastMumboToken, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct BroadcastMumboTokenView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> BroadcastMumboTokenView<'a> {
+    pub const SIZE: usize = 24;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid BroadcastMumboToken: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn player_id(&self) -> u32 {
+        u32::from_be_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn map_id(&self) -> i32 {
+        i32::from_be_bytes([self.data[4], self.data[5], self.data[6], self.data[7]])
+    }
+
+    pub fn token_id(&self) -> i32 {
+        i32::from_be_bytes([self.data[8], self.data[9], self.data[10], self.data[11]])
+    }
+
+    pub fn x(&self) -> i32 {
+        i32::from_be_bytes([self.data[12], self.data[13], self.data[14], self.data[15]])
+    }
+
+    pub fn y(&self) -> i32 {
+        i32::from_be_bytes([self.data[16], self.data[17], self.data[18], self.data[19]])
+    }
+
+    pub fn z(&self) -> i32 {
+        i32::from_be_bytes([self.data[20], self.data[21], self.data[22], self.data[23]])
+    }
+}
+
+/** Appends a BroadcastMumboToken in its wire layout. */
+pub fn encode_broadcast_mumbo_token(
+    buf: &mut Vec<u8>,
+    player_id: u32,
+    map_id: i32,
+    token_id: i32,
+    x: i32,
+    y: i32,
+    z: i32,
+) {
+    buf.extend_from_slice(&player_id.to_be_bytes());
+    buf.extend_from_slice(&map_id.to_be_bytes());
+    buf.extend_from_slice(&token_id.to_be_bytes());
+    buf.extend_from_slice(&x.to_be_bytes());
+    buf.extend_from_slice(&y.to_be_bytes());
+    buf.extend_from_slice(&z.to_be_bytes());
+}
+
+/** PlayerInfoRequestPacket, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct PlayerInfoRequestPacketView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> PlayerInfoRequestPacketView<'a> {
+    pub const SIZE: usize = 8;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid PlayerInfoRequestPacket: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn target_player_id(&self) -> u32 {
+        u32::from_be_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn requester_player_id(&self) -> u32 {
+        u32::from_be_bytes([self.data[4], self.data[5], self.data[6], self.data[7]])
+    }
+}
+
+/** Appends a PlayerInfoRequestPacket in its wire layout. */
+pub fn encode_player_info_request_packet(
+    buf: &mut Vec<u8>,
+    target_player_id: u32,
+    requester_player_id: u32,
+) {
+    buf.extend_from_slice(&target_player_id.to_be_bytes());
+    buf.extend_from_slice(&requester_player_id.to_be_bytes());
+}
+
+/** PlayerInfoResponsePacket, read in place. */
+#[derive(Debug, Clone, Copy)]
+pub struct PlayerInfoResponsePacketView<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> PlayerInfoResponsePacketView<'a> {
+    pub const SIZE: usize = 24;
+
+    pub fn new(data: &'a [u8]) -> Result<Self> {
+        if data.len() < Self::SIZE {
+            return Err(anyhow!(
+                "Invalid PlayerInfoResponsePacket: expected {} bytes, got {}",
+                Self::SIZE,
+                data.len()
+            ));
+        }
+        Ok(Self { data })
+    }
+
+    pub fn target_player_id(&self) -> u32 {
+        u32::from_be_bytes([self.data[0], self.data[1], self.data[2], self.data[3]])
+    }
+
+    pub fn map_id(&self) -> i16 {
+        i16::from_be_bytes([self.data[4], self.data[5]])
+    }
+
+    pub fn level_id(&self) -> i16 {
+        i16::from_be_bytes([self.data[6], self.data[7]])
+    }
+
+    pub fn x(&self) -> f32 {
+        f32::from_be_bytes([self.data[8], self.data[9], self.data[10], self.data[11]])
+    }
+
+    pub fn y(&self) -> f32 {
+        f32::from_be_bytes([self.data[12], self.data[13], self.data[14], self.data[15]])
+    }
+
+    pub fn z(&self) -> f32 {
+        f32::from_be_bytes([self.data[16], self.data[17], self.data[18], self.data[19]])
+    }
+
+    pub fn yaw(&self) -> f32 {
+        f32::from_be_bytes([self.data[20], self.data[21], self.data[22], self.data[23]])
+    }
+}
+
+/** Appends a PlayerInfoResponsePacket in its wire layout. */
+#[allow(clippy::too_many_arguments)]
+pub fn encode_player_info_response_packet(
+    buf: &mut Vec<u8>,
+    target_player_id: u32,
+    map_id: i16,
+    level_id: i16,
+    x: f32,
+    y: f32,
+    z: f32,
+    yaw: f32,
+) {
+    buf.extend_from_slice(&target_player_id.to_be_bytes());
+    buf.extend_from_slice(&map_id.to_be_bytes());
+    buf.extend_from_slice(&level_id.to_be_bytes());
+    buf.extend_from_slice(&x.to_be_bytes());
+    buf.extend_from_slice(&y.to_be_bytes());
+    buf.extend_from_slice(&z.to_be_bytes());
+    buf.extend_from_slice(&yaw.to_be_bytes());
+}
@@ -0,0 +1,120 @@
+use std::collections::VecDeque;
+use std::net::SocketAddr;
+use std::time::Instant;
+
+use crate::protocol::PacketType;
+
+// lobby changes kept per session for replaying to a client that drops and comes back.
+// a client that missed more than this gets a full sync instead
+const SESSION_JOURNAL_LEN: usize = 1024;
+
+/**
+ * One lobby change as it was sent to a session, kept so it can be sent again.
+ */
+#[derive(Debug, Clone)]
+pub struct JournalEntry {
+    pub state_seq: u32,
+    pub packet_type: PacketType,
+    pub payload: Vec<u8>,
+}
+
+/**
+ * A client's stay in a lobby, identified by the token handed out at handshake.
+ * Outlives the player entry (which goes away when the client times out) so a
+ * client that comes back can pick up where it left off. Every lobby change
+ * the client should see is numbered and journaled here, whether the client is
+ * currently reachable or not.
+ */
+#[derive(Debug, Clone)]
+pub struct Session {
+    pub token: u64,
+    pub lobby_name: String,
+    pub username: String,
+    pub player_id: u32,
+    pub address: SocketAddr,
+
+    /**
+     * Set while no player is bound to this session, cleared when it resumes
+     */
+    pub detached_at: Option<Instant>,
+
+    last_state_seq: u32,
+    journal: VecDeque<JournalEntry>,
+}
+
+impl Session {
+    pub fn new(
+        token: u64,
+        lobby_name: String,
+        username: String,
+        player_id: u32,
+        address: SocketAddr,
+    ) -> Self {
+        Self {
+            token,
+            lobby_name,
+            username,
+            player_id,
+            address,
+            detached_at: None,
+            last_state_seq: 0,
+            journal: VecDeque::new(),
+        }
+    }
+
+    pub fn last_state_seq(&self) -> u32 {
+        self.last_state_seq
+    }
+
+    /**
+     * Numbers a lobby change for this session and journals it.
+     * Returns the state seq the client will see it under.
+     */
+    pub fn record(&mut self, packet_type: PacketType, payload: &[u8]) -> u32 {
+        self.last_state_seq = self.last_state_seq.wrapping_add(1);
+
+        if self.journal.len() >= SESSION_JOURNAL_LEN {
+            self.journal.pop_front();
+        }
+
+        self.journal.push_back(JournalEntry {
+            state_seq: self.last_state_seq,
+            packet_type,
+            payload: payload.to_vec(),
+        });
+
+        self.last_state_seq
+    }
+
+    /**
+     * Everything after the client's last applied state seq, or None when the
+     * journal doesn't reach back that far (or the seq is one we never issued).
+     */
+    pub fn entries_after(&self, applied: u32) -> Option<Vec<JournalEntry>> {
+        if applied > self.last_state_seq {
+            return None;
+        }
+
+        let oldest = self
+            .journal
+            .front()
+            .map_or(self.last_state_seq + 1, |e| e.state_seq);
+
+        if applied + 1 < oldest {
+            return None;
+        }
+
+        Some(
+            self.journal
+                .iter()
+                .filter(|e| e.state_seq > applied)
+                .cloned()
+                .collect(),
+        )
+    }
+
+    pub fn is_expired(&self, timeout_secs: u64) -> bool {
+        self.detached_at
+            .map_or(false, |t| t.elapsed().as_secs() >= timeout_secs)
+    }
+}
@@ -1,7 +1,7 @@
 use anyhow::Result;
 use dashmap::DashMap;
 use std::net::SocketAddr;
-use std::sync::atomic::{AtomicU32, Ordering};
+use std::sync::atomic::{AtomicU32, AtomicU64, Ordering};
 use std::sync::Arc;
 use tokio::sync::RwLock;
 use tracing::{info, warn};
@@ -9,6 +9,19 @@ use tracing::{info, warn};
 use crate::config::Config;
 use crate::lobby::Lobby;
 use crate::player::Player;
+use crate::protocol::PacketType;
+use crate::session::{JournalEntry, Session};
+
+/**
+ * What a handshake carrying a valid session token gets back: the player the
+ * session belonged to and the lobby changes the client hasn't applied yet.
+ */
+pub struct ResumePlan {
+    pub token: u64,
+    pub player_id: u32,
+    pub applied_state_seq: u32,
+    pub missed: Vec<JournalEntry>,
+}
 
 pub struct ServerState {
     config: Config,
@@ -20,6 +33,10 @@ pub struct ServerState {
     addr_to_player: DashMap<SocketAddr, u32>,
 
     next_player_id: AtomicU32,
+
+    sessions: DashMap<u64, Session>,
+
+    session_salt: AtomicU64,
 }
 
 impl ServerState {
@@ -38,6 +55,8 @@ impl ServerState {
             players: DashMap::new(),
             addr_to_player: DashMap::new(),
             next_player_id: AtomicU32::new(1),
+            sessions: DashMap::new(),
+            session_salt: AtomicU64::new(0),
         }
     }
 
@@ -107,6 +126,27 @@ impl ServerState {
         player
     }
 
+    /**
+     * Points an existing player at the address its client came back from.
+     * Returns false if the player has already been timed out and removed.
+     */
+    pub async fn rebind_player(&self, player_id: u32, addr: SocketAddr) -> bool {
+        let player = match self.players.get(&player_id) {
+            Some(p) => p.clone(),
+            None => return false,
+        };
+
+        let mut p = player.write().await;
+        if p.address != addr {
+            self.addr_to_player.remove(&p.address);
+            self.addr_to_player.insert(addr, player_id);
+            p.address = addr;
+        }
+        p.update_last_seen();
+
+        true
+    }
+
     pub fn get_player_by_addr(&self, addr: &SocketAddr) -> Option<Arc<RwLock<Player>>> {
         self.addr_to_player
             .get(addr)
@@ -154,6 +194,154 @@ impl ServerState {
         );
     }
 
+    fn new_session_token(&self) -> u64 {
+        use std::collections::hash_map::RandomState;
+        use std::hash::{BuildHasher, Hasher};
+
+        loop {
+            // RandomState is seeded from the OS, so tokens can't be guessed from
+            // the order players joined in
+            let mut hasher = RandomState::new().build_hasher();
+            hasher.write_u64(self.session_salt.fetch_add(1, Ordering::Relaxed));
+            hasher.write_i64(chrono::Utc::now().timestamp_nanos_opt().unwrap_or_default());
+
+            let token = hasher.finish();
+            if token != 0 && !self.sessions.contains_key(&token) {
+                return token;
+            }
+        }
+    }
+
+    /**
+     * Starts a session for a freshly joined player and returns its token and
+     * current state seq. A repeated handshake from a client that already has
+     * one gets the same session back.
+     */
+    pub fn open_session(
+        &self,
+        lobby_name: &str,
+        username: &str,
+        player_id: u32,
+        addr: SocketAddr,
+    ) -> (u64, u32) {
+        let existing = self.sessions.iter().find_map(|s| {
+            (s.address == addr
+                && s.player_id == player_id
+                && s.lobby_name == lobby_name
+                && s.username == username)
+                .then(|| (s.token, s.last_state_seq()))
+        });
+
+        if let Some(found) = existing {
+            return found;
+        }
+
+        // whatever was bound to this address before belongs to a client that's gone
+        self.sessions.retain(|_, s| s.address != addr);
+
+        let token = self.new_session_token();
+        self.sessions.insert(
+            token,
+            Session::new(
+                token,
+                lobby_name.to_string(),
+                username.to_string(),
+                player_id,
+                addr,
+            ),
+        );
+
+        (token, 0)
+    }
+
+    /**
+     * Looks up a session a reconnecting client wants back. None if the token
+     * is unknown or expired, belongs to someone else, or the client has missed
+     * more than the journal holds.
+     */
+    pub fn prepare_resume(
+        &self,
+        token: u64,
+        lobby_name: &str,
+        username: &str,
+        applied_state_seq: u32,
+    ) -> Option<ResumePlan> {
+        let session = self.sessions.get(&token)?;
+
+        if session.lobby_name != lobby_name || session.username != username {
+            return None;
+        }
+
+        let missed = session.entries_after(applied_state_seq)?;
+
+        Some(ResumePlan {
+            token,
+            player_id: session.player_id,
+            applied_state_seq,
+            missed,
+        })
+    }
+
+    pub fn attach_session(&self, token: u64, player_id: u32, addr: SocketAddr) {
+        self.sessions
+            .retain(|t, s| *t == token || s.address != addr);
+
+        if let Some(mut session) = self.sessions.get_mut(&token) {
+            session.player_id = player_id;
+            session.address = addr;
+            session.detached_at = None;
+        }
+    }
+
+    fn is_session_attached(&self, session: &Session) -> bool {
+        self.addr_to_player
+            .get(&session.address)
+            .map_or(false, |id| *id == session.player_id)
+    }
+
+    /**
+     * Journals a lobby change for every session in the lobby except the one at
+     * except_addr (whoever caused it). Returns where to send it right now and
+     * under which state seq; detached sessions only get the journal entry.
+     */
+    pub fn journal_state_change(
+        &self,
+        lobby_name: &str,
+        except_addr: SocketAddr,
+        packet_type: PacketType,
+        payload: &[u8],
+    ) -> Vec<(SocketAddr, u32)> {
+        let mut deliveries = Vec::new();
+
+        for mut session in self.sessions.iter_mut() {
+            if session.lobby_name != lobby_name || session.address == except_addr {
+                continue;
+            }
+
+            let state_seq = session.record(packet_type, payload);
+
+            if self.is_session_attached(&session) {
+                deliveries.push((session.address, state_seq));
+            }
+        }
+
+        deliveries
+    }
+
+    pub fn cleanup_expired_sessions(&self) {
+        let timeout = self.config.server.session_resume_seconds;
+
+        for mut session in self.sessions.iter_mut() {
+            if self.is_session_attached(&session) {
+                session.detached_at = None;
+            } else if session.detached_at.is_none() {
+                session.detached_at = Some(std::time::Instant::now());
+            }
+        }
+
+        self.sessions.retain(|_, s| !s.is_expired(timeout));
+    }
+
     pub async fn get_lobby_players_except(
         &self,
         lobby_name: &str,
@@ -0,0 +1,160 @@
+// PackBits/UnpackBits (lib_bulk_compress.h) on the full-sync samples in
+// protocol/full_sync_samples.txt: bytes on the wire with and without the
+// Compressed wrapper, and the time to pack and unpack a whole sync.
+// server/benches/compress.rs measures compress.rs on the same samples.
+//
+//   bench_bulk_compress [samples file]
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "lib_bulk_compress.h"
+
+namespace
+{
+    const int ROUNDS = 20000;
+
+    struct SyncMessage
+    {
+        uint8_t type;
+        std::vector<uint8_t> payload;
+    };
+
+    struct SyncSample
+    {
+        std::string name;
+        std::vector<SyncMessage> messages;
+    };
+
+    // in file order, one sample per name
+    bool LoadSamples(const char *path, std::vector<SyncSample> &samples)
+    {
+        FILE *file = fopen(path, "r");
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        std::map<std::string, size_t> byName;
+        char line[1024];
+        while (fgets(line, sizeof(line), file) != nullptr)
+        {
+            char name[64], hex[900];
+            unsigned type;
+            if (line[0] == '#' || sscanf(line, "%63s %u %899s", name, &type, hex) != 3)
+            {
+                continue;
+            }
+
+            SyncMessage msg;
+            msg.type = (uint8_t)type;
+            for (size_t i = 0; hex[i] != '\0' && hex[i + 1] != '\0'; i += 2)
+            {
+                unsigned byte;
+                sscanf(&hex[i], "%2x", &byte);
+                msg.payload.push_back((uint8_t)byte);
+            }
+            if (msg.payload.empty())
+            {
+                continue;
+            }
+
+            auto found = byName.find(name);
+            if (found == byName.end())
+            {
+                found = byName.emplace(name, samples.size()).first;
+                samples.push_back({name, {}});
+            }
+            samples[found->second].messages.push_back(std::move(msg));
+        }
+
+        fclose(file);
+        return true;
+    }
+
+    size_t VarU32Size(uint32_t value)
+    {
+        size_t size = 1;
+        while (value >= 0x80)
+        {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : BENCH_SYNC_SAMPLES;
+    std::vector<SyncSample> samples;
+    if (!LoadSamples(path, samples) || samples.empty())
+    {
+        printf("no samples in %s\n", path);
+        return 1;
+    }
+
+    printf("%-10s %5s %8s %8s %6s %10s %10s\n", "sample", "msgs", "raw B", "wire B", "wire%", "pack ns", "unpack ns");
+
+    for (const SyncSample &sample : samples)
+    {
+        // what SendBulkPacket would put on the wire, and the packed forms to unpack
+        size_t raw = 0, wire = 0;
+        std::vector<std::vector<uint8_t>> packed;
+        for (const SyncMessage &msg : sample.messages)
+        {
+            std::vector<uint8_t> out(msg.payload.size() + 8);
+            PacketWriter writer(out.data(), msg.payload.size() - 1);
+            bool smaller = PackBits(msg.payload.data(), msg.payload.size(), writer);
+            out.resize(smaller ? writer.Size() : 0);
+
+            std::vector<uint8_t> back(msg.payload.size());
+            if (smaller && (!UnpackBits(out.data(), out.size(), back.data(), back.size()) || back != msg.payload))
+            {
+                printf("%s: type %u doesn't round trip\n", sample.name.c_str(), msg.type);
+                return 1;
+            }
+
+            // Compressed carries [u8 inner type][varint size] in front, and is only used when that's smaller
+            size_t compressed = 1 + VarU32Size((uint32_t)msg.payload.size()) + out.size();
+            raw += msg.payload.size();
+            wire += smaller && compressed < msg.payload.size() ? compressed : msg.payload.size();
+            packed.push_back(std::move(out));
+        }
+
+        uint8_t scratch[1024];
+        double packNs = BenchNsPerOp(ROUNDS, [&]()
+        {
+            for (int r = 0; r < ROUNDS; r++)
+            {
+                for (const SyncMessage &msg : sample.messages)
+                {
+                    PacketWriter writer(scratch, msg.payload.size() - 1);
+                    PackBits(msg.payload.data(), msg.payload.size(), writer);
+                    g_benchSink = g_benchSink + writer.Size();
+                }
+            }
+        });
+
+        double unpackNs = BenchNsPerOp(ROUNDS, [&]()
+        {
+            for (int r = 0; r < ROUNDS; r++)
+            {
+                for (size_t i = 0; i < packed.size(); i++)
+                {
+                    if (!packed[i].empty())
+                    {
+                        g_benchSink = g_benchSink + UnpackBits(packed[i].data(), packed[i].size(), scratch, sample.messages[i].payload.size());
+                    }
+                }
+            }
+        });
+
+        printf("%-10s %5zu %8zu %8zu %5.0f%% %10.0f %10.0f\n", sample.name.c_str(), sample.messages.size(), raw, wire,
+               100.0 * (double)wire / (double)raw, packNs, unpackNs);
+    }
+    return 0;
+}
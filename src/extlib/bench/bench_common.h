@@ -0,0 +1,37 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+// =========================================================================== //
+// Shared bits for the micro-benchmarks in this directory. Each benchmark is a
+// standalone executable that prints its own table; nothing here links against
+// the mod lib itself, only the headers and sources a benchmark pulls in.
+// =========================================================================== //
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// results fold into this so the optimizer can't drop the work being timed
+inline volatile uint64_t g_benchSink = 0;
+
+// runs fn (which does ops operations) a few times and returns the best
+// ns per operation, so a context switch in one pass doesn't count
+template <typename Fn>
+inline double BenchNsPerOp(size_t ops, Fn &&fn, int passes = 5)
+{
+    double best = 0.0;
+    for (int pass = 0; pass < passes; pass++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (double)ops;
+        if (pass == 0 || ns < best)
+        {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+#endif
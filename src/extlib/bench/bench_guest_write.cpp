@@ -0,0 +1,188 @@
+// SerializeGameMessageToMemory (util.cpp), and the WriteGuestBytes copy under
+// it, against the byte-at-a-time loop that wrote all 256 data bytes before.
+// util.cpp is built into this once per swizzle path (see CMakeLists.txt) and
+// BENCH_GUEST_WRITE_PATH names the one in use. Each build first checks the
+// guest bytes against the old loop.
+
+#include <random>
+#include <vector>
+
+#include "bench_common.h"
+#include "lib_recomp.hpp"
+#include "lib_message_queue.h"
+#include "util/util.h"
+
+namespace
+{
+    const int32_t GUEST_BASE = (int32_t)0x80100000;
+    const size_t RDRAM_SIZE = 8 << 20;
+    const size_t BATCH = 1024;
+    const int ROUNDS = 200;
+
+    // what SerializeGameMessageToMemory did before WriteGuestBytes
+    void ByteLoopSerialize(uint8_t *rdram, const GameMessage &msg, int32_t buffer_ptr)
+    {
+        MEM_B(0, buffer_ptr) = msg.type;
+        MEM_W(4, buffer_ptr) = msg.playerId;
+        MEM_W(8, buffer_ptr) = msg.param1;
+        MEM_W(12, buffer_ptr) = msg.param2;
+        MEM_W(16, buffer_ptr) = msg.param3;
+        MEM_W(20, buffer_ptr) = msg.param4;
+        MEM_W(24, buffer_ptr) = msg.param5;
+        MEM_W(28, buffer_ptr) = msg.param6;
+
+        MEM_W(32, buffer_ptr) = util::FloatToBits(msg.paramF1);
+        MEM_W(36, buffer_ptr) = util::FloatToBits(msg.paramF2);
+        MEM_W(40, buffer_ptr) = util::FloatToBits(msg.paramF3);
+        MEM_W(44, buffer_ptr) = util::FloatToBits(msg.paramF4);
+        MEM_W(48, buffer_ptr) = util::FloatToBits(msg.paramF5);
+
+        MEM_H(52, buffer_ptr) = msg.dataSize;
+
+        for (size_t i = 0; i < MAX_MESSAGE_DATA_SIZE; i++)
+        {
+            MEM_B(54 + i, buffer_ptr) = msg.data[i];
+        }
+    }
+
+    GameMessage RandomMessage(std::mt19937 &rng, uint16_t dataSize)
+    {
+        GameMessage msg{};
+        msg.type = (uint8_t)rng();
+        msg.playerId = (int32_t)rng();
+        msg.param1 = (int32_t)rng();
+        msg.param6 = (int32_t)rng();
+        msg.paramF3 = (float)rng();
+        msg.dataSize = dataSize;
+        for (size_t i = 0; i < dataSize; i++)
+        {
+            msg.data[i] = (uint8_t)rng();
+        }
+        return msg;
+    }
+
+    // guest byte at addr, whichever way rdram stores it
+    uint8_t GuestByte(uint8_t *rdram, int32_t addr)
+    {
+        return (uint8_t)MEM_B(0, addr);
+    }
+
+    // the header fields and payload match the old loop, the payload is
+    // terminated and nothing past the record is written. bytes 1-3 are
+    // padding after type that neither version writes
+    int CheckAgainstByteLoop(uint8_t *rdram, std::mt19937 &rng)
+    {
+        int mismatches = 0;
+        std::vector<uint8_t> expected(MAX_MESSAGE_DATA_SIZE + 64);
+
+        for (int n = 0; n < 20000; n++)
+        {
+            GameMessage msg = RandomMessage(rng, (uint16_t)(rng() % MAX_MESSAGE_DATA_SIZE));
+            int32_t addr = GUEST_BASE + (int32_t)(rng() % 64) * 4;
+            const size_t record = GuestMessageRecordSize(msg.dataSize);
+            const size_t span = GUEST_GAME_MESSAGE_HEADER_SIZE + MAX_MESSAGE_DATA_SIZE;
+
+            ByteLoopSerialize(rdram, msg, addr);
+            for (size_t i = 0; i < span; i++)
+            {
+                expected[i] = GuestByte(rdram, addr + (int32_t)i);
+            }
+
+            for (size_t i = 0; i < span + 8; i++)
+            {
+                MEM_B(i, addr) = (int8_t)0xA5;
+            }
+            util::SerializeGameMessageToMemory(rdram, msg, msg.data, (PTR(GameMessage))addr);
+
+            const size_t payloadEnd = GUEST_GAME_MESSAGE_HEADER_SIZE + msg.dataSize;
+            for (size_t i = 0; i < span + 8; i++)
+            {
+                if (i >= 1 && i <= 3)
+                {
+                    continue;
+                }
+
+                uint8_t got = GuestByte(rdram, addr + (int32_t)i);
+                bool ok = true;
+                if (i < payloadEnd)
+                {
+                    ok = got == expected[i];
+                }
+                else if (i == payloadEnd)
+                {
+                    ok = got == 0;
+                }
+                else if (i >= record)
+                {
+                    ok = got == 0xA5;
+                }
+                if (!ok)
+                {
+                    mismatches++;
+                    break;
+                }
+            }
+        }
+        return mismatches;
+    }
+}
+
+int main()
+{
+    std::vector<uint8_t> memory(RDRAM_SIZE);
+    uint8_t *rdram = memory.data();
+    std::mt19937 rng(23);
+
+    int mismatches = CheckAgainstByteLoop(rdram, rng);
+    printf("%s path: checked 20000 messages against the byte loop, %d mismatches\n", BENCH_GUEST_WRITE_PATH, mismatches);
+    if (mismatches != 0)
+    {
+        return 1;
+    }
+
+    printf("%-10s %14s %14s\n", "dataSize", "byte loop ns", "util ns");
+
+    for (uint16_t dataSize : {0, 12, 64, 255})
+    {
+        std::vector<GameMessage> batch;
+        std::vector<int32_t> oldAddrs, newAddrs;
+        int32_t oldAddr = GUEST_BASE, newAddr = GUEST_BASE;
+        for (size_t i = 0; i < BATCH; i++)
+        {
+            batch.push_back(RandomMessage(rng, dataSize));
+            // the old records were fixed size, the new ones are packed back to back
+            oldAddrs.push_back(oldAddr);
+            newAddrs.push_back(newAddr);
+            oldAddr += (int32_t)((GUEST_GAME_MESSAGE_HEADER_SIZE + MAX_MESSAGE_DATA_SIZE + 3) & ~(size_t)3);
+            newAddr += (int32_t)GuestMessageRecordSize(dataSize);
+        }
+
+        const size_t ops = BATCH * ROUNDS;
+        double oldNs = BenchNsPerOp(ops, [&]()
+        {
+            for (int r = 0; r < ROUNDS; r++)
+            {
+                for (size_t i = 0; i < BATCH; i++)
+                {
+                    ByteLoopSerialize(rdram, batch[i], oldAddrs[i]);
+                }
+            }
+            g_benchSink = g_benchSink + rdram[0x100000];
+        });
+
+        double newNs = BenchNsPerOp(ops, [&]()
+        {
+            for (int r = 0; r < ROUNDS; r++)
+            {
+                for (size_t i = 0; i < BATCH; i++)
+                {
+                    util::SerializeGameMessageToMemory(rdram, batch[i], batch[i].data, (PTR(GameMessage))newAddrs[i]);
+                }
+            }
+            g_benchSink = g_benchSink + rdram[0x100000];
+        });
+
+        printf("%-10u %14.1f %14.1f\n", (unsigned)dataSize, oldNs, newNs);
+    }
+    return 0;
+}
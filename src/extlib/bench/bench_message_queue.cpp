@@ -0,0 +1,202 @@
+// MessageQueue (the MPSC record ring) against the mutex-guarded std::queue it
+// replaced, with 1 to 8 producer threads pushing into one consumer draining
+// it the way net_msg_poll_batch does. Each run checks that every message
+// arrives once, in order per producer.
+//
+// The numbers only mean something on a machine with a core per thread; on
+// fewer cores they mostly measure the scheduler.
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+#include "lib_message_queue.h"
+
+namespace
+{
+    const int MESSAGES_PER_PRODUCER = 200000;
+
+    // the queue as it was before lib_ring_buffer.h: a whole GameMessage per
+    // entry, copied in and out under one lock
+    class MutexMessageQueue
+    {
+    private:
+        std::queue<GameMessage> m_queue;
+        mutable std::mutex m_mutex;
+        static constexpr size_t MAX_QUEUE_SIZE = 1024;
+
+    public:
+        bool Push(const GameMessage &msg)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_queue.size() >= MAX_QUEUE_SIZE)
+            {
+                return false;
+            }
+            m_queue.push(msg);
+            return true;
+        }
+
+        bool Pop(GameMessage &msg)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_queue.empty())
+            {
+                return false;
+            }
+            msg = m_queue.front();
+            m_queue.pop();
+            return true;
+        }
+    };
+
+    struct RunResult
+    {
+        double nsPerMessage;
+        uint64_t fullRetries;
+        bool ok;
+    };
+
+    // producers stamp playerId with their index and param1 with a running count
+    template <typename Queue, typename PopFn>
+    RunResult Run(Queue &queue, int producers, const GameMessage &prototype, PopFn &&pop)
+    {
+        std::atomic<bool> go{false};
+        std::atomic<uint64_t> fullRetries{0};
+        std::vector<std::thread> threads;
+
+        for (int p = 0; p < producers; p++)
+        {
+            threads.emplace_back([&, p]()
+            {
+                GameMessage msg = prototype;
+                msg.playerId = p;
+                uint64_t retries = 0;
+
+                while (!go.load(std::memory_order_acquire))
+                {
+                    std::this_thread::yield();
+                }
+
+                for (int i = 0; i < MESSAGES_PER_PRODUCER; i++)
+                {
+                    msg.param1 = i;
+                    while (!queue.Push(msg))
+                    {
+                        retries++;
+                        std::this_thread::yield();
+                    }
+                }
+                fullRetries += retries;
+            });
+        }
+
+        std::vector<int32_t> next(producers, 0);
+        const uint64_t total = (uint64_t)producers * MESSAGES_PER_PRODUCER;
+        uint64_t received = 0;
+        bool ok = true;
+
+        auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+
+        while (received < total)
+        {
+            int32_t playerId, param1;
+            if (!pop(playerId, param1))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            if (playerId < 0 || playerId >= producers || param1 != next[playerId])
+            {
+                ok = false;
+            }
+            else
+            {
+                next[playerId]++;
+            }
+            received++;
+        }
+
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+
+        return {ns / (double)total, fullRetries.load(), ok};
+    }
+
+    RunResult RunMutex(int producers, const GameMessage &prototype)
+    {
+        auto queue = std::make_unique<MutexMessageQueue>();
+        return Run(*queue, producers, prototype, [&](int32_t &playerId, int32_t &param1)
+        {
+            GameMessage msg;
+            if (!queue->Pop(msg))
+            {
+                return false;
+            }
+            playerId = msg.playerId;
+            param1 = msg.param1;
+            g_benchSink = g_benchSink + (msg.dataSize ? msg.data[0] : 0);
+            return true;
+        });
+    }
+
+    RunResult RunRing(int producers, const GameMessage &prototype)
+    {
+        auto queue = std::make_unique<MessageQueue>();
+        return Run(*queue, producers, prototype, [&](int32_t &playerId, int32_t &param1)
+        {
+            return queue->Pop([&](const GameMessageHeader &msg, const uint8_t *data)
+            {
+                playerId = msg.playerId;
+                param1 = msg.param1;
+                g_benchSink = g_benchSink + (msg.dataSize ? data[0] : 0);
+                return true;
+            });
+        });
+    }
+}
+
+int main()
+{
+    printf("%u hardware threads, %d messages per producer\n", std::thread::hardware_concurrency(), MESSAGES_PER_PRODUCER);
+    printf("%-22s %9s %12s %12s %12s %12s\n", "message", "producers", "mutex ns", "ring ns", "mutex full", "ring full");
+
+    struct Case
+    {
+        const char *name;
+        GameMessage msg;
+    } cases[] = {
+        {"jiggy (no payload)", CreateJiggyCollectedMsg(1, 2, 3)},
+        {"status (19 B string)", CreateConnectionStatusMsg("Connected to lobby")},
+    };
+
+    bool ok = true;
+    for (const Case &c : cases)
+    {
+        for (int producers : {1, 2, 4, 8})
+        {
+            RunResult mutexResult = RunMutex(producers, c.msg);
+            RunResult ringResult = RunRing(producers, c.msg);
+            ok = ok && mutexResult.ok && ringResult.ok;
+
+            printf("%-22s %9d %12.1f %12.1f %12llu %12llu\n", c.name, producers, mutexResult.nsPerMessage, ringResult.nsPerMessage,
+                   (unsigned long long)mutexResult.fullRetries, (unsigned long long)ringResult.fullRetries);
+        }
+    }
+
+    if (!ok)
+    {
+        printf("messages were lost, duplicated or reordered\n");
+        return 1;
+    }
+    return 0;
+}
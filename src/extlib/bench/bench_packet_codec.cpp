@@ -0,0 +1,245 @@
+// DecodePacket/EncodePacket (lib_packet_codec.h) against the hand-written
+// shift-and-or code they replaced, on random puppet updates and honeycomb
+// broadcasts. Checks the two agree before timing anything.
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "bench_common.h"
+#include "lib_packet_codec.h"
+
+namespace
+{
+    const size_t PACKETS = 4096;
+    const size_t STRIDE = 64;
+    const int ROUNDS = 2000;
+
+    // what HandlePuppetUpdate did before the codec
+    void HandRolledDecodePuppet(const uint8_t *data, PuppetUpdatePacket &pak)
+    {
+        auto read_float = [&data]() -> float
+        {
+            uint32_t bits = ((uint32_t)data[0] << 24) |
+                            ((uint32_t)data[1] << 16) |
+                            ((uint32_t)data[2] << 8) |
+                            ((uint32_t)data[3]);
+            data += 4;
+            float result;
+            std::memcpy(&result, &bits, sizeof(float));
+            return result;
+        };
+
+        pak.x = read_float();
+        pak.y = read_float();
+        pak.z = read_float();
+        pak.yaw = read_float();
+        pak.pitch = read_float();
+        pak.roll = read_float();
+        pak.anim_duration = read_float();
+        pak.anim_timer = read_float();
+
+        pak.level_id = (int16_t)(((uint16_t)data[0] << 8) | (uint16_t)data[1]);
+        data += 2;
+        pak.map_id = (int16_t)(((uint16_t)data[0] << 8) | (uint16_t)data[1]);
+        data += 2;
+        pak.anim_id = (int16_t)(((uint16_t)data[0] << 8) | (uint16_t)data[1]);
+        data += 2;
+
+        pak.model_id = data[0];
+        pak.flags = data[1];
+        pak.playback_type = data[2];
+        pak.playback_direction = data[3];
+    }
+
+    // what SendPuppetUpdate did before the codec
+    void HandRolledEncodePuppet(PacketWriter &writer, const PuppetUpdatePacket &pak)
+    {
+        writer.WriteFloatBE(pak.x);
+        writer.WriteFloatBE(pak.y);
+        writer.WriteFloatBE(pak.z);
+        writer.WriteFloatBE(pak.yaw);
+        writer.WriteFloatBE(pak.pitch);
+        writer.WriteFloatBE(pak.roll);
+        writer.WriteFloatBE(pak.anim_duration);
+        writer.WriteFloatBE(pak.anim_timer);
+
+        writer.WriteU16BE((uint16_t)pak.level_id);
+        writer.WriteU16BE((uint16_t)pak.map_id);
+        writer.WriteU16BE((uint16_t)pak.anim_id);
+
+        writer.WriteU8(pak.model_id);
+        writer.WriteU8(pak.flags);
+        writer.WriteU8(pak.playback_type);
+        writer.WriteU8(pak.playback_direction);
+    }
+
+    int32_t HandRolledI32(const uint8_t *data)
+    {
+        return ((int32_t)data[0] << 24) | ((int32_t)data[1] << 16) | ((int32_t)data[2] << 8) | ((int32_t)data[3]);
+    }
+
+    // what HandleHoneycombCollected did before the codec
+    void HandRolledDecodeHoneycomb(const uint8_t *data, BroadcastHoneycomb &msg)
+    {
+        msg.player_id = (uint32_t)HandRolledI32(data);
+        msg.map_id = HandRolledI32(data + 4);
+        msg.honeycomb_id = HandRolledI32(data + 8);
+        msg.x = HandRolledI32(data + 12);
+        msg.y = HandRolledI32(data + 16);
+        msg.z = HandRolledI32(data + 20);
+    }
+
+    bool SamePuppet(const PuppetUpdatePacket &a, const PuppetUpdatePacket &b)
+    {
+        return std::memcmp(&a.x, &b.x, 8 * sizeof(float)) == 0 &&
+               a.level_id == b.level_id && a.map_id == b.map_id && a.anim_id == b.anim_id &&
+               a.model_id == b.model_id && a.flags == b.flags &&
+               a.playback_type == b.playback_type && a.playback_direction == b.playback_direction;
+    }
+
+    int CheckAgreement(const std::vector<uint8_t> &wire)
+    {
+        int mismatches = 0;
+        for (size_t i = 0; i < PACKETS; i++)
+        {
+            const uint8_t *data = &wire[i * STRIDE];
+
+            PuppetUpdatePacket oldPak, newPak;
+            HandRolledDecodePuppet(data, oldPak);
+            if (DecodePacket(data, WIRE_SIZE<PuppetUpdatePacket>, newPak) != WIRE_SIZE<PuppetUpdatePacket> || !SamePuppet(oldPak, newPak))
+            {
+                mismatches++;
+            }
+
+            uint8_t oldOut[STRIDE], newOut[STRIDE];
+            PacketWriter oldWriter(oldOut, sizeof(oldOut)), newWriter(newOut, sizeof(newOut));
+            HandRolledEncodePuppet(oldWriter, oldPak);
+            EncodePacket(newWriter, oldPak);
+            if (oldWriter.Size() != newWriter.Size() || std::memcmp(oldOut, newOut, oldWriter.Size()) != 0)
+            {
+                mismatches++;
+            }
+
+            BroadcastHoneycomb oldComb, newComb;
+            HandRolledDecodeHoneycomb(data, oldComb);
+            if (DecodePacket(data, WIRE_SIZE<BroadcastHoneycomb>, newComb) != WIRE_SIZE<BroadcastHoneycomb> ||
+                std::memcmp(&oldComb, &newComb, sizeof(oldComb)) != 0)
+            {
+                mismatches++;
+            }
+        }
+        return mismatches;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    std::vector<uint8_t> wire(PACKETS * STRIDE);
+    for (uint8_t &b : wire)
+    {
+        b = (uint8_t)rng();
+    }
+
+    // the encoders start from decoded packets, as SendPuppetUpdate would
+    std::vector<PuppetUpdatePacket> packets(PACKETS);
+    for (size_t i = 0; i < PACKETS; i++)
+    {
+        HandRolledDecodePuppet(&wire[i * STRIDE], packets[i]);
+    }
+
+    int mismatches = CheckAgreement(wire);
+    printf("checked %zu packets against the hand-written code: %d mismatches\n", PACKETS, mismatches);
+    if (mismatches != 0)
+    {
+        return 1;
+    }
+
+    const size_t ops = PACKETS * ROUNDS;
+    uint8_t out[STRIDE];
+
+    double decodeOld = BenchNsPerOp(ops, [&]()
+    {
+        for (int r = 0; r < ROUNDS; r++)
+        {
+            for (size_t i = 0; i < PACKETS; i++)
+            {
+                PuppetUpdatePacket pak;
+                HandRolledDecodePuppet(&wire[i * STRIDE], pak);
+                g_benchSink = g_benchSink + (uint64_t)pak.anim_id + pak.flags;
+            }
+        }
+    });
+
+    double decodeNew = BenchNsPerOp(ops, [&]()
+    {
+        for (int r = 0; r < ROUNDS; r++)
+        {
+            for (size_t i = 0; i < PACKETS; i++)
+            {
+                PuppetUpdatePacket pak;
+                DecodePacket(&wire[i * STRIDE], WIRE_SIZE<PuppetUpdatePacket>, pak);
+                g_benchSink = g_benchSink + (uint64_t)pak.anim_id + pak.flags;
+            }
+        }
+    });
+
+    double encodeOld = BenchNsPerOp(ops, [&]()
+    {
+        for (int r = 0; r < ROUNDS; r++)
+        {
+            for (size_t i = 0; i < PACKETS; i++)
+            {
+                PacketWriter writer(out, sizeof(out));
+                HandRolledEncodePuppet(writer, packets[i]);
+                g_benchSink = g_benchSink + out[5];
+            }
+        }
+    });
+
+    double encodeNew = BenchNsPerOp(ops, [&]()
+    {
+        for (int r = 0; r < ROUNDS; r++)
+        {
+            for (size_t i = 0; i < PACKETS; i++)
+            {
+                PacketWriter writer(out, sizeof(out));
+                EncodePacket(writer, packets[i]);
+                g_benchSink = g_benchSink + out[5];
+            }
+        }
+    });
+
+    double combOld = BenchNsPerOp(ops, [&]()
+    {
+        for (int r = 0; r < ROUNDS; r++)
+        {
+            for (size_t i = 0; i < PACKETS; i++)
+            {
+                BroadcastHoneycomb msg;
+                HandRolledDecodeHoneycomb(&wire[i * STRIDE], msg);
+                g_benchSink = g_benchSink + (uint64_t)msg.honeycomb_id;
+            }
+        }
+    });
+
+    double combNew = BenchNsPerOp(ops, [&]()
+    {
+        for (int r = 0; r < ROUNDS; r++)
+        {
+            for (size_t i = 0; i < PACKETS; i++)
+            {
+                BroadcastHoneycomb msg;
+                DecodePacket(&wire[i * STRIDE], WIRE_SIZE<BroadcastHoneycomb>, msg);
+                g_benchSink = g_benchSink + (uint64_t)msg.honeycomb_id;
+            }
+        }
+    });
+
+    printf("%-18s %12s %12s\n", "ns per packet", "hand-written", "codec");
+    printf("%-18s %12.2f %12.2f\n", "puppet decode", decodeOld, decodeNew);
+    printf("%-18s %12.2f %12.2f\n", "puppet encode", encodeOld, encodeNew);
+    printf("%-18s %12.2f %12.2f\n", "honeycomb decode", combOld, combNew);
+    return 0;
+}
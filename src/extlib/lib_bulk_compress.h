@@ -0,0 +1,97 @@
+#ifndef LIB_BULK_COMPRESS_H
+#define LIB_BULK_COMPRESS_H
+
+// =========================================================================== //
+// Run-length coding for the bulk lobby state (note save data and progress
+// blobs), which is mostly zero early on and mostly 0xFF late. PackBits-style:
+// a control byte c, then
+//   c < 0x80   c + 1 literal bytes (1 to 128)
+//   c >= 0x80  one byte repeated c - 0x80 + 3 times (3 to 130)
+// The server's compress.rs speaks the same format.
+// =========================================================================== //
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "lib_packet_writer.h"
+
+constexpr size_t PACK_BITS_MIN_RUN = 3;
+constexpr size_t PACK_BITS_MAX_RUN = 0x7F + PACK_BITS_MIN_RUN;
+constexpr size_t PACK_BITS_MAX_LITERALS = 0x80;
+
+// Appends src packed to out. False if it didn't fit, so sizing out a byte
+// under size makes it give up when packing wouldn't save anything
+inline bool PackBits(const uint8_t *src, size_t size, PacketWriter &out)
+{
+    size_t i = 0;
+    while (i < size && out.Ok())
+    {
+        size_t run = 1;
+        while (i + run < size && run < PACK_BITS_MAX_RUN && src[i + run] == src[i])
+        {
+            run++;
+        }
+
+        if (run >= PACK_BITS_MIN_RUN)
+        {
+            out.WriteU8((uint8_t)(0x80 + run - PACK_BITS_MIN_RUN));
+            out.WriteU8(src[i]);
+            i += run;
+            continue;
+        }
+
+        // literals up to the next run worth coding
+        size_t start = i;
+        while (i < size && i - start < PACK_BITS_MAX_LITERALS)
+        {
+            if (i + 2 < size && src[i] == src[i + 1] && src[i] == src[i + 2])
+            {
+                break;
+            }
+            i++;
+        }
+
+        out.WriteU8((uint8_t)(i - start - 1));
+        out.WriteBytes(src + start, i - start);
+    }
+    return out.Ok();
+}
+
+// Unpacks src into exactly rawSize bytes at dst. False if it's malformed
+// or comes out any other size
+inline bool UnpackBits(const uint8_t *src, size_t size, uint8_t *dst, size_t rawSize)
+{
+    const uint8_t *end = src + size;
+    size_t written = 0;
+
+    while (src < end)
+    {
+        uint8_t control = *src++;
+
+        if (control < 0x80)
+        {
+            size_t count = (size_t)control + 1;
+            if (count > (size_t)(end - src) || count > rawSize - written)
+            {
+                return false;
+            }
+            std::memcpy(dst + written, src, count);
+            src += count;
+            written += count;
+        }
+        else
+        {
+            size_t count = (size_t)control - 0x80 + PACK_BITS_MIN_RUN;
+            if (src == end || count > rawSize - written)
+            {
+                return false;
+            }
+            std::memset(dst + written, *src++, count);
+            written += count;
+        }
+    }
+    return written == rawSize;
+}
+
+#endif
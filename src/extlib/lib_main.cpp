@@ -199,9 +199,10 @@ extern "C"
 
 static NetworkClient *g_networkClient = nullptr;
 static int g_connect_state = 0;
+static bool g_network_threaded = false;
 
-// Forward declaration for util
-uint8_t PacketTypeToMessageType(PacketType packetType);
+// reused by the blob send and state digest exports so they don't allocate per call
+static std::vector<uint8_t> g_blobScratch;
 
 RECOMP_DLL_FUNC(native_lib_test)
 {
@@ -212,25 +213,56 @@ RECOMP_DLL_FUNC(native_lib_test)
     RECOMP_RETURN(int, 0);
 }
 
-// polls for network messages
-RECOMP_DLL_FUNC(net_msg_poll)
+// polls for network messages: packs up to max_count of them back to back
+// into a guest buffer of buffer_size bytes (see GuestMessageRecordSize) and
+// returns how many it wrote, so draining the queue costs one call a frame.
+// whatever doesn't fit waits for the next call
+RECOMP_DLL_FUNC(net_msg_poll_batch)
 {
     PTR(GameMessage)
     buffer_ptr = RECOMP_ARG(PTR(GameMessage), 0);
+    int bufferSize = RECOMP_ARG(int, 1);
+    int maxCount = RECOMP_ARG(int, 2);
 
-    if (!buffer_ptr)
+    if (!buffer_ptr || bufferSize <= 0 || maxCount <= 0)
     {
         RECOMP_RETURN(int, 0);
     }
 
-    GameMessage msg;
-    if (g_messageQueue.Pop(msg))
+    size_t used = 0;
+    int count = 0;
+    auto copyToGuest = [&](const GameMessageHeader &msg, const uint8_t *data)
     {
-        util::SerializeGameMessageToMemory(rdram, msg, buffer_ptr);
-        RECOMP_RETURN(int, 1);
+        size_t recordSize = GuestMessageRecordSize(msg.dataSize);
+        if (used + recordSize > (size_t)bufferSize)
+        {
+            // never going to fit, don't let it hold up the rest
+            if (used == 0)
+            {
+                char buf[160];
+                snprintf(buf, sizeof(buf), "[COOP][DLL] net_msg_poll_batch: dropping type=%u player=%d dataSize=%u, record=%zu bytes > buffer=%d",
+                         (unsigned)msg.type, msg.playerId, (unsigned)msg.dataSize, recordSize, bufferSize);
+                coop_dll_log(buf);
+                return true;
+            }
+            return false;
+        }
+
+        util::SerializeGameMessageToMemory(rdram, msg, data, buffer_ptr + (PTR(GameMessage))used);
+        used += recordSize;
+        count++;
+        return true;
+    };
+
+    while (count < maxCount)
+    {
+        if (!g_messageQueue.Pop(copyToGuest))
+        {
+            break;
+        }
     }
 
-    RECOMP_RETURN(int, 0);
+    RECOMP_RETURN(int, count);
 }
 
 RECOMP_DLL_FUNC(native_connect_to_server)
@@ -304,12 +336,12 @@ RECOMP_DLL_FUNC(native_connect_to_server)
     if (g_networkClient == nullptr)
     {
         coop_dll_log("[COOP][DLL] native_connect_to_server: creating NetworkClient");
-        g_networkClient = new NetworkClient();
+        g_networkClient = new NetworkClient(g_messageQueue);
     }
 
-    GameMessage connectingMsg = CreateConnectionStatusMsg("Connecting to server...");
-    g_messageQueue.Push(connectingMsg);
+    g_networkClient->SetThreaded(g_network_threaded);
 
+    // progress from here on is reported by the client's state changes
     coop_dll_log("[COOP][DLL] native_connect_to_server: calling Configure");
     g_networkClient->Configure(host, username, lobby, password);
 
@@ -318,66 +350,6 @@ RECOMP_DLL_FUNC(native_connect_to_server)
     RECOMP_RETURN(int, 1);
 }
 
-uint8_t PacketTypeToMessageType(PacketType packetType)
-{
-    switch (packetType)
-    {
-    case PacketType::PlayerConnected:
-        return (uint8_t)MessageType::PLAYER_CONNECTED;
-
-    case PacketType::PlayerDisconnected:
-        return (uint8_t)MessageType::PLAYER_DISCONNECTED;
-
-    case PacketType::JiggyCollected:
-        return (uint8_t)MessageType::JIGGY_COLLECTED;
-
-    case PacketType::NoteCollected:
-        return (uint8_t)MessageType::NOTE_COLLECTED;
-
-    case PacketType::PuppetUpdate:
-        return (uint8_t)MessageType::PUPPET_UPDATE;
-
-    case PacketType::LevelOpened:
-        return (uint8_t)MessageType::LEVEL_OPENED;
-
-    case PacketType::NoteSaveData:
-        return (uint8_t)MessageType::NOTE_SAVE_DATA;
-
-    case PacketType::InitialSaveDataRequest:
-        return (uint8_t)MessageType::INITIAL_SAVE_DATA_REQUEST;
-
-    case PacketType::FileProgressFlags:
-        return (uint8_t)MessageType::FILE_PROGRESS_FLAGS;
-
-    case PacketType::AbilityProgress:
-        return (uint8_t)MessageType::ABILITY_PROGRESS;
-
-    case PacketType::HoneycombScore:
-        return (uint8_t)MessageType::HONEYCOMB_SCORE;
-
-    case PacketType::MumboScore:
-        return (uint8_t)MessageType::MUMBO_SCORE;
-
-    case PacketType::HoneycombCollected:
-        return (uint8_t)MessageType::HONEYCOMB_COLLECTED;
-
-    case PacketType::MumboTokenCollected:
-        return (uint8_t)MessageType::MUMBO_TOKEN_COLLECTED;
-
-    case PacketType::PlayerInfoRequest:
-        return (uint8_t)MessageType::PLAYER_INFO_REQUEST;
-
-    case PacketType::PlayerInfoResponse:
-        return (uint8_t)MessageType::PLAYER_INFO_RESPONSE;
-
-    case PacketType::PlayerListUpdate:
-        return (uint8_t)MessageType::PLAYER_LIST_UPDATE;
-
-    default:
-        return 0;
-    }
-}
-
 static void push_honeycomb_collected(const HoneycombCollectedPacket &p)
 {
     GameMessage msg;
@@ -406,6 +378,40 @@ static void push_mumbo_token_collected(const MumboTokenCollectedPacket &p)
     g_messageQueue.Push(msg);
 }
 
+static void push_connection_status(const ConnectionStatus &status)
+{
+    char text[64];
+
+    switch (status.state)
+    {
+    case ConnectionState::Resolving:
+        snprintf(text, sizeof(text), "Looking up server...");
+        break;
+    case ConnectionState::Handshaking:
+        snprintf(text, sizeof(text), "Connecting to server...");
+        break;
+    case ConnectionState::Connected:
+        snprintf(text, sizeof(text), "Connected (%u ms)", status.latencyMs);
+        break;
+    case ConnectionState::Resuming:
+        snprintf(text, sizeof(text), "Connection lost, reconnecting...");
+        break;
+    case ConnectionState::Failed:
+        // lets the mod call native_connect_to_server again
+        g_connect_state = 0;
+        g_messageQueue.Push(CreateConnectionErrorMsg("Could not reach the server"));
+        return;
+    default:
+        return;
+    }
+
+    GameMessage msg = CreateConnectionStatusMsg(text);
+    msg.playerId = status.playerId;
+    msg.param1 = (int32_t)status.state;
+    msg.param2 = (int32_t)status.latencyMs;
+    g_messageQueue.Push(msg);
+}
+
 // handle network updates (packet receive)
 RECOMP_DLL_FUNC(native_update_network)
 {
@@ -413,18 +419,34 @@ RECOMP_DLL_FUNC(native_update_network)
     {
         g_networkClient->Update();
 
-        while (g_networkClient->HasEvents())
+        ConnectionStatus status;
+        while (g_networkClient->PopStatus(status))
         {
-            NetEvent evt = g_networkClient->PopEvent();
-            GameMessage msg;
-            util::ConvertNetEventToGameMessage(evt, msg);
-            g_messageQueue.Push(msg);
+            push_connection_status(status);
         }
+
+        // everything sent since last frame goes out bundled together
+        g_networkClient->FlushOutgoing();
     }
 
     RECOMP_RETURN(int, 0);
 }
 
+// enables/disables the background network thread.
+// normally called right before native_connect_to_server
+RECOMP_DLL_FUNC(native_set_network_threaded)
+{
+    int enabled = RECOMP_ARG(int, 0);
+    g_network_threaded = (enabled != 0);
+
+    if (g_networkClient != nullptr)
+    {
+        g_networkClient->SetThreaded(g_network_threaded);
+    }
+
+    RECOMP_RETURN(int, 1);
+}
+
 // closes connection and disconnects
 RECOMP_DLL_FUNC(native_disconnect_from_server)
 {
@@ -432,6 +454,7 @@ RECOMP_DLL_FUNC(native_disconnect_from_server)
     {
         delete g_networkClient;
         g_networkClient = nullptr;
+        g_connect_state = 0;
 
         GameMessage disconnectedMsg = CreateConnectionStatusMsg("Disconnected from server");
         g_messageQueue.Push(disconnectedMsg);
@@ -529,8 +552,8 @@ RECOMP_DLL_FUNC(native_send_file_progress_flags)
         RECOMP_RETURN(int, 0);
     }
 
-    std::vector<uint8_t> flags = util::ReadByteBufferFromMemory(rdram, bufPtr, size);
-    g_networkClient->SendFileProgressFlags(flags);
+    util::ReadByteBufferFromMemory(rdram, bufPtr, size, g_blobScratch);
+    g_networkClient->SendFileProgressFlags(g_blobScratch);
 
     RECOMP_RETURN(int, 1);
 }
@@ -552,8 +575,8 @@ RECOMP_DLL_FUNC(native_send_ability_progress)
         RECOMP_RETURN(int, 0);
     }
 
-    std::vector<uint8_t> bytes = util::ReadByteBufferFromMemory(rdram, bufPtr, size);
-    g_networkClient->SendAbilityProgress(bytes);
+    util::ReadByteBufferFromMemory(rdram, bufPtr, size, g_blobScratch);
+    g_networkClient->SendAbilityProgress(g_blobScratch);
     RECOMP_RETURN(int, 1);
 }
 
@@ -574,8 +597,8 @@ RECOMP_DLL_FUNC(native_send_honeycomb_score)
         RECOMP_RETURN(int, 0);
     }
 
-    std::vector<uint8_t> bytes = util::ReadByteBufferFromMemory(rdram, bufPtr, size);
-    g_networkClient->SendHoneycombScore(bytes);
+    util::ReadByteBufferFromMemory(rdram, bufPtr, size, g_blobScratch);
+    g_networkClient->SendHoneycombScore(g_blobScratch);
     RECOMP_RETURN(int, 1);
 }
 
@@ -596,8 +619,8 @@ RECOMP_DLL_FUNC(native_send_mumbo_score)
         RECOMP_RETURN(int, 0);
     }
 
-    std::vector<uint8_t> bytes = util::ReadByteBufferFromMemory(rdram, bufPtr, size);
-    g_networkClient->SendMumboScore(bytes);
+    util::ReadByteBufferFromMemory(rdram, bufPtr, size, g_blobScratch);
+    g_networkClient->SendMumboScore(g_blobScratch);
     RECOMP_RETURN(int, 1);
 }
 
@@ -637,6 +660,86 @@ RECOMP_DLL_FUNC(native_send_mumbo_token_collected)
     RECOMP_RETURN(int, 1);
 }
 
+// the game's answer to MSG_STATE_DIGEST_REQUEST: begin, add everything it
+// has applied with the three calls below (categories are DigestCategory,
+// lib_state_digest.h), then native_state_digest_send
+RECOMP_DLL_FUNC(native_state_digest_begin)
+{
+    if (g_networkClient != nullptr)
+    {
+        g_networkClient->BeginStateDigest();
+    }
+
+    RECOMP_RETURN(int, 1);
+}
+
+// one (a, b) item, e.g. a collected jiggy
+RECOMP_DLL_FUNC(native_state_digest_add_item)
+{
+    int category = RECOMP_ARG(int, 0);
+    int a = RECOMP_ARG(int, 1);
+    int b = RECOMP_ARG(int, 2);
+
+    if (g_networkClient == nullptr || category < 0 || category >= (int)STATE_DIGEST_CATEGORIES)
+    {
+        RECOMP_RETURN(int, 0);
+    }
+
+    g_networkClient->AddStateDigestItem((DigestCategory)category, a, b);
+    RECOMP_RETURN(int, 1);
+}
+
+// an (a, bit) item per set bit, e.g. a level's note save data
+RECOMP_DLL_FUNC(native_state_digest_add_bits)
+{
+    int category = RECOMP_ARG(int, 0);
+    int a = RECOMP_ARG(int, 1);
+    PTR(uint8_t)
+    bufPtr = RECOMP_ARG(PTR(uint8_t), 2);
+    int size = RECOMP_ARG(int, 3);
+
+    if (g_networkClient == nullptr || category < 0 || category >= (int)STATE_DIGEST_CATEGORIES || !bufPtr || size <= 0)
+    {
+        RECOMP_RETURN(int, 0);
+    }
+
+    util::ReadByteBufferFromMemory(rdram, bufPtr, size, g_blobScratch);
+    g_networkClient->AddStateDigestBits((DigestCategory)category, a, g_blobScratch);
+    RECOMP_RETURN(int, 1);
+}
+
+// a whole progress blob, category FileProgress to MumboScore, along with
+// the items the server derives from it
+RECOMP_DLL_FUNC(native_state_digest_add_blob)
+{
+    int category = RECOMP_ARG(int, 0);
+    PTR(uint8_t)
+    bufPtr = RECOMP_ARG(PTR(uint8_t), 1);
+    int size = RECOMP_ARG(int, 2);
+
+    const int first = (int)DigestCategory::FileProgress;
+    if (g_networkClient == nullptr || category < first || category >= first + (int)PROGRESS_BLOB_KINDS || !bufPtr || size <= 0)
+    {
+        RECOMP_RETURN(int, 0);
+    }
+
+    PacketType type = static_cast<PacketType>(static_cast<uint8_t>(PacketType::FileProgressFlags) + (category - first));
+    util::ReadByteBufferFromMemory(rdram, bufPtr, size, g_blobScratch);
+    g_networkClient->AddStateDigestBlob(type, g_blobScratch);
+    RECOMP_RETURN(int, 1);
+}
+
+// sends the FullSyncRequest with what was added since native_state_digest_begin
+RECOMP_DLL_FUNC(native_state_digest_send)
+{
+    if (g_networkClient != nullptr)
+    {
+        g_networkClient->SendFullSyncRequest();
+    }
+
+    RECOMP_RETURN(int, 1);
+}
+
 // send a teleport request to another player
 RECOMP_DLL_FUNC(native_send_player_info_request)
 {
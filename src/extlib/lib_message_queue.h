@@ -1,9 +1,10 @@
 #pragma once
 
-#include <queue>
-#include <mutex>
 #include <cstring>
 #include <cstdint>
+#include <new>
+
+#include "lib_ring_buffer.h"
 
 enum class MessageType : uint8_t
 {
@@ -27,43 +28,69 @@ enum class MessageType : uint8_t
     PLAYER_LIST_UPDATE = 19,
     CONNECTION_STATUS = 8,
     CONNECTION_ERROR = 9,
+    STATE_DIGEST_REQUEST = 22,
 };
 
+// payload a GameMessage built on its own can carry (the status and text
+// helpers below). messages from the network client are built straight in
+// the queue and can carry up to MAX_MESSAGE_PAYLOAD_SIZE
 constexpr size_t MAX_MESSAGE_DATA_SIZE = 256;
+constexpr size_t MAX_MESSAGE_PAYLOAD_SIZE = 4096;
+
+// The mod's GameMessage (message_queue.h) is this header's fields, then
+// dataSize payload bytes and a NUL, padded to a word. net_msg_poll_batch
+// packs them back to back in the guest buffer
+constexpr size_t GUEST_GAME_MESSAGE_HEADER_SIZE = 54;
 
-struct GameMessage
+constexpr size_t GuestMessageRecordSize(size_t dataSize)
 {
-    uint8_t type;
-    int32_t playerId;
-    int32_t param1;
-    int32_t param2;
-    int32_t param3;
-    int32_t param4;
-    int32_t param5;
-    int32_t param6;
-    float paramF1;
-    float paramF2;
-    float paramF3;
-    float paramF4;
-    float paramF5;
-    uint16_t dataSize;
-    uint8_t data[MAX_MESSAGE_DATA_SIZE];
+    return (GUEST_GAME_MESSAGE_HEADER_SIZE + dataSize + 1 + 3) & ~(size_t)3;
+}
 
-    GameMessage() : type(0), playerId(-1),
-                    param1(0), param2(0), param3(0), param4(0), param5(0), param6(0),
-                    paramF1(0.0f), paramF2(0.0f), paramF3(0.0f), paramF4(0.0f), paramF5(0.0f),
-                    dataSize(0)
-    {
-        memset(data, 0, MAX_MESSAGE_DATA_SIZE);
-    }
+struct GameMessageHeader
+{
+    uint8_t type = 0;
+    int32_t playerId = -1;
+    int32_t param1 = 0;
+    int32_t param2 = 0;
+    int32_t param3 = 0;
+    int32_t param4 = 0;
+    int32_t param5 = 0;
+    int32_t param6 = 0;
+    float paramF1 = 0.0f;
+    float paramF2 = 0.0f;
+    float paramF3 = 0.0f;
+    float paramF4 = 0.0f;
+    float paramF5 = 0.0f;
+    uint16_t dataSize = 0;
 };
 
+// A message built up before it's pushed. Only the first dataSize bytes of
+// data are ever copied or read
+struct GameMessage : GameMessageHeader
+{
+    uint8_t data[MAX_MESSAGE_DATA_SIZE];
+};
+
+// the payload following a header reserved in the queue
+inline uint8_t *MessageData(GameMessageHeader *header)
+{
+    return reinterpret_cast<uint8_t *>(header + 1);
+}
+
+// Game messages waiting for net_msg_poll_batch, as variable-length records:
+// a header and just the payload it carries. Any thread may Push (the network
+// client, console input, the connect/disconnect exports); only the thread
+// calling net_msg_poll_batch may Pop or Clear. Space is preallocated, so
+// pushing copies the message once and never allocates or takes a lock.
+// Reserve and Commit skip even that copy, for a producer that builds the
+// message in place.
 class MessageQueue
 {
 private:
-    std::queue<GameMessage> m_queue;
-    mutable std::mutex m_mutex;
-    static constexpr size_t MAX_QUEUE_SIZE = 1024;
+    // 80 bytes a record for the usual payload-less message
+    static constexpr size_t QUEUE_BYTES = 128 * 1024;
+    MpscRecordRing<QUEUE_BYTES> m_ring;
 
 public:
     MessageQueue() = default;
@@ -71,45 +98,73 @@ public:
 
     bool Push(const GameMessage &msg)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_queue.size() >= MAX_QUEUE_SIZE)
+        // the Create* helpers never make one this big. rejecting rather than
+        // clamping also keeps GCC from inlining the copy below as rep movs,
+        // which costs more than the whole push for a short string
+        if (msg.dataSize > MAX_MESSAGE_DATA_SIZE)
+        {
+            return false;
+        }
+
+        size_t ticket;
+        GameMessageHeader *header = Reserve(msg.dataSize, ticket);
+        if (header == nullptr)
         {
             return false;
         }
-        m_queue.push(msg);
+
+        *header = msg;
+        memcpy(MessageData(header), msg.data, msg.dataSize);
+        Commit(ticket);
         return true;
     }
 
-    bool Pop(GameMessage &msg)
+    // a cleared header with room for dataSize payload bytes after it (see
+    // MessageData), or null if the queue is full. must be committed with
+    // the same ticket
+    GameMessageHeader *Reserve(size_t dataSize, size_t &ticket)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_queue.empty())
+        if (dataSize > MAX_MESSAGE_PAYLOAD_SIZE)
         {
-            return false;
+            return nullptr;
         }
-        msg = m_queue.front();
-        m_queue.pop();
-        return true;
+
+        uint8_t *record = m_ring.TryClaim(sizeof(GameMessageHeader) + dataSize, ticket);
+        if (record == nullptr)
+        {
+            return nullptr;
+        }
+
+        return new (record) GameMessageHeader();
     }
 
-    bool HasMessages() const
+    void Commit(size_t ticket)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        return !m_queue.empty();
+        m_ring.Publish(ticket);
     }
 
-    size_t Size() const
+    // hands the oldest message to fn(header, data), which returns true to
+    // take it off the queue or false to leave it there
+    template <typename Fn>
+    bool Pop(Fn &&fn)
+    {
+        return m_ring.TryPop([&](const uint8_t *record, size_t)
+                             {
+                                 const GameMessageHeader &header = *reinterpret_cast<const GameMessageHeader *>(record);
+                                 return fn(header, record + sizeof(GameMessageHeader));
+                             });
+    }
+
+    bool HasMessages() const
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        return m_queue.size();
+        return !m_ring.Empty();
     }
 
     void Clear()
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        while (!m_queue.empty())
+        while (m_ring.TryPop([](const uint8_t *, size_t)
+                             { return true; }))
         {
-            m_queue.pop();
         }
     }
 };
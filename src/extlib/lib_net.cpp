@@ -1,18 +1,110 @@
 #include "lib_net.h"
+#include "lib_packet_table.h"
+#include "lib_packet_codec.h"
+#include "lib_bulk_compress.h"
 #include "debug_log.h"
 #include <iostream>
 #include <chrono>
 #include <sstream>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
 
 extern void coop_dll_log(const char *msg);
 
-const uint32_t HANDSHAKE_INTERVAL_MS = 1000;
 const uint32_t PING_INTERVAL_MS = 10000;
 
-NetworkClient::NetworkClient()
-    : m_udpSocket(INVALID_SOCKET), m_isConnected(false), m_needsInit(false),
-      m_lastHandshakeTime(0), m_lastPingTime(0), m_lastPacketSentTime(0), m_reliableSeqCounter(0)
+// resolve/handshake retries back off exponentially between these,
+// and we give up (Failed) after CONNECT_MAX_ATTEMPTS tries (a bit over a minute)
+const uint32_t CONNECT_INITIAL_BACKOFF_MS = 500;
+const uint32_t CONNECT_MAX_BACKOFF_MS = 8000;
+const uint32_t CONNECT_MAX_ATTEMPTS = 12;
+
+const uint16_t SERVER_PORT = 8756;
+
+// the server only talks when there's something to say, so after this long
+// without a datagram we ping to get one back
+const uint32_t LINK_PROBE_MS = 3000;
+// and after this long we assume the link dropped and handshake again,
+// resuming our session
+const uint32_t LINK_TIMEOUT_MS = 15000;
+
+// state seqs applied out of order that we'll track. a gap this wide means
+// the server gave up resending something, so we full sync to cover it
+const size_t STATE_AHEAD_MAX = 256;
+
+// how long the io thread blocks waiting for a datagram before
+// running its timers (handshake/ping) again
+const uint32_t IO_THREAD_WAIT_MS = 5;
+
+// reliable retransmission tuning.
+// RTO follows RFC 6298 (srtt + 4 * rttvar) clamped to [MIN, MAX],
+// doubled for each resend of the same packet
+const uint32_t RELIABLE_INITIAL_RTO_MS = 250;
+const uint32_t RELIABLE_MIN_RTO_MS = 40;
+const uint32_t RELIABLE_MAX_RTO_MS = 2000;
+const uint8_t RELIABLE_MAX_ATTEMPTS = 10;
+const size_t RELIABLE_MAX_IN_FLIGHT = 64;
+const size_t RELIABLE_MAX_BACKLOG = 1024;
+const size_t RELIABLE_POOL_SIZE = RELIABLE_MAX_IN_FLIGHT + RELIABLE_MAX_BACKLOG;
+
+// pool datagrams start with room for any of the small collectible packets,
+// only blobs bigger than this grow one (once)
+const size_t RELIABLE_SLOT_RESERVE = 64;
+
+// an incoming seq this far behind the newest one we've seen means the
+// sender restarted its counter rather than that we got a stale duplicate
+const uint32_t RELIABLE_RECV_RESTART_GAP = 0x10000;
+
+// coalesced acks go out at most this often (about one frame), so the io
+// thread waking per datagram doesn't turn back into one ack per packet
+const uint32_t ACK_FLUSH_INTERVAL_MS = 16;
+
+// outgoing messages are packed into one datagram per frame up to this size.
+// kept under the usual 1280 byte IPv6 minimum MTU so nothing fragments
+const size_t BUNDLE_MTU = 1200;
+
+// the game skips native_update_network for a while after map changes, so a
+// bundle that's been open this long goes out on the next send regardless
+const uint32_t BUNDLE_MAX_HOLD_MS = 50;
+
+// a partial message whose missing fragments haven't turned up in this long
+// is dropped (the sender gives up on a reliable packet well before that)
+const uint32_t FRAGMENT_TIMEOUT_MS = 20000;
+// partial messages held at once; the oldest is evicted past this
+const size_t FRAGMENT_MAX_ASSEMBLIES = 8;
+
+NetworkClient::NetworkClient(MessageQueue &messages)
+    : m_udpSocket(INVALID_SOCKET), m_state(ConnectionState::Idle), m_threaded(false),
+      m_connectAttempts(0), m_nextConnectAttemptTime(0), m_connectStartTime(0), m_localPlayerId(-1), m_capabilities(0), m_puppetNextBaselineId(0), m_puppetSinceKeyframe(0), m_puppetAckedBaseline(-1), m_progressResync(false), m_lastPingTime(0), m_lastReceiveTime(0), m_lastPacketSentTime(0), m_reliableSeqCounter(1),
+      m_reliableBacklogHead(0), m_reliableBacklogCount(0),
+      m_srttMs(0), m_rttVarMs(0), m_rtoMs(RELIABLE_INITIAL_RTO_MS), m_hasRttSample(false),
+      m_messages(messages), m_messageReserved(false), m_messageTicket(0),
+      m_reliableDuplicatesDropped(0), m_hasSession(false), m_resumeRequested(false), m_sessionToken(0),
+      m_stateApplied(0), m_nextFragmentId(0), m_ackPending(false), m_ackHighest(0), m_ackMask(0),
+      m_ackOldestUnsent(0), m_lastAckFlushTime(0),
+      m_sendAllocations(0), m_outFrameRecords(0), m_outFrameOpenedTime(0), m_ioRunning(false)
 {
+    // everything the send path needs is allocated once, up front
+    m_outFrame.reserve(BUNDLE_MTU);
+    m_stateAhead.reserve(STATE_AHEAD_MAX + 1);
+
+    m_reliablePool.resize(RELIABLE_POOL_SIZE);
+    m_reliableFreeSlots.reserve(RELIABLE_POOL_SIZE);
+    m_reliableInFlight.reserve(RELIABLE_MAX_IN_FLIGHT);
+    m_reliableBacklog.resize(RELIABLE_POOL_SIZE);
+
+    for (size_t i = 0; i < RELIABLE_POOL_SIZE; i++)
+    {
+        m_reliablePool[i].datagram.reserve(RELIABLE_SLOT_RESERVE);
+        m_reliableFreeSlots.push_back((uint16_t)(RELIABLE_POOL_SIZE - 1 - i));
+    }
+
+    for (std::vector<uint8_t> &sent : m_progressSent)
+    {
+        sent.reserve(PROGRESS_BLOB_MAX_SIZE);
+    }
+
 #ifdef _WIN32
     WSADATA wsaData;
     int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
@@ -25,27 +117,117 @@ NetworkClient::NetworkClient()
 
 NetworkClient::~NetworkClient()
 {
-    if (m_udpSocket != INVALID_SOCKET)
-    {
+    StopIoThread();
+    CloseSocket();
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "[COOP][NET] session stats: send allocations=%u, duplicate reliables dropped=%u",
+             m_sendAllocations.load(), m_reliableDuplicatesDropped);
+    coop_dll_log(msg);
+
 #ifdef _WIN32
-        closesocket(m_udpSocket);
-        WSACleanup();
-#else
-        close(m_udpSocket);
+    WSACleanup();
 #endif
-    }
 }
 
 void NetworkClient::Configure(const std::string &host, const std::string &user, const std::string &lobby, const std::string &pass)
 {
+    // the io thread reads all of this, so park it while we swap settings
+    StopIoThread();
+
+    // reconnecting to the same lobby keeps the session, so the handshake resumes it
+    if (host != m_host || user != m_user || lobby != m_lobby)
+    {
+        ResetSession();
+    }
+
     m_host = host;
     m_user = user;
     m_lobby = lobby;
     m_pass = pass;
-    m_needsInit = true;
 
-    m_isConnected = false;
-    m_lastHandshakeTime = 0;
+    m_addressLookup.reset();
+    BeginConnectAttempts(ConnectionState::Resolving, GetClockMS());
+    ResetReliableState();
+    m_reliableRecvWindows.clear();
+    m_fragments.clear();
+
+    if (m_threaded)
+    {
+        StartIoThread();
+    }
+}
+
+void NetworkClient::SetThreaded(bool threaded)
+{
+    if (threaded == m_threaded)
+    {
+        return;
+    }
+
+    m_threaded = threaded;
+
+    if (m_threaded && !m_host.empty())
+    {
+        StartIoThread();
+    }
+    else if (!m_threaded)
+    {
+        StopIoThread();
+    }
+}
+
+void NetworkClient::StartIoThread()
+{
+    if (m_ioRunning.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    m_ioRunning.store(true, std::memory_order_release);
+    m_ioThread = std::thread(&NetworkClient::IoThreadMain, this);
+}
+
+void NetworkClient::StopIoThread()
+{
+    m_ioRunning.store(false, std::memory_order_release);
+
+    if (m_ioThread.joinable())
+    {
+        m_ioThread.join();
+    }
+}
+
+void NetworkClient::IoThreadMain()
+{
+    while (m_ioRunning.load(std::memory_order_acquire))
+    {
+        Poll();
+        FlushOutgoing();
+        WaitForSocket(IO_THREAD_WAIT_MS);
+    }
+}
+
+void NetworkClient::WaitForSocket(uint32_t timeoutMs)
+{
+    SOCKET sock = m_udpSocket;
+
+    // nothing to wait on yet (or we're backed up on events), just nap
+    if (sock == INVALID_SOCKET || !m_messageOverflow.empty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        return;
+    }
+
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(sock, &readSet);
+
+    struct timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = (long)timeoutMs * 1000;
+
+    select((int)sock + 1, &readSet, nullptr, nullptr, &tv);
 }
 
 uint32_t NetworkClient::GetClockMS()
@@ -54,8 +236,10 @@ uint32_t NetworkClient::GetClockMS()
     return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
 }
 
-bool NetworkClient::PerformLazyInit()
+void NetworkClient::CloseSocket()
 {
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+
     if (m_udpSocket != INVALID_SOCKET)
     {
 #ifdef _WIN32
@@ -63,952 +247,2232 @@ bool NetworkClient::PerformLazyInit()
 #else
         close(m_udpSocket);
 #endif
+        m_udpSocket = INVALID_SOCKET;
     }
 
-    m_udpSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (m_udpSocket == INVALID_SOCKET)
+    m_outFrame.clear();
+    m_outFrameRecords = 0;
+}
+
+// starts working out m_host's address for the Resolving state to pick up.
+// a dotted address is done on the spot, a name is looked up on a helper
+// thread so neither the game thread nor the senders wait on DNS
+void NetworkClient::StartAddressLookup()
+{
+    auto lookup = std::make_shared<AddressLookup>();
+    lookup->host = m_host;
+    lookup->addr.sin_family = AF_INET;
+    lookup->addr.sin_port = htons(SERVER_PORT);
+    m_addressLookup = lookup;
+
+    if (inet_pton(AF_INET, lookup->host.c_str(), &lookup->addr.sin_addr) > 0)
+    {
+        lookup->result.store(AddressLookup::Resolved, std::memory_order_release);
+        return;
+    }
+
+    std::thread([lookup]()
+                {
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+
+        struct addrinfo *result = nullptr;
+        if (getaddrinfo(lookup->host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr)
+        {
+            lookup->result.store(AddressLookup::Failed, std::memory_order_release);
+            return;
+        }
+
+        lookup->addr.sin_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
+        freeaddrinfo(result);
+        lookup->result.store(AddressLookup::Resolved, std::memory_order_release); })
+        .detach();
+}
+
+// opens a fresh socket for the server at addr. it's set up before taking
+// m_sendMutex, which is only held to swap it in
+bool NetworkClient::OpenSocket(const struct sockaddr_in &addr)
+{
+    SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == INVALID_SOCKET)
     {
         return false;
     }
 
 #ifdef _WIN32
     u_long mode = 1;
-    ioctlsocket(m_udpSocket, FIONBIO, &mode);
+    ioctlsocket(sock, FIONBIO, &mode);
 #else
-    int flags = fcntl(m_udpSocket, F_GETFL, 0);
-    fcntl(m_udpSocket, F_SETFL, flags | O_NONBLOCK);
+    int flags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
 #endif
 
-    memset(&m_serverAddr, 0, sizeof(m_serverAddr));
-    m_serverAddr.sin_family = AF_INET;
-    m_serverAddr.sin_port = htons(8756);
+    CloseSocket();
+
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    m_serverAddr = addr;
+    m_udpSocket = sock;
+    return true;
+}
 
-    if (inet_pton(AF_INET, m_host.c_str(), &m_serverAddr.sin_addr) <= 0)
+// 500ms, 1s, 2s, 4s, then 8s apart
+static uint32_t ConnectBackoffMs(uint32_t attempts)
+{
+    uint32_t shift = attempts > 0 ? attempts - 1 : 0;
+    if (shift > 4)
     {
-        return false;
+        return CONNECT_MAX_BACKOFF_MS;
     }
 
-    return true;
+    return std::min(CONNECT_INITIAL_BACKOFF_MS << shift, CONNECT_MAX_BACKOFF_MS);
 }
 
-void NetworkClient::SendRawPacket(PacketType type, const void *data, size_t size)
+// moves the connection along and queues the change for the game thread
+void NetworkClient::SetState(ConnectionState state, uint32_t latencyMs)
 {
-    if (m_udpSocket == INVALID_SOCKET)
+    if (m_state.load(std::memory_order_relaxed) == state)
     {
         return;
     }
 
-    std::vector<uint8_t> buffer(1 + size);
-    buffer[0] = static_cast<uint8_t>(type);
+    m_state.store(state, std::memory_order_release);
+
+    ConnectionStatus status;
+    status.state = state;
+    status.playerId = m_localPlayerId;
+    status.latencyMs = latencyMs;
+
+    // the game only cares about the latest, so a full queue just drops this
+    m_statusQueue.TryPush(std::move(status));
+}
+
+// starts a fresh run of resolve/handshake attempts, the first one right away
+void NetworkClient::BeginConnectAttempts(ConnectionState state, uint32_t now)
+{
+    m_connectAttempts = 0;
+    m_nextConnectAttemptTime = now;
+    m_connectStartTime = now;
+    SetState(state);
+}
+
+void NetworkClient::SendHandshake()
+{
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+
+    PacketWriter writer = BeginPacketLocked(PacketType::Handshake);
+    writer.WriteString32BE(m_lobby);
+    writer.WriteString32BE(m_pass);
+    writer.WriteString32BE(m_user);
+
+    if (m_hasSession)
+    {
+        writer.WriteU64BE(m_sessionToken);
+        writer.WriteU32BE(m_stateApplied);
+        m_resumeRequested = true;
+    }
+    else
+    {
+        writer.WriteU64BE(0);
+        writer.WriteU32BE(0);
+    }
+
+    writer.WriteU16BE(PROTOCOL_VERSION);
+    writer.WriteU32BE(CLIENT_CAPABILITIES);
 
-    if (size > 0 && data != nullptr)
+    FinishPacketLocked(writer);
+}
+
+bool NetworkClient::TransmitLocked(const uint8_t *data, size_t size)
+{
+    if (m_udpSocket == INVALID_SOCKET)
     {
-        std::memcpy(&buffer[1], data, size);
+        return false;
     }
 
-    int sent = sendto(m_udpSocket, (const char *)buffer.data(), (int)buffer.size(), 0,
+    int sent = sendto(m_udpSocket, (const char *)data, (int)size, 0,
                       (struct sockaddr *)&m_serverAddr, sizeof(m_serverAddr));
 
     if (sent >= 0)
     {
         m_lastPacketSentTime = GetClockMS();
+        return true;
     }
+
+    return false;
 }
 
-bool NetworkClient::IsReliableType(PacketType type)
+// appends a complete datagram (type + payload) to this frame's bundle.
+// it goes out on the next FlushOutgoing, or sooner if the bundle fills up
+bool NetworkClient::SendDatagramLocked(const uint8_t *data, size_t size)
 {
-    return type == PacketType::JiggyCollected ||
-           type == PacketType::NoteCollected ||
-           type == PacketType::NoteCollectedPos ||
-           type == PacketType::NoteSaveData ||
-           type == PacketType::FileProgressFlags ||
-           type == PacketType::AbilityProgress ||
-           type == PacketType::HoneycombScore ||
-           type == PacketType::MumboScore ||
-           type == PacketType::HoneycombCollected ||
-           type == PacketType::MumboTokenCollected ||
-           type == PacketType::LevelOpened ||
-           type == PacketType::FullSyncRequest;
+    if (m_udpSocket == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    // too big to share a datagram, flush first so ordering holds and send it alone
+    if (BUNDLE_HEADER_SIZE + BUNDLE_RECORD_HEADER_SIZE + size > BUNDLE_MTU)
+    {
+        FlushOutgoingLocked();
+        return TransmitLocked(data, size);
+    }
+
+    if (m_outFrame.size() + BUNDLE_RECORD_HEADER_SIZE + size > BUNDLE_MTU)
+    {
+        FlushOutgoingLocked();
+    }
+
+    uint32_t now = GetClockMS();
+
+    if (m_outFrame.empty())
+    {
+        m_outFrame.push_back(static_cast<uint8_t>(PacketType::Bundle));
+        m_outFrameOpenedTime = now;
+    }
+
+    m_outFrame.push_back(size & 0xFF);
+    m_outFrame.push_back((size >> 8) & 0xFF);
+    m_outFrame.insert(m_outFrame.end(), data, data + size);
+    m_outFrameRecords++;
+
+    if (now - m_outFrameOpenedTime >= BUNDLE_MAX_HOLD_MS)
+    {
+        FlushOutgoingLocked();
+    }
+
+    return true;
 }
 
-void NetworkClient::SendReliablePacket(PacketType type, const void *data, size_t size)
+bool NetworkClient::FlushOutgoingLocked()
 {
-    if (m_udpSocket == INVALID_SOCKET)
+    if (m_outFrameRecords == 0)
     {
-        return;
+        return true;
+    }
+
+    bool sent;
+
+    // a lone message goes out as itself, no point paying for the bundle header
+    if (m_outFrameRecords == 1)
+    {
+        const size_t offset = BUNDLE_HEADER_SIZE + BUNDLE_RECORD_HEADER_SIZE;
+        sent = TransmitLocked(&m_outFrame[offset], m_outFrame.size() - offset);
+    }
+    else
+    {
+        sent = TransmitLocked(m_outFrame.data(), m_outFrame.size());
     }
 
-    uint32_t seq = m_reliableSeqCounter++;
-    std::vector<uint8_t> buffer(1 + 4 + size);
-    buffer[0] = static_cast<uint8_t>(type);
+    m_outFrame.clear();
+    m_outFrameRecords = 0;
+
+    return sent;
+}
+
+void NetworkClient::FlushOutgoing()
+{
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    FlushOutgoingLocked();
+}
 
-    buffer[1] = (seq) & 0xFF;
-    buffer[2] = (seq >> 8) & 0xFF;
-    buffer[3] = (seq >> 16) & 0xFF;
-    buffer[4] = (seq >> 24) & 0xFF;
+void NetworkClient::SendRawPacket(PacketType type, const void *data, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_sendMutex);
 
-    if (size > 0 && data != nullptr)
+    if (m_udpSocket == INVALID_SOCKET)
     {
-        std::memcpy(&buffer[5], data, size);
+        return;
     }
 
-    int sent = sendto(m_udpSocket, (const char *)buffer.data(), (int)buffer.size(), 0,
-                      (struct sockaddr *)&m_serverAddr, sizeof(m_serverAddr));
+    PacketWriter writer = BeginPacketLocked(type);
 
-    if (sent >= 0)
+    if (data != nullptr)
     {
-        m_lastPacketSentTime = GetClockMS();
+        writer.WriteBytes(data, size);
     }
+
+    FinishPacketLocked(writer);
 }
 
-void NetworkClient::SendPing()
+// starts a packet in the send scratch buffer. only valid while m_sendMutex is held,
+// and only until the next BeginPacketLocked
+PacketWriter NetworkClient::BeginPacketLocked(PacketType type)
 {
-    SendRawPacket(PacketType::Ping, nullptr, 0);
+    PacketWriter writer(m_sendScratch.data(), m_sendScratch.size());
+    writer.WriteU8(static_cast<uint8_t>(type));
+    return writer;
 }
 
-void NetworkClient::Update()
+bool NetworkClient::FinishPacketLocked(const PacketWriter &writer)
 {
-    if (m_needsInit)
+    if (!writer.Ok())
     {
-        if (PerformLazyInit())
-        {
-            m_needsInit = false;
-        }
-        else
-        {
-            return;
-        }
+        char msg[128];
+        snprintf(msg, sizeof(msg), "[COOP][NET] dropping oversized packet type=%d", (int)writer.Data()[0]);
+        coop_dll_log(msg);
+        return false;
+    }
+
+    return SendDatagramLocked(writer.Data(), writer.Size());
+}
+
+// false if the packet was dropped rather than queued
+bool NetworkClient::SendReliablePacket(PacketType type, const void *data, size_t size)
+{
+    // anything that couldn't share a bundle goes out in pieces instead
+    if (1 + 4 + size > BUNDLE_MTU - BUNDLE_HEADER_SIZE - BUNDLE_RECORD_HEADER_SIZE)
+    {
+        return SendFragmented(type, data, size);
     }
 
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+
     if (m_udpSocket == INVALID_SOCKET)
     {
-        return;
+        return false;
     }
 
-    uint32_t now = GetClockMS();
+    if (m_reliableFreeSlots.empty())
+    {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "[COOP][NET] reliable backlog full, dropping type=%d", (int)type);
+        coop_dll_log(msg);
+        return false;
+    }
 
-    if (!m_isConnected && (now - m_lastHandshakeTime > HANDSHAKE_INTERVAL_MS))
+    const size_t datagramSize = 1 + 4 + size;
+    if (datagramSize > NET_MAX_DATAGRAM_SIZE)
     {
-        std::vector<uint8_t> buffer;
+        char msg[128];
+        snprintf(msg, sizeof(msg), "[COOP][NET] dropping oversized reliable packet type=%d size=%zu", (int)type, size);
+        coop_dll_log(msg);
+        return false;
+    }
+
+    QueueReliableLocked(type, data, size);
+    PumpReliableBacklogLocked(GetClockMS());
+    return true;
+}
 
-        uint32_t lobby_len = (uint32_t)m_lobby.size();
-        buffer.push_back((lobby_len >> 24) & 0xFF);
-        buffer.push_back((lobby_len >> 16) & 0xFF);
-        buffer.push_back((lobby_len >> 8) & 0xFF);
-        buffer.push_back(lobby_len & 0xFF);
-        buffer.insert(buffer.end(), m_lobby.begin(), m_lobby.end());
+// puts a reliable packet on the backlog. the caller has checked there's a
+// free slot and that it fits a datagram
+void NetworkClient::QueueReliableLocked(PacketType type, const void *data, size_t size)
+{
+    const size_t datagramSize = 1 + 4 + size;
+    uint16_t slot = m_reliableFreeSlots.back();
+    m_reliableFreeSlots.pop_back();
+
+    PendingReliable &pending = m_reliablePool[slot];
+    pending.seq = m_reliableSeqCounter++;
+    pending.lastSendTime = 0;
+    pending.attempts = 0;
 
-        uint32_t pass_len = (uint32_t)m_pass.size();
-        buffer.push_back((pass_len >> 24) & 0xFF);
-        buffer.push_back((pass_len >> 16) & 0xFF);
-        buffer.push_back((pass_len >> 8) & 0xFF);
-        buffer.push_back(pass_len & 0xFF);
-        buffer.insert(buffer.end(), m_pass.begin(), m_pass.end());
+    if (pending.datagram.capacity() < datagramSize)
+    {
+        m_sendAllocations++;
+    }
+    pending.datagram.resize(datagramSize);
 
-        uint32_t user_len = (uint32_t)m_user.size();
-        buffer.push_back((user_len >> 24) & 0xFF);
-        buffer.push_back((user_len >> 16) & 0xFF);
-        buffer.push_back((user_len >> 8) & 0xFF);
-        buffer.push_back(user_len & 0xFF);
-        buffer.insert(buffer.end(), m_user.begin(), m_user.end());
+    PacketWriter writer(pending.datagram.data(), pending.datagram.size());
+    writer.WriteU8(static_cast<uint8_t>(type));
+    writer.WriteU32LE(pending.seq);
 
-        SendRawPacket(PacketType::Handshake, buffer.data(), buffer.size());
-        m_lastHandshakeTime = now;
+    if (data != nullptr)
+    {
+        writer.WriteBytes(data, size);
     }
 
-    if (m_isConnected)
+    m_reliableBacklog[(m_reliableBacklogHead + m_reliableBacklogCount) % RELIABLE_POOL_SIZE] = slot;
+    m_reliableBacklogCount++;
+}
+
+// sends a reliable packet as Compressed when the server takes it and that's smaller
+bool NetworkClient::SendBulkPacket(PacketType type, const void *data, size_t size)
+{
+    if (size > COMPRESSED_HEADER_MIN_SIZE && (m_capabilities.load(std::memory_order_relaxed) & CAPABILITY_COMPRESSION))
     {
-        if (now - m_lastPacketSentTime > PING_INTERVAL_MS)
+        uint8_t packed[NET_MAX_DATAGRAM_SIZE];
+        PacketWriter writer(packed, std::min(sizeof(packed), size - 1));
+        writer.WriteU8(static_cast<uint8_t>(type));
+        writer.WriteVarU32((uint32_t)size);
+
+        if (PackBits((const uint8_t *)data, size, writer))
         {
-            SendPing();
-            m_lastPingTime = now;
+            return SendReliablePacket(PacketType::Compressed, writer.Data(), writer.Size());
         }
     }
 
-    struct sockaddr_in from;
-    int fromLen = sizeof(from);
-    uint8_t buf[2048];
+    return SendReliablePacket(type, data, size);
+}
 
-    while (true)
+bool NetworkClient::SendFragmented(PacketType type, const void *data, size_t size)
+{
+    const size_t total = 1 + size;
+    if (total > FRAGMENT_MAX_MESSAGE_SIZE)
     {
-        int len = recvfrom(m_udpSocket, (char *)buf, sizeof(buf), 0, (struct sockaddr *)&from, &fromLen);
+        char msg[128];
+        snprintf(msg, sizeof(msg), "[COOP][NET] dropping oversized message type=%d size=%zu", (int)type, size);
+        coop_dll_log(msg);
+        return false;
+    }
 
-        if (len > 0)
-        {
-            uint8_t type = buf[0];
-            uint8_t *payload = &buf[1];
-            int payload_len = len - 1;
+    const uint8_t *bytes = (const uint8_t *)data;
+    const uint16_t id = m_nextFragmentId.fetch_add(1, std::memory_order_relaxed);
+    const uint16_t count = (uint16_t)((total + FRAGMENT_CHUNK_SIZE - 1) / FRAGMENT_CHUNK_SIZE);
 
-            if (IsReliableType(static_cast<PacketType>(type)) && payload_len >= 4)
-            {
-                uint32_t seq;
-                std::memcpy(&seq, payload, 4);
+    std::lock_guard<std::mutex> lock(m_sendMutex);
 
-                SendRawPacket(PacketType::ReliableAck, &seq, 4);
+    if (m_udpSocket == INVALID_SOCKET)
+    {
+        return false;
+    }
 
-                payload += 4;
-                payload_len -= 4;
-            }
+    // all or nothing: the server can't finish a message missing fragments,
+    // and would hold the rest against its per-sender limit until it times out
+    if (m_reliableFreeSlots.size() < count)
+    {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "[COOP][NET] reliable backlog full, dropping type=%d (%u fragments)", (int)type, (unsigned)count);
+        coop_dll_log(msg);
+        return false;
+    }
 
-            if (!m_isConnected)
-            {
-                m_isConnected = true;
-                m_lastPacketSentTime = now;
-                RequestFullSync();
-            }
+    for (uint16_t index = 0; index < count; index++)
+    {
+        uint8_t fragment[FRAGMENT_HEADER_SIZE + FRAGMENT_CHUNK_SIZE];
+        PacketWriter writer(fragment, sizeof(fragment));
+        writer.WriteU16LE(id);
+        writer.WriteU16LE(index);
+        writer.WriteU16LE(count);
 
-            switch (static_cast<PacketType>(type))
-            {
-            case PacketType::PlayerConnected:
-                HandlePlayerConnected(payload, payload_len);
-                break;
-            case PacketType::PlayerDisconnected:
-                HandlePlayerDisconnected(payload, payload_len);
-                break;
-            case PacketType::JiggyCollected:
-                HandleJiggyCollected(payload, payload_len);
-                break;
-            case PacketType::NoteCollected:
-                HandleNoteCollected(payload, payload_len);
-                break;
-            case PacketType::NoteCollectedPos:
-                HandleNoteCollectedPos(payload, payload_len);
-                break;
-            case PacketType::NoteSaveData:
-                HandleNoteSaveData(payload, payload_len);
-                break;
-            case PacketType::PuppetUpdate:
-                HandlePuppetUpdate(payload, payload_len);
-                break;
-            case PacketType::LevelOpened:
-                HandleLevelOpened(payload, payload_len);
-                break;
-            case PacketType::Pong:
-                break;
-            case PacketType::InitialSaveDataRequest:
+        // the message is [type][payload], so the first chunk carries the type byte
+        size_t start = (size_t)index * FRAGMENT_CHUNK_SIZE;
+        size_t end = std::min(start + FRAGMENT_CHUNK_SIZE, total);
 
-                break;
-            case PacketType::FileProgressFlags:
-                HandleFileProgressFlags(payload, payload_len);
-                break;
-            case PacketType::AbilityProgress:
-                HandleAbilityProgress(payload, payload_len);
-                break;
-            case PacketType::HoneycombScore:
-                HandleHoneycombScore(payload, payload_len);
-                break;
-            case PacketType::MumboScore:
-                HandleMumboScore(payload, payload_len);
-                break;
-            case PacketType::HoneycombCollected:
-                HandleHoneycombCollected(payload, payload_len);
-                break;
-            case PacketType::MumboTokenCollected:
-                HandleMumboTokenCollected(payload, payload_len);
-                break;
-            case PacketType::PlayerInfoRequest:
-                HandlePlayerInfoRequest(payload, payload_len);
-                break;
-            case PacketType::PlayerInfoResponse:
-                HandlePlayerInfoResponse(payload, payload_len);
-                break;
-            case PacketType::PlayerListUpdate:
-                HandlePlayerListUpdate(payload, payload_len);
-                break;
-            default:
-                break;
-            }
+        if (start == 0)
+        {
+            writer.WriteU8(static_cast<uint8_t>(type));
+            start = 1;
         }
-        else
+
+        writer.WriteBytes(bytes + (start - 1), end - start);
+        QueueReliableLocked(PacketType::Fragment, writer.Data(), writer.Size());
+    }
+
+    PumpReliableBacklogLocked(GetClockMS());
+    return true;
+}
+
+// moves packets from the backlog into the in-flight window while there's room
+void NetworkClient::PumpReliableBacklogLocked(uint32_t now)
+{
+    while (m_reliableBacklogCount > 0 && m_reliableInFlight.size() < RELIABLE_MAX_IN_FLIGHT)
+    {
+        uint16_t slot = m_reliableBacklog[m_reliableBacklogHead];
+        m_reliableBacklogHead = (m_reliableBacklogHead + 1) % RELIABLE_POOL_SIZE;
+        m_reliableBacklogCount--;
+
+        PendingReliable &pending = m_reliablePool[slot];
+        pending.attempts = 1;
+        pending.lastSendTime = now;
+        SendDatagramLocked(pending.datagram.data(), pending.datagram.size());
+
+        m_reliableInFlight.push_back(slot);
+    }
+}
+
+void NetworkClient::ReleaseReliableSlotLocked(uint16_t slot)
+{
+    m_reliableFreeSlots.push_back(slot);
+}
+
+void NetworkClient::ResetReliableState()
+{
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+
+    for (uint16_t slot : m_reliableInFlight)
+    {
+        ReleaseReliableSlotLocked(slot);
+    }
+    for (size_t i = 0; i < m_reliableBacklogCount; i++)
+    {
+        ReleaseReliableSlotLocked(m_reliableBacklog[(m_reliableBacklogHead + i) % RELIABLE_POOL_SIZE]);
+    }
+
+    m_reliableInFlight.clear();
+    m_reliableBacklogHead = 0;
+    m_reliableBacklogCount = 0;
+    m_srttMs = 0;
+    m_rttVarMs = 0;
+    m_rtoMs = RELIABLE_INITIAL_RTO_MS;
+    m_hasRttSample = false;
+
+    m_ackPending = false;
+    m_ackHighest = 0;
+    m_ackMask = 0;
+    m_ackOldestUnsent = 0;
+}
+
+bool NetworkClient::AcceptReliableSequence(const struct sockaddr_in &from, uint32_t seq)
+{
+    uint64_t key = ((uint64_t)from.sin_addr.s_addr << 16) | from.sin_port;
+    return m_reliableRecvWindows[key].Accept(seq);
+}
+
+void NetworkClient::QueueReliableAck(const struct sockaddr_in &from, uint32_t seq)
+{
+    uint64_t key = ((uint64_t)from.sin_addr.s_addr << 16) | from.sin_port;
+    const ReliableReceiveWindow &window = m_reliableRecvWindows[key];
+
+    // anything the ack block can't describe gets acked on its own
+    uint32_t age = window.highest - seq;
+    if (age > RELIABLE_ACK_MASK_BITS)
+    {
+        SendRawPacket(PacketType::ReliableAck, &seq, 4);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+
+    // a burst can slide the head far enough that the pending block would
+    // no longer reach the oldest seq it still owes an ack for, send it first
+    if (m_ackPending && window.highest - m_ackOldestUnsent > RELIABLE_ACK_MASK_BITS)
+    {
+        SendAckBlockLocked();
+        m_ackPending = false;
+    }
+
+    if (!m_ackPending || (int32_t)(seq - m_ackOldestUnsent) < 0)
+    {
+        m_ackOldestUnsent = seq;
+    }
+
+    m_ackHighest = window.highest;
+    m_ackMask = window.AckMask();
+    m_ackPending = true;
+}
+
+void NetworkClient::WriteAckBlockLocked(PacketWriter &writer) const
+{
+    writer.WriteU32LE(m_ackHighest);
+    writer.WriteU64LE(m_ackMask);
+}
+
+void NetworkClient::FlushPendingAcks()
+{
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+
+    if (m_ackPending && SendAckBlockLocked())
+    {
+        m_ackPending = false;
+    }
+}
+
+bool NetworkClient::SendAckBlockLocked()
+{
+    PacketWriter writer = BeginPacketLocked(PacketType::ReliableAckBatch);
+    WriteAckBlockLocked(writer);
+
+    return FinishPacketLocked(writer);
+}
+
+uint64_t ReliableReceiveWindow::AckMask() const
+{
+    static_assert(WINDOW_BITS > RELIABLE_ACK_MASK_BITS, "ack mask must fit inside the receive window");
+    return (seen[0] >> 1) | (seen[1] << 63);
+}
+
+void ReliableReceiveWindow::Reset()
+{
+    highest = 0;
+    seen.fill(0);
+    initialized = false;
+}
+
+void ReliableReceiveWindow::Advance(uint32_t count)
+{
+    // shift every recorded seq `count` places further from the head
+    if (count >= WINDOW_BITS)
+    {
+        seen.fill(0);
+        return;
+    }
+
+    const size_t words = seen.size();
+    const uint32_t wordShift = count / 64;
+    const uint32_t bitShift = count % 64;
+
+    for (size_t i = words; i-- > 0;)
+    {
+        uint64_t value = 0;
+
+        if (i >= wordShift)
+        {
+            value = seen[i - wordShift] << bitShift;
+
+            if (bitShift != 0 && i > wordShift)
+            {
+                value |= seen[i - wordShift - 1] >> (64 - bitShift);
+            }
+        }
+
+        seen[i] = value;
+    }
+}
+
+bool ReliableReceiveWindow::Accept(uint32_t seq)
+{
+    if (!initialized)
+    {
+        Reset();
+        initialized = true;
+        highest = seq;
+        seen[0] = 1;
+        return true;
+    }
+
+    // serial-number compare so the counter is free to wrap
+    int32_t diff = (int32_t)(seq - highest);
+
+    if (diff > 0)
+    {
+        Advance((uint32_t)diff);
+        highest = seq;
+        seen[0] |= 1;
+        return true;
+    }
+
+    uint32_t age = (uint32_t)(-(int64_t)diff);
+
+    if (age >= WINDOW_BITS)
+    {
+        if (age >= RELIABLE_RECV_RESTART_GAP)
+        {
+            Reset();
+            return Accept(seq);
+        }
+
+        return false;
+    }
+
+    uint64_t bit = 1ull << (age % 64);
+    uint64_t &word = seen[age / 64];
+
+    if (word & bit)
+    {
+        return false;
+    }
+
+    word |= bit;
+    return true;
+}
+
+void NetworkClient::UpdateRtt(uint32_t sampleMs)
+{
+    if (!m_hasRttSample)
+    {
+        m_srttMs = sampleMs;
+        m_rttVarMs = sampleMs / 2;
+        m_hasRttSample = true;
+    }
+    else
+    {
+        uint32_t delta = (m_srttMs > sampleMs) ? (m_srttMs - sampleMs) : (sampleMs - m_srttMs);
+        m_rttVarMs = (3 * m_rttVarMs + delta) / 4;
+        m_srttMs = (7 * m_srttMs + sampleMs) / 8;
+    }
+
+    uint32_t rto = m_srttMs + std::max<uint32_t>(4 * m_rttVarMs, 1);
+    m_rtoMs = std::clamp(rto, RELIABLE_MIN_RTO_MS, RELIABLE_MAX_RTO_MS);
+}
+
+void NetworkClient::HandleReliableAck(const uint8_t *data, int /*len*/)
+{
+    uint32_t seq;
+    std::memcpy(&seq, data, 4);
+
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+
+    for (auto it = m_reliableInFlight.begin(); it != m_reliableInFlight.end(); ++it)
+    {
+        const PendingReliable &pending = m_reliablePool[*it];
+        if (pending.seq != seq)
+            continue;
+
+        // Karn: only packets that went out once give an unambiguous RTT sample
+        if (pending.attempts == 1)
+        {
+            UpdateRtt(GetClockMS() - pending.lastSendTime);
+        }
+
+        ReleaseReliableSlotLocked(*it);
+        m_reliableInFlight.erase(it);
+        break;
+    }
+
+    PumpReliableBacklogLocked(GetClockMS());
+}
+
+void NetworkClient::ResendReliablePackets(uint32_t now)
+{
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+
+    for (auto it = m_reliableInFlight.begin(); it != m_reliableInFlight.end();)
+    {
+        PendingReliable &pending = m_reliablePool[*it];
+
+        uint32_t timeout = std::min(m_rtoMs << (pending.attempts - 1), RELIABLE_MAX_RTO_MS);
+        if (now - pending.lastSendTime < timeout)
+        {
+            ++it;
+            continue;
+        }
+
+        if (pending.attempts >= RELIABLE_MAX_ATTEMPTS)
+        {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "[COOP][NET] reliable seq=%u type=%d gave up after %d attempts",
+                     pending.seq, (int)pending.datagram[0], (int)pending.attempts);
+            coop_dll_log(msg);
+
+            ReleaseReliableSlotLocked(*it);
+            it = m_reliableInFlight.erase(it);
+            continue;
+        }
+
+        pending.attempts++;
+        pending.lastSendTime = now;
+        SendDatagramLocked(pending.datagram.data(), pending.datagram.size());
+        ++it;
+    }
+
+    PumpReliableBacklogLocked(now);
+}
+
+void NetworkClient::SendPing()
+{
+    SendRawPacket(PacketType::Ping, nullptr, 0);
+}
+
+// called every frame from native_update_network.
+// in threaded mode the io thread does the polling, so this is a no-op
+void NetworkClient::Update()
+{
+    if (m_threaded)
+    {
+        return;
+    }
+
+    Poll();
+}
+
+// runs the connection timers and drains the socket.
+// only ever called from one thread (the game thread, or the io thread when threaded)
+void NetworkClient::Poll()
+{
+    uint32_t now = GetClockMS();
+    ConnectionState state = m_state.load(std::memory_order_relaxed);
+
+    // nothing more to do until Configure is called again
+    if (state == ConnectionState::Idle || state == ConnectionState::Failed)
+    {
+        return;
+    }
+
+    bool attemptDue = (int32_t)(now - m_nextConnectAttemptTime) >= 0;
+
+    if (state == ConnectionState::Resolving)
+    {
+        if (!attemptDue)
+        {
+            return;
+        }
+
+        if (!m_addressLookup)
+        {
+            StartAddressLookup();
+        }
+
+        int result = m_addressLookup->result.load(std::memory_order_acquire);
+        if (result == AddressLookup::Pending)
+        {
+            return;
+        }
+
+        struct sockaddr_in addr = m_addressLookup->addr;
+        m_addressLookup.reset();
+
+        if (result == AddressLookup::Failed || !OpenSocket(addr))
+        {
+            if (++m_connectAttempts >= CONNECT_MAX_ATTEMPTS)
+            {
+                char msg[128];
+                snprintf(msg, sizeof(msg), "[COOP][NET] couldn't resolve %s, giving up", m_host.c_str());
+                coop_dll_log(msg);
+
+                SetState(ConnectionState::Failed);
+            }
+            else
+            {
+                m_nextConnectAttemptTime = now + ConnectBackoffMs(m_connectAttempts);
+            }
+            return;
+        }
+
+        BeginConnectAttempts(m_hasSession ? ConnectionState::Resuming : ConnectionState::Handshaking, now);
+        state = m_state.load(std::memory_order_relaxed);
+        attemptDue = true;
+    }
+
+    if (m_udpSocket == INVALID_SOCKET)
+    {
+        return;
+    }
+
+    if (state == ConnectionState::Connected && now - m_lastReceiveTime > LINK_TIMEOUT_MS)
+    {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "[COOP][NET] nothing from the server for %ums, reconnecting%s",
+                 now - m_lastReceiveTime, m_hasSession ? " (resuming session)" : "");
+        coop_dll_log(msg);
+
+        // if we come back from a new address the server numbers its reliables from scratch
+        m_reliableRecvWindows.clear();
+
+        BeginConnectAttempts(m_hasSession ? ConnectionState::Resuming : ConnectionState::Handshaking, now);
+        state = m_state.load(std::memory_order_relaxed);
+        attemptDue = true;
+    }
+
+    if ((state == ConnectionState::Handshaking || state == ConnectionState::Resuming) && attemptDue)
+    {
+        if (m_connectAttempts >= CONNECT_MAX_ATTEMPTS)
+        {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "[COOP][NET] no reply to %u handshakes over %ums, giving up",
+                     m_connectAttempts, now - m_connectStartTime);
+            coop_dll_log(msg);
+
+            SetState(ConnectionState::Failed);
+            return;
+        }
+
+        SendHandshake();
+
+        m_connectAttempts++;
+        m_nextConnectAttemptTime = now + ConnectBackoffMs(m_connectAttempts);
+    }
+
+    ResendReliablePackets(now);
+
+    if (state == ConnectionState::Connected)
+    {
+        bool idle = now - m_lastPacketSentTime > PING_INTERVAL_MS;
+        bool quiet = now - m_lastReceiveTime > LINK_PROBE_MS && now - m_lastPingTime > LINK_PROBE_MS;
+
+        if (idle || quiet)
+        {
+            SendPing();
+            m_lastPingTime = now;
+        }
+    }
+
+    // don't read any more datagrams until the game thread has caught up,
+    // otherwise we'd ack packets we then have nowhere to put
+    if (!FlushMessageOverflow())
+    {
+        return;
+    }
+
+    ExpireFragments(now);
+
+    // whatever earlier polls gathered and no puppet update picked up
+    if (now - m_lastAckFlushTime >= ACK_FLUSH_INTERVAL_MS)
+    {
+        FlushPendingAcks();
+        m_lastAckFlushTime = now;
+    }
+
+    struct sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    uint8_t buf[2048];
+
+    while (m_messageOverflow.empty())
+    {
+        int len = recvfrom(m_udpSocket, (char *)buf, sizeof(buf), 0, (struct sockaddr *)&from, &fromLen);
+
+        if (len <= 0)
+        {
+            break;
+        }
+
+        HandleDatagram(buf, len, from, now);
+    }
+}
+
+// decodes one datagram, unpacking bundles into their individual messages
+void NetworkClient::HandleDatagram(const uint8_t *data, int len, const struct sockaddr_in &from, uint32_t now)
+{
+    if (len < 1)
+    {
+        return;
+    }
+
+    m_lastReceiveTime = now;
+
+    PacketType type = static_cast<PacketType>(data[0]);
+
+    if (type == PacketType::Bundle)
+    {
+        int offset = BUNDLE_HEADER_SIZE;
+
+        while (offset + (int)BUNDLE_RECORD_HEADER_SIZE <= len)
+        {
+            int recordLen = data[offset] | (data[offset + 1] << 8);
+            offset += BUNDLE_RECORD_HEADER_SIZE;
+
+            if (recordLen == 0 || offset + recordLen > len)
+            {
+                break;
+            }
+
+            // bundles don't nest
+            if (static_cast<PacketType>(data[offset]) != PacketType::Bundle)
+            {
+                HandleMessage(&data[offset], recordLen, from);
+            }
+
+            offset += recordLen;
+        }
+        return;
+    }
+
+    HandleMessage(data, len, from);
+}
+
+void NetworkClient::HandleMessage(const uint8_t *data, int len, const struct sockaddr_in &from)
+{
+    const PacketDescriptor *desc = FindPacketDescriptor(static_cast<PacketType>(data[0]));
+    const uint8_t *payload = &data[1];
+    int payload_len = len - 1;
+
+    if (desc != nullptr && desc->reliable)
+    {
+        if (payload_len < 4)
+        {
+            return;
+        }
+
+        uint32_t seq;
+        std::memcpy(&seq, payload, 4);
+
+        bool isNew = AcceptReliableSequence(from, seq);
+
+        // always ack, but a retransmission we've already applied stops here
+        QueueReliableAck(from, seq);
+
+        if (!isNew)
+        {
+            m_reliableDuplicatesDropped++;
+
+            if (m_reliableDuplicatesDropped == 1 || m_reliableDuplicatesDropped % 100 == 0)
+            {
+                char msg[128];
+                snprintf(msg, sizeof(msg), "[COOP][NET] dropped duplicate reliable seq=%u (%u total)",
+                         seq, m_reliableDuplicatesDropped);
+                coop_dll_log(msg);
+            }
+            return;
+        }
+
+        payload += 4;
+        payload_len -= 4;
+    }
+
+    if (desc != nullptr)
+    {
+        DispatchPayload(desc->type, payload, payload_len);
+    }
+}
+
+// runs the handler for a payload that's already been through the reliable layer
+void NetworkClient::DispatchPayload(PacketType type, const uint8_t *payload, int len)
+{
+    const PacketDescriptor *desc = FindPacketDescriptor(type);
+
+    if (desc == nullptr || desc->handler == nullptr || len < desc->minPayload)
+    {
+        return;
+    }
+
+    (this->*desc->handler)(payload, len);
+}
+
+void NetworkClient::HandleFragment(const uint8_t *data, int len)
+{
+    uint16_t id = data[0] | (data[1] << 8);
+    uint16_t index = data[2] | (data[3] << 8);
+    uint16_t count = data[4] | (data[5] << 8);
+    const uint8_t *chunk = data + FRAGMENT_HEADER_SIZE;
+    size_t chunkLen = (size_t)len - FRAGMENT_HEADER_SIZE;
+
+    // every chunk but the last is exactly full size
+    bool isLast = (index + 1 == count);
+    if (count == 0 || index >= count || (size_t)count * FRAGMENT_CHUNK_SIZE > FRAGMENT_MAX_MESSAGE_SIZE ||
+        chunkLen > FRAGMENT_CHUNK_SIZE || (!isLast && chunkLen != FRAGMENT_CHUNK_SIZE))
+    {
+        return;
+    }
+
+    auto it = std::find_if(m_fragments.begin(), m_fragments.end(),
+                           [id](const FragmentAssembly &a) { return a.id == id; });
+
+    if (it != m_fragments.end() && it->count != count)
+    {
+        // stale id from an earlier message, start over
+        m_fragments.erase(it);
+        it = m_fragments.end();
+    }
+
+    if (it == m_fragments.end())
+    {
+        if (m_fragments.size() >= FRAGMENT_MAX_ASSEMBLIES)
+        {
+            m_fragments.erase(std::min_element(m_fragments.begin(), m_fragments.end(),
+                                               [](const FragmentAssembly &a, const FragmentAssembly &b)
+                                               { return (int32_t)(a.startTime - b.startTime) < 0; }));
+        }
+
+        FragmentAssembly assembly;
+        assembly.id = id;
+        assembly.count = count;
+        assembly.received = 0;
+        assembly.startTime = GetClockMS();
+        assembly.size = 0;
+        assembly.data.resize((size_t)count * FRAGMENT_CHUNK_SIZE);
+        assembly.have.assign(count, 0);
+        m_fragments.push_back(std::move(assembly));
+        it = m_fragments.end() - 1;
+    }
+
+    // the reliable layer already drops duplicates, this just guards the count
+    if (it->have[index])
+    {
+        return;
+    }
+
+    std::memcpy(&it->data[(size_t)index * FRAGMENT_CHUNK_SIZE], chunk, chunkLen);
+    it->have[index] = 1;
+    it->received++;
+
+    if (isLast)
+    {
+        it->size = (size_t)index * FRAGMENT_CHUNK_SIZE + chunkLen;
+    }
+
+    if (it->received < it->count)
+    {
+        return;
+    }
+
+    FragmentAssembly done = std::move(*it);
+    m_fragments.erase(it);
+
+    PacketType innerType = static_cast<PacketType>(done.data[0]);
+    if (done.size < 1 || innerType == PacketType::Fragment || innerType == PacketType::Bundle)
+    {
+        return;
+    }
+
+    DispatchPayload(innerType, &done.data[1], (int)done.size - 1);
+}
+
+// the server let us in. a fresh session needs a full sync,
+// a resumed one gets the missed StateEvents replayed instead
+void NetworkClient::HandleHandshakeAccepted(const uint8_t *data, int len)
+{
+    HandshakeAcceptedPacket accepted;
+    if (!DecodePacket(data, (size_t)len, accepted))
+    {
+        return;
+    }
+
+    uint32_t playerId = accepted.player_id;
+    uint64_t token = accepted.session_token;
+    uint32_t stateSeq = accepted.state_seq;
+    bool resumed = accepted.resumed;
+
+    uint16_t serverVersion = 0;
+    uint32_t capabilities = 0;
+    if (len >= (int)(HANDSHAKE_ACCEPTED_SIZE + HANDSHAKE_CAPABILITIES_SIZE))
+    {
+        serverVersion = LoadWire<WireOrder::Big, uint16_t>(data + HANDSHAKE_ACCEPTED_SIZE + 1);
+        capabilities = LoadWire<WireOrder::Big, uint32_t>(data + HANDSHAKE_ACCEPTED_SIZE + 3);
+    }
+    else if (len > (int)HANDSHAKE_ACCEPTED_SIZE)
+    {
+        capabilities = data[HANDSHAKE_ACCEPTED_SIZE];
+    }
+    m_capabilities.store(capabilities & CLIENT_CAPABILITIES, std::memory_order_relaxed);
+
+    // puppet baselines don't survive the server forgetting us
+    m_puppetAckedBaseline.store(-1, std::memory_order_relaxed);
+    m_puppetBaselines.clear();
+
+    char msg[128];
+
+    ConnectionState state = m_state.load(std::memory_order_relaxed);
+    if (state == ConnectionState::Handshaking || state == ConnectionState::Resuming)
+    {
+        uint32_t now = GetClockMS();
+        uint32_t latency = now - m_connectStartTime;
+
+        m_localPlayerId = (int)playerId;
+        m_lastPacketSentTime = now;
+        SetState(ConnectionState::Connected, latency);
+
+        snprintf(msg, sizeof(msg), "[COOP][NET] connected as player %u after %ums (%u handshakes, protocol %u, capabilities 0x%x)",
+                 playerId, latency, m_connectAttempts, serverVersion, capabilities & CLIENT_CAPABILITIES);
+        coop_dll_log(msg);
+    }
+
+    bool sameSession = m_hasSession && token == m_sessionToken;
+    bool askedToResume = m_resumeRequested;
+    m_resumeRequested = false;
+
+    if (resumed && sameSession)
+    {
+        snprintf(msg, sizeof(msg), "[COOP][NET] resumed session at state seq %u, skipping full sync", m_stateApplied);
+        coop_dll_log(msg);
+        return;
+    }
+
+    // the server answers every handshake we resent before it got through
+    if (sameSession && !askedToResume)
+    {
+        return;
+    }
+
+    if (!sameSession)
+    {
+        m_stateAhead.clear();
+    }
+
+    m_hasSession = true;
+    m_sessionToken = token;
+
+    // the lobby may not have our progress, so send the whole blobs again
+    m_progressResync.store(true, std::memory_order_relaxed);
+
+    // the full sync covers everything up to stateSeq
+    m_stateApplied = stateSeq;
+    m_stateAhead.erase(std::remove_if(m_stateAhead.begin(), m_stateAhead.end(),
+                                      [stateSeq](uint32_t s) { return s <= stateSeq; }),
+                       m_stateAhead.end());
+    FoldStateAhead();
+
+    snprintf(msg, sizeof(msg), "[COOP][NET] joined new session at state seq %u, requesting full sync", stateSeq);
+    coop_dll_log(msg);
+
+    RequestFullSync();
+}
+
+void NetworkClient::HandleStateEvent(const uint8_t *data, int len)
+{
+    uint32_t seq;
+    std::memcpy(&seq, data, 4);
+
+    PacketType innerType = static_cast<PacketType>(data[STATE_EVENT_HEADER_SIZE]);
+    if (innerType == PacketType::Fragment || innerType == PacketType::Bundle || innerType == PacketType::StateEvent)
+    {
+        return;
+    }
+
+    // a replay after resuming can repeat something we applied out of order
+    if (!AcceptStateSeq(seq))
+    {
+        return;
+    }
+
+    DispatchPayload(innerType, data + STATE_EVENT_HEADER_SIZE + 1, len - (int)STATE_EVENT_HEADER_SIZE - 1);
+}
+
+void NetworkClient::HandleCompressed(const uint8_t *data, int len)
+{
+    const uint8_t *cursor = data + 1;
+    const uint8_t *end = data + len;
+    uint32_t rawSize;
+
+    PacketType innerType = static_cast<PacketType>(data[0]);
+    if (innerType == PacketType::Compressed || innerType == PacketType::Fragment || innerType == PacketType::Bundle ||
+        innerType == PacketType::StateEvent)
+    {
+        return;
+    }
+
+    if (!ReadVarU32(cursor, end, rawSize) || rawSize > FRAGMENT_MAX_MESSAGE_SIZE)
+    {
+        return;
+    }
+
+    m_unpackScratch.resize(rawSize);
+    if (!UnpackBits(cursor, (size_t)(end - cursor), m_unpackScratch.data(), rawSize))
+    {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "[COOP][NET] dropping malformed compressed type=%d", (int)innerType);
+        coop_dll_log(msg);
+        return;
+    }
+
+    DispatchPayload(innerType, m_unpackScratch.data(), (int)rawSize);
+}
+
+// records seq as applied, false if it already was.
+// m_stateApplied only moves once everything below it has arrived
+bool NetworkClient::AcceptStateSeq(uint32_t seq)
+{
+    if (seq <= m_stateApplied || std::find(m_stateAhead.begin(), m_stateAhead.end(), seq) != m_stateAhead.end())
+    {
+        return false;
+    }
+
+    if (seq != m_stateApplied + 1 && m_stateAhead.size() >= STATE_AHEAD_MAX)
+    {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "[COOP][NET] state seq %u never arrived, requesting full sync", m_stateApplied + 1);
+        coop_dll_log(msg);
+
+        m_stateApplied = *std::max_element(m_stateAhead.begin(), m_stateAhead.end());
+        m_stateAhead.clear();
+        RequestFullSync();
+
+        if (seq <= m_stateApplied)
+        {
+            return false;
+        }
+    }
+
+    m_stateAhead.push_back(seq);
+    FoldStateAhead();
+    return true;
+}
+
+// moves m_stateApplied up past anything in m_stateAhead that's now contiguous with it
+void NetworkClient::FoldStateAhead()
+{
+    auto next = std::find(m_stateAhead.begin(), m_stateAhead.end(), m_stateApplied + 1);
+
+    while (next != m_stateAhead.end())
+    {
+        m_stateApplied++;
+        m_stateAhead.erase(next);
+        next = std::find(m_stateAhead.begin(), m_stateAhead.end(), m_stateApplied + 1);
+    }
+}
+
+void NetworkClient::ResetSession()
+{
+    m_hasSession = false;
+    m_resumeRequested = false;
+    m_sessionToken = 0;
+    m_stateApplied = 0;
+    m_stateAhead.clear();
+
+    std::lock_guard<std::mutex> lock(m_lobbyDigestMutex);
+    m_lobbyDigest.Clear();
+}
+
+void NetworkClient::ExpireFragments(uint32_t now)
+{
+    for (auto it = m_fragments.begin(); it != m_fragments.end();)
+    {
+        if (now - it->startTime > FRAGMENT_TIMEOUT_MS)
+        {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "[COOP][NET] fragmented message id=%u timed out with %u/%u parts",
+                     it->id, it->received, it->count);
+            coop_dll_log(msg);
+
+            it = m_fragments.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+// Starts the game message for a packet, for the handler to fill in and pass
+// on with FinishMessage. data (text or a blob) goes in after the header, NUL
+// terminated and cut to MAX_MESSAGE_PAYLOAD_SIZE. It's a record reserved in
+// the message queue at just that size when there's room, so nothing else is
+// copied or allocated; otherwise it goes on the overflow
+GameMessageHeader &NetworkClient::BeginMessage(PacketType type, int playerId, const void *data, size_t size)
+{
+    size_t copySize = std::min(size, MAX_MESSAGE_PAYLOAD_SIZE - 1);
+    size_t dataSize = size > 0 ? copySize + 1 : 0;
+
+    GameMessageHeader *msg = nullptr;
+    uint8_t *payload = nullptr;
+
+    // keep ordering: once anything has spilled, everything spills until it drains
+    if (m_messageOverflow.empty())
+    {
+        msg = m_messages.Reserve(dataSize, m_messageTicket);
+        payload = msg != nullptr ? MessageData(msg) : nullptr;
+    }
+
+    m_messageReserved = msg != nullptr;
+    if (msg == nullptr)
+    {
+        SpilledMessage &spilled = m_messageOverflow.emplace_back();
+        spilled.data.resize(dataSize);
+        msg = &spilled.header;
+        payload = spilled.data.data();
+    }
+
+    msg->type = static_cast<uint8_t>(PacketTypeToMessageType(type));
+    msg->playerId = playerId;
+    if (dataSize > 0)
+    {
+        memcpy(payload, data, copySize);
+        payload[copySize] = '\0';
+        msg->dataSize = (uint16_t)dataSize;
+    }
+    return *msg;
+}
+
+void NetworkClient::FinishMessage()
+{
+    if (m_messageReserved)
+    {
+        m_messages.Commit(m_messageTicket);
+        m_messageReserved = false;
+    }
+}
+
+bool NetworkClient::FlushMessageOverflow()
+{
+    while (!m_messageOverflow.empty())
+    {
+        SpilledMessage &spilled = m_messageOverflow.front();
+
+        size_t ticket;
+        GameMessageHeader *msg = m_messages.Reserve(spilled.data.size(), ticket);
+        if (msg == nullptr)
+        {
+            return false;
+        }
+
+        *msg = spilled.header;
+        memcpy(MessageData(msg), spilled.data.data(), spilled.data.size());
+        m_messages.Commit(ticket);
+        m_messageOverflow.pop_front();
+    }
+
+    return true;
+}
+
+void NetworkClient::HandlePlayerConnected(const uint8_t *data, int len)
+{
+    PlayerConnectedBroadcast pak;
+    if (!DecodePacket(data, (size_t)len, pak))
+        return;
+
+    BeginMessage(PacketType::PlayerConnected, pak.player_id, pak.username.data(), pak.username.size());
+    FinishMessage();
+}
+
+void NetworkClient::HandlePlayerDisconnected(const uint8_t *data, int len)
+{
+    PlayerDisconnectedBroadcast pak;
+    if (!DecodePacket(data, (size_t)len, pak))
+        return;
+
+    m_puppetBaselines.erase(pak.player_id);
+
+    BeginMessage(PacketType::PlayerDisconnected, pak.player_id, pak.username.data(), pak.username.size());
+    FinishMessage();
+}
+
+void NetworkClient::HandleJiggyCollected(const uint8_t *data, int len)
+{
+    if (!BroadcastJiggyView::Fits((size_t)len))
+        return;
+
+    BroadcastJiggyView pak(data);
+    GameMessageHeader &msg = BeginMessage(PacketType::JiggyCollected, pak.player_id());
+    msg.param1 = pak.jiggy_enum_id();
+    msg.param2 = pak.collected_value();
+    FinishMessage();
+}
+
+void NetworkClient::HandleNoteCollected(const uint8_t *data, int len)
+{
+    if (!BroadcastNoteView::Fits((size_t)len))
+        return;
+
+    BroadcastNoteView pak(data);
+    printf("[CLIENT] Received NoteCollected broadcast: map=%d, level=%d, is_dynamic=%d, note_index=%d\n",
+           pak.map_id(), pak.level_id(), pak.is_dynamic(), pak.note_index());
+
+    GameMessageHeader &msg = BeginMessage(PacketType::NoteCollected, pak.player_id());
+    msg.param1 = pak.map_id();
+    msg.param2 = pak.level_id();
+    msg.param3 = pak.is_dynamic();
+    msg.param4 = pak.note_index();
+    FinishMessage();
+}
+
+void NetworkClient::HandleNoteCollectedCompact(const uint8_t *data, int len)
+{
+    BroadcastNoteCompact pak;
+    if (!DecodePacket(data, (size_t)len, pak))
+        return;
+
+    GameMessageHeader &msg = BeginMessage(PacketType::NoteCollected, pak.player_id);
+    msg.param1 = pak.map_id;
+    msg.param2 = pak.level_id;
+    msg.param3 = pak.is_dynamic;
+    msg.param4 = pak.note_index;
+    FinishMessage();
+}
+
+void NetworkClient::HandleNoteCollectedPos(const uint8_t *data, int len)
+{
+    if (!BroadcastNotePosView::Fits((size_t)len))
+        return;
+
+    BroadcastNotePosView pak(data);
+    GameMessageHeader &msg = BeginMessage(PacketType::NoteCollectedPos, pak.player_id());
+    msg.param1 = pak.map_id();
+    msg.param2 = pak.x();
+    msg.param3 = pak.y();
+    msg.param4 = pak.z();
+    FinishMessage();
+}
+
+// a level's note save data from a full sync, as [i32 BE level slot][bytes].
+// the level slot goes in param1 and the byte count in param2
+void NetworkClient::HandleNoteSaveData(const uint8_t *data, int len)
+{
+    if (len < 4)
+        return;
+
+    int32_t levelIndex = (int32_t)LoadWire<WireOrder::Big, uint32_t>(data);
+    size_t size = (size_t)(len - 4);
+
+    GameMessageHeader &msg = BeginMessage(PacketType::NoteSaveData, 0, data + 4, size);
+    msg.param1 = levelIndex;
+    msg.param2 = (int32_t)size;
+    FinishMessage();
+}
+
+// puppet positions are quantized to whole world units; the level geometry
+// is s16, so anywhere a player can stand fits
+static int16_t QuantizePosition(float value)
+{
+    return (int16_t)std::clamp(std::lround(value), -32768L, 32767L);
+}
+
+// degrees to a u16 fraction of a turn, any sign or number of turns
+static uint16_t QuantizeAngle(float degrees)
+{
+    float turns = degrees / 360.0f;
+    turns -= std::floor(turns);
+    return (uint16_t)((uint32_t)std::lround(turns * 65536.0f) & 0xFFFF);
+}
+
+static float DequantizeAngle(uint16_t value)
+{
+    return value * (360.0f / 65536.0f);
+}
+
+// field spans within the puppet image, in delta mask bit order
+struct PuppetDeltaField
+{
+    uint8_t offset;
+    uint8_t size;
+};
+
+static constexpr PuppetDeltaField PUPPET_DELTA_FIELDS[] = {
+    {0, 2}, {2, 2}, {4, 2},         // x, y, z
+    {6, 2},                         // yaw
+    {8, 2}, {10, 2},                // anim duration, anim timer
+    {12, 1}, {13, 1},               // level, map
+    {14, 2},                        // anim
+    {16, 1}, {17, 1},               // model, flags
+    {18, 1}, {19, 1},               // playback type, direction
+    {20, PUPPET_COMPACT_TILT_SIZE}, // pitch + roll
+};
+
+static constexpr bool PuppetDeltaFieldsCoverImage()
+{
+    size_t offset = 0;
+    for (const PuppetDeltaField &field : PUPPET_DELTA_FIELDS)
+    {
+        if (field.offset != offset)
         {
-            break;
+            return false;
         }
+        offset += field.size;
     }
+    return offset == PUPPET_IMAGE_SIZE && std::size(PUPPET_DELTA_FIELDS) <= PUPPET_DELTA_MASK_SIZE * 8;
 }
 
-void NetworkClient::EnqueueEvent(PacketType type, const std::string &text, const std::vector<int32_t> &data, int playerId)
-{
-    std::lock_guard<std::mutex> lock(m_queueMutex);
+static_assert(PuppetDeltaFieldsCoverImage(), "delta fields must tile the puppet image in order");
 
-    NetEvent e;
-    e.type = type;
-    e.textData = text;
-    e.intData = data;
-    e.playerId = playerId;
-    m_eventQueue.push(e);
-}
+// keyframe before this many updates go by without one
+const uint32_t PUPPET_KEYFRAME_INTERVAL = 10;
 
-bool NetworkClient::HasEvents()
+static PuppetUpdateCompactPacket CompactPuppetUpdate(const PuppetUpdatePacket &pak)
 {
-    std::lock_guard<std::mutex> lock(m_queueMutex);
-    return !m_eventQueue.empty();
+    PuppetUpdateCompactPacket compact;
+    compact.x = QuantizePosition(pak.x);
+    compact.y = QuantizePosition(pak.y);
+    compact.z = QuantizePosition(pak.z);
+    compact.yaw = QuantizeAngle(pak.yaw);
+    compact.anim_duration_ms = (uint16_t)std::clamp(std::lround(pak.anim_duration * 1000.0f), 0L, 65535L);
+    compact.anim_timer = (uint16_t)std::clamp(std::lround(pak.anim_timer * 65535.0f), 0L, 65535L);
+    compact.level_id = (uint8_t)pak.level_id;
+    compact.map_id = (uint8_t)pak.map_id;
+    compact.anim_id = (uint16_t)pak.anim_id;
+    compact.model_id = pak.model_id;
+    compact.flags = pak.flags;
+    compact.playback_type = pak.playback_type;
+    compact.playback_direction = pak.playback_direction;
+    return compact;
 }
 
-NetEvent NetworkClient::PopEvent()
+// the quantized state as fixed-size bytes: the compact packet, then pitch and roll
+static void BuildPuppetImage(const PuppetUpdatePacket &pak, uint8_t *image)
 {
-    std::lock_guard<std::mutex> lock(m_queueMutex);
-    if (m_eventQueue.empty())
-        return {};
-    NetEvent e = m_eventQueue.front();
-    m_eventQueue.pop();
-    return e;
+    PacketWriter writer(image, PUPPET_IMAGE_SIZE);
+    EncodePacket(writer, CompactPuppetUpdate(pak));
+    writer.WriteU16BE(QuantizeAngle(pak.pitch));
+    writer.WriteU16BE(QuantizeAngle(pak.roll));
 }
 
-void NetworkClient::HandlePlayerConnected(const uint8_t *data, int len)
+static PuppetUpdatePacket ExpandPuppetImage(const uint8_t *image)
 {
-    if (len < 8)
-        return;
-
-    uint32_t player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                         ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
+    PuppetUpdateCompactPacket compact;
+    DecodePacket(image, PUPPET_COMPACT_SIZE, compact);
+
+    PuppetUpdatePacket pak;
+    pak.x = compact.x;
+    pak.y = compact.y;
+    pak.z = compact.z;
+    pak.yaw = DequantizeAngle(compact.yaw);
+    pak.pitch = DequantizeAngle(LoadWire<WireOrder::Big, uint16_t>(image + PUPPET_COMPACT_SIZE));
+    pak.roll = DequantizeAngle(LoadWire<WireOrder::Big, uint16_t>(image + PUPPET_COMPACT_SIZE + 2));
+    pak.anim_duration = compact.anim_duration_ms / 1000.0f;
+    pak.anim_timer = compact.anim_timer / 65535.0f;
+    pak.level_id = compact.level_id;
+    pak.map_id = compact.map_id;
+    pak.anim_id = (int16_t)compact.anim_id;
+    pak.model_id = compact.model_id;
+    pak.flags = compact.flags;
+    pak.playback_type = compact.playback_type;
+    pak.playback_direction = compact.playback_direction;
+    return pak;
+}
 
-    uint32_t username_len = ((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) |
-                            ((uint32_t)data[6] << 8) | ((uint32_t)data[7]);
+void NetworkClient::HandlePuppetUpdate(const uint8_t *data, int len)
+{
+    // the server prefixes the sender's id, little-endian unlike the rest
+    uint32_t player_id = LoadWire<WireOrder::Little, uint32_t>(data);
 
-    if (len < (int)(8 + username_len))
+    PuppetUpdatePacket pak;
+    if (!DecodePacket(data + 4, (size_t)len - 4, pak))
         return;
 
-    std::string username((const char *)(data + 8), username_len);
-
-    EnqueueEvent(PacketType::PlayerConnected, username, {}, player_id);
+    PushPuppetMessage(player_id, pak);
 }
 
-void NetworkClient::HandlePlayerDisconnected(const uint8_t *data, int len)
+// keyframes are stored as this puppet's baselines, deltas are laid over the
+// baseline they name. a delta against a keyframe we never got is dropped;
+// the next keyframe puts the puppet right
+void NetworkClient::HandlePuppetUpdateCompact(const uint8_t *data, int len)
 {
-    if (len < 8)
-        return;
+    uint32_t player_id = LoadWire<WireOrder::Little, uint32_t>(data);
+    uint8_t shape = data[4];
+    uint8_t baselineId = data[5];
+    data += 4 + PUPPET_COMPACT_HEADER_SIZE;
+    size_t size = (size_t)len - 4 - PUPPET_COMPACT_HEADER_SIZE;
 
-    uint32_t player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                         ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
+    PuppetBaseline &slot = m_puppetBaselines[player_id][baselineId % PUPPET_BASELINE_SLOTS];
+    uint8_t image[PUPPET_IMAGE_SIZE];
 
-    uint32_t username_len = ((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) |
-                            ((uint32_t)data[6] << 8) | ((uint32_t)data[7]);
+    if (shape & PUPPET_SHAPE_DELTA)
+    {
+        if (!slot.valid || slot.id != baselineId)
+            return;
 
-    if (len < (int)(8 + username_len))
-        return;
+        std::memcpy(image, slot.image.data(), PUPPET_IMAGE_SIZE);
 
-    std::string username((const char *)(data + 8), username_len);
+        uint16_t mask = LoadWire<WireOrder::Big, uint16_t>(data);
+        size_t offset = PUPPET_DELTA_MASK_SIZE;
 
-    EnqueueEvent(PacketType::PlayerDisconnected, username, {}, player_id);
-}
+        for (size_t i = 0; i < std::size(PUPPET_DELTA_FIELDS); i++)
+        {
+            if (!(mask & (1u << i)))
+                continue;
 
-void NetworkClient::HandleJiggyCollected(const uint8_t *data, int len)
-{
-    if (len < 12)
-        return;
+            const PuppetDeltaField &field = PUPPET_DELTA_FIELDS[i];
+            if (size - offset < field.size)
+                return;
 
-    uint32_t player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                         ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
+            std::memcpy(image + field.offset, data + offset, field.size);
+            offset += field.size;
+        }
+    }
+    else
+    {
+        size_t keyframeSize = PUPPET_COMPACT_SIZE + ((shape & PUPPET_SHAPE_TILT) ? PUPPET_COMPACT_TILT_SIZE : 0);
+        if (size < keyframeSize)
+            return;
 
-    int32_t jiggy_enum_id = ((int32_t)data[4] << 24) | ((int32_t)data[5] << 16) |
-                            ((int32_t)data[6] << 8) | ((int32_t)data[7]);
+        std::memset(image, 0, PUPPET_IMAGE_SIZE);
+        std::memcpy(image, data, keyframeSize);
 
-    int32_t collected_value = ((int32_t)data[8] << 24) | ((int32_t)data[9] << 16) |
-                              ((int32_t)data[10] << 8) | ((int32_t)data[11]);
+        slot.valid = true;
+        slot.id = baselineId;
+        std::memcpy(slot.image.data(), image, PUPPET_IMAGE_SIZE);
+    }
 
-    EnqueueEvent(PacketType::JiggyCollected, "", {jiggy_enum_id, collected_value}, player_id);
+    PushPuppetMessage(player_id, ExpandPuppetImage(image));
 }
 
-void NetworkClient::HandleNoteCollected(const uint8_t *data, int len)
+void NetworkClient::HandlePuppetBaselineAck(const uint8_t *data, int /*len*/)
 {
-    if (len < 20)
-        return;
-
-    uint32_t player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                         ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
+    m_puppetAckedBaseline.store(data[0], std::memory_order_relaxed);
+}
 
-    int32_t map_id = ((int32_t)data[4] << 24) | ((int32_t)data[5] << 16) |
-                     ((int32_t)data[6] << 8) | ((int32_t)data[7]);
+void NetworkClient::PushPuppetMessage(uint32_t player_id, const PuppetUpdatePacket &pak)
+{
+    GameMessageHeader &msg = BeginMessage(PacketType::PuppetUpdate, (int)player_id);
 
-    int32_t level_id = ((int32_t)data[8] << 24) | ((int32_t)data[9] << 16) |
-                       ((int32_t)data[10] << 8) | ((int32_t)data[11]);
+    msg.param1 = std::bit_cast<int32_t>(pak.yaw);
+    msg.param2 = std::bit_cast<int32_t>(pak.pitch);
+    msg.param3 = std::bit_cast<int32_t>(pak.roll);
 
-    int32_t is_dynamic = ((int32_t)data[12] << 24) | ((int32_t)data[13] << 16) |
-                         ((int32_t)data[14] << 8) | ((int32_t)data[15]);
+    uint32_t packed = ((uint32_t)(uint16_t)pak.anim_id << 16) |
+                      ((uint32_t)(uint8_t)pak.level_id << 8) |
+                      ((uint32_t)(uint8_t)pak.map_id);
+    msg.param4 = (int32_t)packed;
 
-    int32_t note_index = ((int32_t)data[16] << 24) | ((int32_t)data[17] << 16) |
-                         ((int32_t)data[18] << 8) | ((int32_t)data[19]);
+    msg.param5 = (int32_t)pak.playback_type;
+    msg.param6 = (int32_t)pak.playback_direction;
 
-    printf("[CLIENT] Received NoteCollected broadcast: map=%d, level=%d, is_dynamic=%d, note_index=%d\n",
-           map_id, level_id, is_dynamic, note_index);
+    msg.paramF1 = pak.x;
+    msg.paramF2 = pak.y;
+    msg.paramF3 = pak.z;
+    msg.paramF4 = pak.anim_duration;
+    msg.paramF5 = pak.anim_timer;
 
-    EnqueueEvent(PacketType::NoteCollected, "", {map_id, level_id, is_dynamic, note_index}, player_id);
+    FinishMessage();
 }
 
-void NetworkClient::HandleNoteCollectedPos(const uint8_t *data, int len)
+void NetworkClient::HandleLevelOpened(const uint8_t *data, int len)
 {
-    if (len < 20)
+    if (!BroadcastLevelOpenedView::Fits((size_t)len))
         return;
 
-    uint32_t player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                         ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
-
-    int32_t map_id = ((int32_t)data[4] << 24) | ((int32_t)data[5] << 16) |
-                     ((int32_t)data[6] << 8) | ((int32_t)data[7]);
-
-    int32_t x = ((int32_t)data[8] << 24) | ((int32_t)data[9] << 16) |
-                ((int32_t)data[10] << 8) | ((int32_t)data[11]);
+    BroadcastLevelOpenedView pak(data);
+    GameMessageHeader &msg = BeginMessage(PacketType::LevelOpened, pak.player_id());
+    msg.param1 = pak.world_id();
+    msg.param2 = pak.jiggy_cost();
+    FinishMessage();
+}
 
-    int32_t y = ((int32_t)data[12] << 24) | ((int32_t)data[13] << 16) |
-                ((int32_t)data[14] << 8) | ((int32_t)data[15]);
+// a progress blob for the game, its byte count in param1
+void NetworkClient::PushProgressBlobMessage(PacketType type, uint32_t playerId, const uint8_t *bytes, size_t size)
+{
+    GameMessageHeader &msg = BeginMessage(type, (int)playerId, bytes, size);
+    msg.param1 = (int32_t)size;
+    FinishMessage();
+}
 
-    int32_t z = ((int32_t)data[16] << 24) | ((int32_t)data[17] << 16) |
-                ((int32_t)data[18] << 8) | ((int32_t)data[19]);
+void NetworkClient::HandleFileProgressFlags(const uint8_t *data, int len)
+{
+    uint32_t player_id = LoadWire<WireOrder::Big, uint32_t>(data);
 
-    EnqueueEvent(PacketType::NoteCollectedPos, "", {map_id, x, y, z}, player_id);
+    PushProgressBlobMessage(PacketType::FileProgressFlags, player_id, data + 4, (size_t)(len - 4));
 }
 
-void NetworkClient::HandleNoteSaveData(const uint8_t *data, int len)
+void NetworkClient::HandleAbilityProgress(const uint8_t *data, int len)
 {
+    uint32_t player_id = LoadWire<WireOrder::Big, uint32_t>(data);
+
+    PushProgressBlobMessage(PacketType::AbilityProgress, player_id, data + 4, (size_t)(len - 4));
 }
 
-void NetworkClient::HandlePuppetUpdate(const uint8_t *data, int len)
+// Expands a ProgressBits broadcast into an event for the blob it names, with
+// only the listed bits set, so the game sets just those.
+void NetworkClient::HandleProgressBits(const uint8_t *data, int len)
 {
-    const int EXPECTED_LEN = 32 + 2 + 2 + 2 + 4; // 42 bytes
+    uint32_t player_id = LoadWire<WireOrder::Big, uint32_t>(data);
 
-    if (len < EXPECTED_LEN)
+    uint8_t blobType = data[4];
+    if (blobType < static_cast<uint8_t>(PacketType::FileProgressFlags) ||
+        blobType > static_cast<uint8_t>(PacketType::MumboScore))
     {
         return;
     }
 
-    uint32_t player_id;
-    std::memcpy(&player_id, data, 4);
-    data += 4;
+    uint8_t blob[PROGRESS_BLOB_MAX_SIZE] = {};
+    size_t byteCount = 0;
 
-    float x, y, z, yaw, pitch, roll, anim_duration, anim_timer;
+    const uint8_t *cursor = data + 4 + PROGRESS_BITS_HEADER_SIZE;
+    const uint8_t *end = data + len;
+    uint64_t next = 0;
 
-    auto read_float = [&data]() -> float
+    while (cursor < end)
     {
-        uint32_t bits = ((uint32_t)data[0] << 24) |
-                        ((uint32_t)data[1] << 16) |
-                        ((uint32_t)data[2] << 8) |
-                        ((uint32_t)data[3]);
-        data += 4;
-        float result;
-        std::memcpy(&result, &bits, sizeof(float));
-        return result;
-    };
-
-    x = read_float();
-    y = read_float();
-    z = read_float();
-    yaw = read_float();
-    pitch = read_float();
-    roll = read_float();
-    anim_duration = read_float();
-    anim_timer = read_float();
-
-    int16_t level_id = (int16_t)(((uint16_t)data[0] << 8) | (uint16_t)data[1]);
-    data += 2;
-    int16_t map_id = (int16_t)(((uint16_t)data[0] << 8) | (uint16_t)data[1]);
-    data += 2;
-    int16_t anim_id = (int16_t)(((uint16_t)data[0] << 8) | (uint16_t)data[1]);
-    data += 2;
-
-    uint8_t model_id = data[0];
-    uint8_t flags = data[1];
-    uint8_t playback_type = data[2];
-    uint8_t playback_direction = data[3];
-
-    std::vector<int32_t> payload;
+        uint32_t gap;
+        if (!ReadVarU32(cursor, end, gap))
+        {
+            return;
+        }
 
-    int32_t yaw_bits, pitch_bits, roll_bits;
-    std::memcpy(&yaw_bits, &yaw, sizeof(float));
-    std::memcpy(&pitch_bits, &pitch, sizeof(float));
-    std::memcpy(&roll_bits, &roll, sizeof(float));
+        uint64_t index = next + gap;
+        if (index >= PROGRESS_BLOB_MAX_SIZE * 8)
+        {
+            return;
+        }
 
-    payload.push_back(yaw_bits);
-    payload.push_back(pitch_bits);
-    payload.push_back(roll_bits);
+        blob[index / 8] |= (uint8_t)(1 << (index % 8));
+        byteCount = (size_t)(index / 8) + 1;
+        next = index + 1;
+    }
 
-    uint32_t packed = ((uint32_t)(uint16_t)anim_id << 16) |
-                      ((uint32_t)(uint8_t)level_id << 8) |
-                      ((uint32_t)(uint8_t)map_id);
-    payload.push_back((int32_t)packed);
+    PushProgressBlobMessage(static_cast<PacketType>(blobType), player_id, blob, byteCount);
+}
 
-    payload.push_back((int32_t)playback_type);
-    payload.push_back((int32_t)playback_direction);
+void NetworkClient::HandleHoneycombScore(const uint8_t *data, int len)
+{
+    uint32_t player_id = LoadWire<WireOrder::Big, uint32_t>(data);
 
-    NetEvent e;
-    e.type = PacketType::PuppetUpdate;
-    e.playerId = (int)player_id;
-    e.intData = payload;
+    PushProgressBlobMessage(PacketType::HoneycombScore, player_id, data + 4, (size_t)(len - 4));
+}
 
-    e.floatData.push_back(x);
-    e.floatData.push_back(y);
-    e.floatData.push_back(z);
-    e.floatData.push_back(anim_duration);
-    e.floatData.push_back(anim_timer);
+void NetworkClient::HandleMumboScore(const uint8_t *data, int len)
+{
+    uint32_t player_id = LoadWire<WireOrder::Big, uint32_t>(data);
 
-    {
-        std::lock_guard<std::mutex> lock(m_queueMutex);
-        m_eventQueue.push(e);
-    }
+    PushProgressBlobMessage(PacketType::MumboScore, player_id, data + 4, (size_t)(len - 4));
 }
 
-void NetworkClient::HandleLevelOpened(const uint8_t *data, int len)
+void NetworkClient::HandleHoneycombCollected(const uint8_t *data, int len)
 {
-    if (len < 12)
+    if (!BroadcastHoneycombView::Fits((size_t)len))
         return;
 
-    uint32_t player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                         ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
-
-    int32_t world_id = ((int32_t)data[4] << 24) | ((int32_t)data[5] << 16) |
-                       ((int32_t)data[6] << 8) | ((int32_t)data[7]);
-
-    int32_t jiggy_cost = ((int32_t)data[8] << 24) | ((int32_t)data[9] << 16) |
-                         ((int32_t)data[10] << 8) | ((int32_t)data[11]);
-
-    EnqueueEvent(PacketType::LevelOpened, "", {world_id, jiggy_cost}, player_id);
+    BroadcastHoneycombView pak(data);
+    GameMessageHeader &msg = BeginMessage(PacketType::HoneycombCollected, pak.player_id());
+    msg.param1 = pak.map_id();
+    msg.param2 = pak.honeycomb_id();
+    msg.param3 = pak.x();
+    msg.param4 = pak.y();
+    msg.param5 = pak.z();
+    FinishMessage();
 }
 
-void NetworkClient::HandleFileProgressFlags(const uint8_t *data, int len)
+void NetworkClient::HandleMumboTokenCollected(const uint8_t *data, int len)
 {
-    if (len < 4)
+    if (!BroadcastMumboTokenView::Fits((size_t)len))
         return;
 
-    uint32_t player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                         ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
-
-    int byte_count = len - 4;
-    std::string flags_data((const char *)(data + 4), byte_count);
+    BroadcastMumboTokenView pak(data);
+    GameMessageHeader &msg = BeginMessage(PacketType::MumboTokenCollected, pak.player_id());
+    msg.param1 = pak.map_id();
+    msg.param2 = pak.token_id();
+    msg.param3 = pak.x();
+    msg.param4 = pak.y();
+    msg.param5 = pak.z();
+    FinishMessage();
+}
 
-    NetEvent e;
-    e.type = PacketType::FileProgressFlags;
-    e.playerId = (int)player_id;
-    e.intData.push_back(byte_count);
-    e.textData = flags_data;
+void NetworkClient::HandleHoneycombCollectedCompact(const uint8_t *data, int len)
+{
+    BroadcastHoneycombCompact pak;
+    if (!DecodePacket(data, (size_t)len, pak))
+        return;
 
-    std::lock_guard<std::mutex> lock(m_queueMutex);
-    m_eventQueue.push(e);
+    GameMessageHeader &msg = BeginMessage(PacketType::HoneycombCollected, pak.player_id);
+    msg.param1 = pak.map_id;
+    msg.param2 = pak.honeycomb_id;
+    msg.param3 = pak.x;
+    msg.param4 = pak.y;
+    msg.param5 = pak.z;
+    FinishMessage();
 }
 
-void NetworkClient::HandleAbilityProgress(const uint8_t *data, int len)
+void NetworkClient::HandleMumboTokenCollectedCompact(const uint8_t *data, int len)
 {
-    if (len < 4)
+    BroadcastMumboTokenCompact pak;
+    if (!DecodePacket(data, (size_t)len, pak))
         return;
 
-    uint32_t player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                         ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
+    GameMessageHeader &msg = BeginMessage(PacketType::MumboTokenCollected, pak.player_id);
+    msg.param1 = pak.map_id;
+    msg.param2 = pak.token_id;
+    msg.param3 = pak.x;
+    msg.param4 = pak.y;
+    msg.param5 = pak.z;
+    FinishMessage();
+}
 
-    int byte_count = len - 4;
-    std::string ability_data((const char *)(data + 4), byte_count);
+template <typename T>
+void NetworkClient::SendEncoded(PacketType type, const T &packet, bool reliable)
+{
+    static_assert(PacketLayout<T>::BOUNDED, "strings need a bigger buffer than MAX_SIZE");
 
-    NetEvent e;
-    e.type = PacketType::AbilityProgress;
-    e.playerId = (int)player_id;
-    e.intData.push_back(byte_count);
-    e.textData = ability_data;
+    uint8_t buffer[PacketLayout<T>::MAX_SIZE];
+    PacketWriter writer(buffer, sizeof(buffer));
+    EncodePacket(writer, packet);
 
-    std::lock_guard<std::mutex> lock(m_queueMutex);
-    m_eventQueue.push(e);
+    if (reliable)
+    {
+        SendReliablePacket(type, writer.Data(), writer.Size());
+    }
+    else
+    {
+        SendRawPacket(type, writer.Data(), writer.Size());
+    }
 }
 
-void NetworkClient::HandleHoneycombScore(const uint8_t *data, int len)
+void NetworkClient::SendJiggy(int jiggyEnumId, int collectedValue)
 {
-    if (len < 4)
-        return;
-
-    uint32_t player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                         ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
-
-    int byte_count = len - 4;
-    std::string score_data((const char *)(data + 4), byte_count);
+    SendEncoded(PacketType::JiggyCollected, JiggyPacket{jiggyEnumId, collectedValue}, true);
+}
 
-    NetEvent e;
-    e.type = PacketType::HoneycombScore;
-    e.playerId = (int)player_id;
-    e.intData.push_back(byte_count);
-    e.textData = score_data;
+void NetworkClient::SendNote(int mapId, int levelId, bool isDynamic, int noteIndex)
+{
+    printf("[CLIENT] SendNote: map=%d, level=%d, is_dynamic=%d, note_index=%d\n",
+           mapId, levelId, isDynamic, noteIndex);
 
-    std::lock_guard<std::mutex> lock(m_queueMutex);
-    m_eventQueue.push(e);
+    if (m_capabilities.load(std::memory_order_relaxed) & CAPABILITY_COMPACT_COLLECTIBLES)
+    {
+        SendEncoded(PacketType::NoteCollectedCompact, NotePacketCompact{{mapId, levelId, isDynamic, noteIndex}}, true);
+    }
+    else
+    {
+        SendEncoded(PacketType::NoteCollected, NotePacket{mapId, levelId, isDynamic, noteIndex}, true);
+    }
 }
 
-void NetworkClient::HandleMumboScore(const uint8_t *data, int len)
+void NetworkClient::SendNotePos(int mapId, int x, int y, int z)
 {
-    if (len < 4)
-        return;
-
-    uint32_t player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                         ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
+    SendEncoded(PacketType::NoteCollectedPos, NotePacketPos{mapId, (int16_t)x, (int16_t)y, (int16_t)z}, true);
+}
 
-    int byte_count = len - 4;
-    std::string score_data((const char *)(data + 4), byte_count);
+void NetworkClient::SendNoteSaveData(int levelIndex, const std::vector<uint8_t> &saveData)
+{
+    uint8_t buffer[NET_MAX_DATAGRAM_SIZE];
+    PacketWriter writer(buffer, sizeof(buffer));
+    writer.WriteI32LE(levelIndex);
+    writer.WriteBytes(saveData.data(), saveData.size());
 
-    NetEvent e;
-    e.type = PacketType::MumboScore;
-    e.playerId = (int)player_id;
-    e.intData.push_back(byte_count);
-    e.textData = score_data;
+    if (writer.Ok())
+    {
+        SendBulkPacket(PacketType::NoteSaveData, writer.Data(), writer.Size());
+    }
+}
 
-    std::lock_guard<std::mutex> lock(m_queueMutex);
-    m_eventQueue.push(e);
+void NetworkClient::SendLevelOpened(int worldId, int jiggyCost)
+{
+    SendEncoded(PacketType::LevelOpened, LevelOpenedPacket{worldId, jiggyCost}, true);
 }
 
-void NetworkClient::HandleHoneycombCollected(const uint8_t *data, int len)
+void NetworkClient::SendPuppetUpdate(const PuppetUpdatePacket &pak)
 {
-    if (len < 24)
-        return;
+    std::lock_guard<std::mutex> lock(m_sendMutex);
 
-    uint32_t player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                         ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
+    if (m_udpSocket == INVALID_SOCKET)
+    {
+        return;
+    }
 
-    int32_t map_id = ((int32_t)data[4] << 24) | ((int32_t)data[5] << 16) |
-                     ((int32_t)data[6] << 8) | ((int32_t)data[7]);
+    const bool compact = m_capabilities.load(std::memory_order_relaxed) & CAPABILITY_COMPACT_PUPPETS;
 
-    int32_t honeycomb_id = ((int32_t)data[8] << 24) | ((int32_t)data[9] << 16) |
-                           ((int32_t)data[10] << 8) | ((int32_t)data[11]);
+    // carry the pending acks on this datagram rather than a separate one
+    const bool piggybackAcks = m_ackPending;
+    PacketType type;
+    if (compact)
+    {
+        type = piggybackAcks ? PacketType::PuppetUpdateCompactAck : PacketType::PuppetUpdateCompact;
+    }
+    else
+    {
+        type = piggybackAcks ? PacketType::PuppetUpdateAck : PacketType::PuppetUpdate;
+    }
 
-    int32_t x = ((int32_t)data[12] << 24) | ((int32_t)data[13] << 16) |
-                ((int32_t)data[14] << 8) | ((int32_t)data[15]);
+    PacketWriter writer = BeginPacketLocked(type);
 
-    int32_t y = ((int32_t)data[16] << 24) | ((int32_t)data[17] << 16) |
-                ((int32_t)data[18] << 8) | ((int32_t)data[19]);
+    if (piggybackAcks)
+    {
+        WriteAckBlockLocked(writer);
+    }
 
-    int32_t z = ((int32_t)data[20] << 24) | ((int32_t)data[21] << 16) |
-                ((int32_t)data[22] << 8) | ((int32_t)data[23]);
+    if (compact)
+    {
+        WritePuppetCompactLocked(writer, pak);
+    }
+    else
+    {
+        EncodePacket(writer, pak);
+    }
 
-    EnqueueEvent(PacketType::HoneycombCollected, "", {map_id, honeycomb_id, x, y, z}, player_id);
+    if (FinishPacketLocked(writer) && piggybackAcks)
+    {
+        m_ackPending = false;
+    }
 }
 
-void NetworkClient::HandleMumboTokenCollected(const uint8_t *data, int len)
+// a delta against the newest keyframe the server acked when there is one
+// and it isn't time for a fresh keyframe, otherwise a keyframe
+void NetworkClient::WritePuppetCompactLocked(PacketWriter &writer, const PuppetUpdatePacket &pak)
 {
-    if (len < 24)
-        return;
+    uint8_t image[PUPPET_IMAGE_SIZE];
+    BuildPuppetImage(pak, image);
+
+    const PuppetBaseline *baseline = nullptr;
+    int acked = m_puppetAckedBaseline.load(std::memory_order_relaxed);
+    if (acked >= 0)
+    {
+        const PuppetBaseline &slot = m_puppetSent[acked % PUPPET_BASELINE_SLOTS];
+        if (slot.valid && slot.id == acked)
+        {
+            baseline = &slot;
+        }
+    }
+
+    if (baseline && m_puppetSinceKeyframe < PUPPET_KEYFRAME_INTERVAL)
+    {
+        uint16_t mask = 0;
+        for (size_t i = 0; i < std::size(PUPPET_DELTA_FIELDS); i++)
+        {
+            const PuppetDeltaField &field = PUPPET_DELTA_FIELDS[i];
+            if (std::memcmp(image + field.offset, baseline->image.data() + field.offset, field.size) != 0)
+            {
+                mask |= (uint16_t)(1u << i);
+            }
+        }
 
-    uint32_t player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                         ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
+        writer.WriteU8(PUPPET_SHAPE_DELTA);
+        writer.WriteU8(baseline->id);
+        writer.WriteU16BE(mask);
 
-    int32_t map_id = ((int32_t)data[4] << 24) | ((int32_t)data[5] << 16) |
-                     ((int32_t)data[6] << 8) | ((int32_t)data[7]);
+        for (size_t i = 0; i < std::size(PUPPET_DELTA_FIELDS); i++)
+        {
+            if (mask & (1u << i))
+            {
+                writer.WriteBytes(image + PUPPET_DELTA_FIELDS[i].offset, PUPPET_DELTA_FIELDS[i].size);
+            }
+        }
 
-    int32_t token_id = ((int32_t)data[8] << 24) | ((int32_t)data[9] << 16) |
-                       ((int32_t)data[10] << 8) | ((int32_t)data[11]);
+        m_puppetSinceKeyframe++;
+        return;
+    }
 
-    int32_t x = ((int32_t)data[12] << 24) | ((int32_t)data[13] << 16) |
-                ((int32_t)data[14] << 8) | ((int32_t)data[15]);
+    bool tilted = std::memcmp(image + PUPPET_COMPACT_SIZE, "\0\0\0\0", PUPPET_COMPACT_TILT_SIZE) != 0;
+    uint8_t id = m_puppetNextBaselineId++;
 
-    int32_t y = ((int32_t)data[16] << 24) | ((int32_t)data[17] << 16) |
-                ((int32_t)data[18] << 8) | ((int32_t)data[19]);
+    writer.WriteU8(tilted ? PUPPET_SHAPE_TILT : 0);
+    writer.WriteU8(id);
+    writer.WriteBytes(image, tilted ? PUPPET_IMAGE_SIZE : PUPPET_COMPACT_SIZE);
 
-    int32_t z = ((int32_t)data[20] << 24) | ((int32_t)data[21] << 16) |
-                ((int32_t)data[22] << 8) | ((int32_t)data[23]);
+    PuppetBaseline &slot = m_puppetSent[id % PUPPET_BASELINE_SLOTS];
+    slot.valid = true;
+    slot.id = id;
+    std::memcpy(slot.image.data(), image, PUPPET_IMAGE_SIZE);
 
-    EnqueueEvent(PacketType::MumboTokenCollected, "", {map_id, token_id, x, y, z}, player_id);
+    m_puppetSinceKeyframe = 0;
 }
 
-void NetworkClient::SendJiggy(int jiggyEnumId, int collectedValue)
+// The FullSyncRequest tells the server what we already have, so it only
+// sends what differs. That has to be what the game has applied, not what
+// went over the wire, so the game hashes it (native_state_digest_*) and
+// SendFullSyncRequest sends it. The message goes through the queue like any
+// other, so everything handed to the game before it is applied by then
+void NetworkClient::RequestFullSync()
 {
-    uint8_t buffer[8];
-    std::memcpy(&buffer[0], &jiggyEnumId, 4);
-    std::memcpy(&buffer[4], &collectedValue, 4);
-    SendReliablePacket(PacketType::JiggyCollected, buffer, 8);
+    BeginMessage(PacketType::FullSyncRequest, -1);
+    FinishMessage();
 }
 
-void NetworkClient::SendNote(int mapId, int levelId, bool isDynamic, int noteIndex)
+void NetworkClient::BeginStateDigest()
 {
-    printf("[CLIENT] SendNote: map=%d, level=%d, is_dynamic=%d, note_index=%d\n",
-           mapId, levelId, isDynamic, noteIndex);
+    m_digestStaging.Clear();
+}
 
-    uint8_t buffer[13];
-    std::memcpy(&buffer[0], &mapId, 4);
-    std::memcpy(&buffer[4], &levelId, 4);
-    buffer[8] = isDynamic ? 1 : 0;
-    std::memcpy(&buffer[9], &noteIndex, 4);
-    SendReliablePacket(PacketType::NoteCollected, buffer, 13);
+void NetworkClient::AddStateDigestItem(DigestCategory category, int32_t a, int32_t b)
+{
+    m_digestStaging.Add(category, a, b);
 }
 
-void NetworkClient::SendNotePos(int mapId, int x, int y, int z)
+void NetworkClient::AddStateDigestBits(DigestCategory category, int32_t a, const std::vector<uint8_t> &bytes)
 {
-    uint8_t buffer[10];
-    std::memcpy(&buffer[0], &mapId, 4);
-    int16_t x16 = (int16_t)x;
-    int16_t y16 = (int16_t)y;
-    int16_t z16 = (int16_t)z;
-    std::memcpy(&buffer[4], &x16, 2);
-    std::memcpy(&buffer[6], &y16, 2);
-    std::memcpy(&buffer[8], &z16, 2);
-    SendReliablePacket(PacketType::NoteCollectedPos, buffer, 10);
+    m_digestStaging.AddBits(category, a, bytes.data(), bytes.size());
 }
 
-void NetworkClient::SendNoteSaveData(int levelIndex, const std::vector<uint8_t> &saveData)
+void NetworkClient::AddStateDigestBlob(PacketType type, const std::vector<uint8_t> &blob)
+{
+    m_digestStaging.AddProgressBlob(type, blob.data(), blob.size());
+}
+
+void NetworkClient::SendFullSyncRequest()
 {
-    std::vector<uint8_t> buffer;
-    buffer.resize(4 + saveData.size());
-    std::memcpy(&buffer[0], &levelIndex, 4);
-    if (!saveData.empty())
+    uint8_t payload[STATE_DIGEST_CATEGORIES * STATE_DIGEST_SIZE];
+    PacketWriter writer(payload, sizeof(payload));
+
     {
-        std::memcpy(&buffer[4], saveData.data(), saveData.size());
+        std::lock_guard<std::mutex> lock(m_lobbyDigestMutex);
+        std::swap(m_lobbyDigest, m_digestStaging);
+        for (uint64_t digest : m_lobbyDigest.Digests())
+        {
+            writer.WriteU64LE(digest);
+        }
     }
-    SendReliablePacket(PacketType::NoteSaveData, buffer.data(), buffer.size());
+
+    SendReliablePacket(PacketType::FullSyncRequest, writer.Data(), writer.Size());
 }
 
-void NetworkClient::SendLevelOpened(int worldId, int jiggyCost)
+// the server's per-bucket digests for a category that differs from ours;
+// ask for the buckets that don't match
+void NetworkClient::HandleStateDigestBuckets(const uint8_t *data, int /*len*/)
 {
-    uint8_t buffer[8];
-    std::memcpy(&buffer[0], &worldId, 4);
-    std::memcpy(&buffer[4], &jiggyCost, 4);
-    SendReliablePacket(PacketType::LevelOpened, buffer, 8);
+    uint8_t category = data[0];
+    if (category >= STATE_DIGEST_CATEGORIES)
+    {
+        return;
+    }
+
+    uint16_t mask = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_lobbyDigestMutex);
+        const std::array<uint64_t, STATE_DIGEST_BUCKETS> &ours = m_lobbyDigest.Buckets((DigestCategory)category);
+
+        for (size_t bucket = 0; bucket < STATE_DIGEST_BUCKETS; bucket++)
+        {
+            uint64_t theirs = LoadWire<WireOrder::Little, uint64_t>(data + 1 + bucket * STATE_DIGEST_SIZE);
+            if (theirs != ours[bucket])
+            {
+                mask |= (uint16_t)(1 << bucket);
+            }
+        }
+    }
+
+    if (mask != 0)
+    {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "[COOP][NET] state category %u differs in buckets 0x%04x", category, mask);
+        coop_dll_log(msg);
+
+        uint8_t payload[3];
+        PacketWriter writer(payload, sizeof(payload));
+        writer.WriteU8(category);
+        writer.WriteU16LE(mask);
+        SendReliablePacket(PacketType::FullSyncBucketsRequest, writer.Data(), writer.Size());
+    }
 }
 
-void NetworkClient::SendPuppetUpdate(const PuppetUpdatePacket &pak)
+// Sends a progress blob as just the bits set since we last got it out, or
+// whole when there's nothing to diff against (first send this session), the
+// server can't take ProgressBits, or the delta wouldn't come out smaller.
+void NetworkClient::SendProgressBlob(PacketType type, const std::vector<uint8_t> &blob)
 {
-    std::vector<uint8_t> buffer;
-    buffer.reserve(128);
+    if (blob.empty())
+    {
+        return;
+    }
 
-    auto write_float = [&buffer](float f)
+    if (m_progressResync.exchange(false, std::memory_order_relaxed))
     {
-        uint32_t bits;
-        std::memcpy(&bits, &f, sizeof(float));
-        buffer.push_back((bits >> 24) & 0xFF);
-        buffer.push_back((bits >> 16) & 0xFF);
-        buffer.push_back((bits >> 8) & 0xFF);
-        buffer.push_back(bits & 0xFF);
-    };
+        for (std::vector<uint8_t> &sent : m_progressSent)
+        {
+            sent.clear();
+        }
+    }
 
-    write_float(pak.x);
-    write_float(pak.y);
-    write_float(pak.z);
-    write_float(pak.yaw);
-    write_float(pak.pitch);
-    write_float(pak.roll);
-    write_float(pak.anim_duration);
-    write_float(pak.anim_timer);
+    std::vector<uint8_t> &sent = m_progressSent[static_cast<uint8_t>(type) - static_cast<uint8_t>(PacketType::FileProgressFlags)];
+    auto remember = [&]()
+    {
+        if (sent.capacity() < blob.size())
+        {
+            m_sendAllocations++;
+        }
+        sent.assign(blob.begin(), blob.end());
+    };
 
-    buffer.push_back((pak.level_id >> 8) & 0xFF);
-    buffer.push_back(pak.level_id & 0xFF);
-    buffer.push_back((pak.map_id >> 8) & 0xFF);
-    buffer.push_back(pak.map_id & 0xFF);
+    const bool canDelta = m_capabilities.load(std::memory_order_relaxed) & CAPABILITY_PROGRESS_BITS;
 
-    buffer.push_back((pak.anim_id >> 8) & 0xFF);
-    buffer.push_back(pak.anim_id & 0xFF);
+    if (canDelta && sent.size() == blob.size())
+    {
+        // capped a byte under the full blob, so overflowing means it isn't worth it
+        uint8_t payload[PROGRESS_BITS_HEADER_SIZE + PROGRESS_BLOB_MAX_SIZE];
+        PacketWriter writer(payload, std::min(sizeof(payload), blob.size() - 1));
+        writer.WriteU8(static_cast<uint8_t>(type));
 
-    buffer.push_back(pak.model_id);
-    buffer.push_back(pak.flags);
-    buffer.push_back(pak.playback_type);
-    buffer.push_back(pak.playback_direction);
+        uint32_t next = 0;
+        for (size_t i = 0; i < blob.size(); i++)
+        {
+            for (uint8_t fresh = blob[i] & ~sent[i]; fresh != 0; fresh &= fresh - 1)
+            {
+                uint32_t index = (uint32_t)(i * 8) + (uint32_t)std::countr_zero(fresh);
+                writer.WriteVarU32(index - next);
+                next = index + 1;
+            }
+        }
 
-    SendRawPacket(PacketType::PuppetUpdate, buffer.data(), buffer.size());
-}
+        if (writer.Ok())
+        {
+            // only cleared bits, which the lobby keeps set anyway
+            bool queued = writer.Size() == PROGRESS_BITS_HEADER_SIZE ||
+                          SendReliablePacket(PacketType::ProgressBits, writer.Data(), writer.Size());
+            if (queued)
+            {
+                remember();
+            }
+            return;
+        }
+    }
 
-void NetworkClient::RequestFullSync()
-{
-    SendReliablePacket(PacketType::FullSyncRequest, nullptr, 0);
+    if (SendBulkPacket(type, blob.data(), blob.size()))
+    {
+        remember();
+    }
 }
 
 void NetworkClient::SendFileProgressFlags(const std::vector<uint8_t> &flags)
 {
-    if (!flags.empty())
-    {
-        SendReliablePacket(PacketType::FileProgressFlags, flags.data(), flags.size());
-    }
+    SendProgressBlob(PacketType::FileProgressFlags, flags);
 }
 
 void NetworkClient::SendAbilityProgress(const std::vector<uint8_t> &bytes)
 {
-    if (!bytes.empty())
-    {
-        SendReliablePacket(PacketType::AbilityProgress, bytes.data(), bytes.size());
-    }
+    SendProgressBlob(PacketType::AbilityProgress, bytes);
 }
 
 void NetworkClient::SendHoneycombScore(const std::vector<uint8_t> &bytes)
 {
-    if (!bytes.empty())
-    {
-        SendReliablePacket(PacketType::HoneycombScore, bytes.data(), bytes.size());
-    }
+    SendProgressBlob(PacketType::HoneycombScore, bytes);
 }
 
 void NetworkClient::SendMumboScore(const std::vector<uint8_t> &bytes)
 {
-    if (!bytes.empty())
+    SendProgressBlob(PacketType::MumboScore, bytes);
+}
+
+// the compact encoding is negotiated and the position fits its s16 coordinates
+bool NetworkClient::SendCollectiblesCompact(int x, int y, int z) const
+{
+    auto fits = [](int value)
     {
-        SendReliablePacket(PacketType::MumboScore, bytes.data(), bytes.size());
-    }
+        return value >= INT16_MIN && value <= INT16_MAX;
+    };
+
+    return (m_capabilities.load(std::memory_order_relaxed) & CAPABILITY_COMPACT_COLLECTIBLES) && fits(x) && fits(y) && fits(z);
 }
 
 void NetworkClient::SendHoneycombCollected(int mapId, int honeycombId, int x, int y, int z)
 {
-    uint8_t buffer[20];
-    std::memcpy(&buffer[0], &mapId, 4);
-    std::memcpy(&buffer[4], &honeycombId, 4);
-    std::memcpy(&buffer[8], &x, 4);
-    std::memcpy(&buffer[12], &y, 4);
-    std::memcpy(&buffer[16], &z, 4);
-    SendReliablePacket(PacketType::HoneycombCollected, buffer, 20);
+    if (SendCollectiblesCompact(x, y, z))
+    {
+        SendEncoded(PacketType::HoneycombCollectedCompact, HoneycombCollectedCompactPacket{{mapId, honeycombId, x, y, z}}, true);
+    }
+    else
+    {
+        SendEncoded(PacketType::HoneycombCollected, HoneycombCollectedPacket{mapId, honeycombId, x, y, z}, true);
+    }
 }
 
 void NetworkClient::SendMumboTokenCollected(int mapId, int tokenId, int x, int y, int z)
 {
-    uint8_t buffer[20];
-    std::memcpy(&buffer[0], &mapId, 4);
-    std::memcpy(&buffer[4], &tokenId, 4);
-    std::memcpy(&buffer[8], &x, 4);
-    std::memcpy(&buffer[12], &y, 4);
-    std::memcpy(&buffer[16], &z, 4);
-    SendReliablePacket(PacketType::MumboTokenCollected, buffer, 20);
+    if (SendCollectiblesCompact(x, y, z))
+    {
+        SendEncoded(PacketType::MumboTokenCollectedCompact, MumboTokenCollectedCompactPacket{{mapId, tokenId, x, y, z}}, true);
+    }
+    else
+    {
+        SendEncoded(PacketType::MumboTokenCollected, MumboTokenCollectedPacket{mapId, tokenId, x, y, z}, true);
+    }
 }
 
 void NetworkClient::HandlePlayerInfoRequest(const uint8_t *data, int len)
 {
-    if (len < 8)
+    if (!PlayerInfoRequestPacketView::Fits((size_t)len))
         return;
 
-    uint32_t target_player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                                ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
-
-    uint32_t requester_player_id = ((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) |
-                                   ((uint32_t)data[6] << 8) | ((uint32_t)data[7]);
-
-    EnqueueEvent(PacketType::PlayerInfoRequest, "", {(int32_t)target_player_id, (int32_t)requester_player_id}, 0);
+    PlayerInfoRequestPacketView pak(data);
+    GameMessageHeader &msg = BeginMessage(PacketType::PlayerInfoRequest, 0);
+    msg.param1 = (int32_t)pak.target_player_id();
+    msg.param2 = (int32_t)pak.requester_player_id();
+    FinishMessage();
 }
 
 void NetworkClient::HandlePlayerInfoResponse(const uint8_t *data, int len)
 {
-    if (len < 24)
+    if (!PlayerInfoResponsePacketView::Fits((size_t)len))
         return;
 
-    uint32_t target_player_id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                                ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
-
-    int16_t map_id = ((int16_t)data[4] << 8) | (int16_t)data[5];
-    int16_t level_id = ((int16_t)data[6] << 8) | (int16_t)data[7];
+    PlayerInfoResponsePacketView pak(data);
+    GameMessageHeader &msg = BeginMessage(PacketType::PlayerInfoResponse, 0);
+    msg.param1 = (int32_t)pak.target_player_id();
+    msg.param2 = (int32_t)pak.map_id();
+    msg.param3 = (int32_t)pak.level_id();
 
-    float x, y, z, yaw;
-    std::memcpy(&x, &data[8], 4);
-    std::memcpy(&y, &data[12], 4);
-    std::memcpy(&z, &data[16], 4);
-    std::memcpy(&yaw, &data[20], 4);
+    // the mod reads these back as floats
+    msg.param4 = std::bit_cast<int32_t>(pak.x());
+    msg.param5 = std::bit_cast<int32_t>(pak.y());
+    msg.param6 = std::bit_cast<int32_t>(pak.z());
+    msg.paramF1 = pak.yaw();
 
-    uint32_t x_int = ((uint32_t)data[8] << 24) | ((uint32_t)data[9] << 16) |
-                     ((uint32_t)data[10] << 8) | (uint32_t)data[11];
-    uint32_t y_int = ((uint32_t)data[12] << 24) | ((uint32_t)data[13] << 16) |
-                     ((uint32_t)data[14] << 8) | (uint32_t)data[15];
-    uint32_t z_int = ((uint32_t)data[16] << 24) | ((uint32_t)data[17] << 16) |
-                     ((uint32_t)data[18] << 8) | (uint32_t)data[19];
-    uint32_t yaw_int = ((uint32_t)data[20] << 24) | ((uint32_t)data[21] << 16) |
-                       ((uint32_t)data[22] << 8) | (uint32_t)data[23];
-
-    std::memcpy(&x, &x_int, 4);
-    std::memcpy(&y, &y_int, 4);
-    std::memcpy(&z, &z_int, 4);
-    std::memcpy(&yaw, &yaw_int, 4);
-
-    std::vector<int32_t> params;
-    params.push_back((int32_t)target_player_id);
-    params.push_back((int32_t)map_id);
-    params.push_back((int32_t)level_id);
-
-    int32_t x_as_int, y_as_int, z_as_int, yaw_as_int;
-    std::memcpy(&x_as_int, &x, 4);
-    std::memcpy(&y_as_int, &y, 4);
-    std::memcpy(&z_as_int, &z, 4);
-    std::memcpy(&yaw_as_int, &yaw, 4);
-
-    params.push_back(x_as_int);
-    params.push_back(y_as_int);
-    params.push_back(z_as_int);
-    params.push_back(yaw_as_int);
-
-    EnqueueEvent(PacketType::PlayerInfoResponse, "", params, 0);
+    FinishMessage();
 }
 
 void NetworkClient::HandlePlayerListUpdate(const uint8_t *data, int len)
 {
-    if (len < 4)
-        return;
-
-    uint32_t player_count = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-                            ((uint32_t)data[2] << 8) | ((uint32_t)data[3]);
+    uint32_t player_count = LoadWire<WireOrder::Big, uint32_t>(data);
 
-    int offset = 4;
+    size_t offset = 4;
 
-    for (uint32_t i = 0; i < player_count && offset < len; i++)
+    for (uint32_t i = 0; i < player_count; i++)
     {
-        if (offset + 8 > len)
+        PlayerListEntryPacket entry;
+        size_t used = DecodePacket(data + offset, (size_t)len - offset, entry);
+        if (used == 0)
             break;
 
-        uint32_t player_id = ((uint32_t)data[offset] << 24) | ((uint32_t)data[offset + 1] << 16) |
-                             ((uint32_t)data[offset + 2] << 8) | ((uint32_t)data[offset + 3]);
-        offset += 4;
+        offset += used;
 
-        uint32_t username_len = ((uint32_t)data[offset] << 24) | ((uint32_t)data[offset + 1] << 16) |
-                                ((uint32_t)data[offset + 2] << 8) | ((uint32_t)data[offset + 3]);
-        offset += 4;
-
-        if (offset + username_len > (uint32_t)len)
-            break;
-
-        std::string username((const char *)(data + offset), username_len);
-        offset += username_len;
-
-        EnqueueEvent(PacketType::PlayerListUpdate, username, {(int32_t)player_id}, player_id);
+        GameMessageHeader &msg = BeginMessage(PacketType::PlayerListUpdate, entry.player_id,
+                                              entry.username.data(), entry.username.size());
+        msg.param1 = (int32_t)entry.player_id;
+        FinishMessage();
     }
 }
 
 void NetworkClient::SendPlayerInfoRequest(uint32_t targetPlayerId, uint32_t requesterPlayerId)
 {
-    uint8_t buffer[8];
-    buffer[0] = (targetPlayerId >> 24) & 0xFF;
-    buffer[1] = (targetPlayerId >> 16) & 0xFF;
-    buffer[2] = (targetPlayerId >> 8) & 0xFF;
-    buffer[3] = targetPlayerId & 0xFF;
-    buffer[4] = (requesterPlayerId >> 24) & 0xFF;
-    buffer[5] = (requesterPlayerId >> 16) & 0xFF;
-    buffer[6] = (requesterPlayerId >> 8) & 0xFF;
-    buffer[7] = requesterPlayerId & 0xFF;
-
-    SendRawPacket(PacketType::PlayerInfoRequest, buffer, 8);
+    SendEncoded(PacketType::PlayerInfoRequest, PlayerInfoRequestPacket{targetPlayerId, requesterPlayerId}, false);
 }
 
 void NetworkClient::SendPlayerInfoResponse(uint32_t targetPlayerId, int16_t mapId, int16_t levelId,
                                            float x, float y, float z, float yaw)
 {
-    uint8_t buffer[24];
-
-    buffer[0] = (targetPlayerId >> 24) & 0xFF;
-    buffer[1] = (targetPlayerId >> 16) & 0xFF;
-    buffer[2] = (targetPlayerId >> 8) & 0xFF;
-    buffer[3] = targetPlayerId & 0xFF;
-
-    buffer[4] = (mapId >> 8) & 0xFF;
-    buffer[5] = mapId & 0xFF;
-
-    buffer[6] = (levelId >> 8) & 0xFF;
-    buffer[7] = levelId & 0xFF;
-
-    uint32_t x_int, y_int, z_int, yaw_int;
-    std::memcpy(&x_int, &x, 4);
-    std::memcpy(&y_int, &y, 4);
-    std::memcpy(&z_int, &z, 4);
-    std::memcpy(&yaw_int, &yaw, 4);
-
-    buffer[8] = (x_int >> 24) & 0xFF;
-    buffer[9] = (x_int >> 16) & 0xFF;
-    buffer[10] = (x_int >> 8) & 0xFF;
-    buffer[11] = x_int & 0xFF;
-
-    buffer[12] = (y_int >> 24) & 0xFF;
-    buffer[13] = (y_int >> 16) & 0xFF;
-    buffer[14] = (y_int >> 8) & 0xFF;
-    buffer[15] = y_int & 0xFF;
-
-    buffer[16] = (z_int >> 24) & 0xFF;
-    buffer[17] = (z_int >> 16) & 0xFF;
-    buffer[18] = (z_int >> 8) & 0xFF;
-    buffer[19] = z_int & 0xFF;
-
-    buffer[20] = (yaw_int >> 24) & 0xFF;
-    buffer[21] = (yaw_int >> 16) & 0xFF;
-    buffer[22] = (yaw_int >> 8) & 0xFF;
-    buffer[23] = yaw_int & 0xFF;
-
-    SendRawPacket(PacketType::PlayerInfoResponse, buffer, 24);
+    SendEncoded(PacketType::PlayerInfoResponse,
+                PlayerInfoResponsePacket{targetPlayerId, mapId, levelId, x, y, z, yaw}, false);
 }
 
+// the upload that follows is the server's baseline, so it goes out whole
 void NetworkClient::UploadInitialSaveData()
 {
+    for (std::vector<uint8_t> &sent : m_progressSent)
+    {
+        sent.clear();
+    }
 }
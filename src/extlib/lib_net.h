@@ -7,8 +7,16 @@
 #include <mutex>
 #include <memory>
 #include <functional>
+#include <thread>
+#include <deque>
+#include <array>
+#include <unordered_map>
 
 #include "lib_packets.h"
+#include "lib_message_queue.h"
+#include "lib_ring_buffer.h"
+#include "lib_packet_writer.h"
+#include "lib_state_digest.h"
 
 #ifdef _WIN32
     #include <winsock2.h>
@@ -16,7 +24,9 @@
     #pragma comment(lib, "ws2_32.lib")
 #else
     #include <sys/socket.h>
+    #include <sys/select.h>
     #include <arpa/inet.h>
+    #include <netdb.h>
     #include <unistd.h>
     #include <fcntl.h>
     #define SOCKET int
@@ -24,65 +34,327 @@
     #define SOCK_ERR(ret) ((ret) < 0)
 #endif
 
-struct NetEvent {
-    PacketType type;
+// Where the client is in getting (and staying) connected. Only the polling
+// thread moves it along; each change is also queued as a ConnectionStatus
+// for the game thread to report.
+enum class ConnectionState : uint8_t {
+    Idle = 0,
+    Resolving = 1,
+    Handshaking = 2,
+    Connected = 3,
+    Resuming = 4,
+    Failed = 5,
+};
+
+struct ConnectionStatus {
+    ConnectionState state;
+    // our player id, once the server has accepted us
     int playerId;
-    std::string textData;
-    std::vector<int32_t> intData;
-    std::vector<float> floatData;
+    // first handshake to HandshakeAccepted, for Connected
+    uint32_t latencyMs;
+};
+
+// A reliable datagram we've sent and haven't seen a ReliableAck for yet.
+// The full datagram (type + seq + payload) is kept so resends are a plain sendto.
+// These live in a fixed pool and are reused, so the datagram keeps its capacity.
+struct PendingReliable {
+    uint32_t seq;
+    std::vector<uint8_t> datagram;
+    uint32_t lastSendTime;
+    uint8_t attempts;
+};
+
+// Sliding bitmap of reliable sequence numbers recently received from one sender.
+// Bit N of the mask is set when (highest - N) has been seen. Lets us keep
+// acking server retransmissions (our ack may be what got lost) without
+// decoding and queueing the same collectible again.
+struct ReliableReceiveWindow {
+    static constexpr uint32_t WINDOW_BITS = 256;
+
+    uint32_t highest = 0;
+    std::array<uint64_t, WINDOW_BITS / 64> seen{};
+    bool initialized = false;
+
+    // true if seq is new (and records it), false if it's a duplicate
+    // or too old to tell apart from one
+    bool Accept(uint32_t seq);
+    void Reset();
+    // the RELIABLE_ACK_MASK_BITS seqs just below highest, in ack block order
+    uint64_t AckMask() const;
+
+private:
+    void Advance(uint32_t count);
 };
 
+// A fragmented message being put back together. Chunks are fixed size
+// apart from the last, so each one lands straight at index * chunk size.
+struct FragmentAssembly {
+    uint16_t id;
+    uint16_t count;
+    uint16_t received;
+    uint32_t startTime;
+    size_t size;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> have;
+};
+
+// A puppet keyframe kept as a delta baseline, as its quantized image.
+struct PuppetBaseline {
+    bool valid = false;
+    uint8_t id = 0;
+    std::array<uint8_t, PUPPET_IMAGE_SIZE> image{};
+};
+
+// Keyframes kept per puppet, indexed by baseline id. Deltas are taken
+// against the newest acked keyframe, which trails the newest sent by an RTT.
+constexpr size_t PUPPET_BASELINE_SLOTS = 4;
+using PuppetBaselineRing = std::array<PuppetBaseline, PUPPET_BASELINE_SLOTS>;
+
+// A lookup of the server's address. getaddrinfo can block for seconds, so it
+// runs on a helper thread that shares this with the polling thread; one that's
+// abandoned (Configure again, or the client going away) just finishes unread.
+struct AddressLookup {
+    enum Result : int { Pending = 0, Resolved = 1, Failed = -1 };
+
+    std::string host;
+    struct sockaddr_in addr{};
+    std::atomic<int> result{Pending};
+};
+
+// Largest datagram we build or accept. Matches the server's receive buffer.
+constexpr size_t NET_MAX_DATAGRAM_SIZE = 2048;
+
 class NetworkClient {
+    // the packet table points straight at the private Handle* methods
+    friend struct PacketTable;
+
 private:
     SOCKET m_udpSocket;
     struct sockaddr_in m_serverAddr;
-    bool m_isConnected;
-    bool m_needsInit;
+    std::atomic<ConnectionState> m_state;
+    bool m_threaded;
     
     std::string m_host;
     std::string m_user;
     std::string m_lobby;
     std::string m_pass;
 
-    uint32_t m_lastHandshakeTime;
+    // the Resolving state's lookup in progress, if any (polling thread only)
+    std::shared_ptr<AddressLookup> m_addressLookup;
+
+    // connect attempts in the current Resolving/Handshaking/Resuming stretch,
+    // spaced out by exponential backoff (polling thread only)
+    uint32_t m_connectAttempts;
+    uint32_t m_nextConnectAttemptTime;
+    uint32_t m_connectStartTime;
+    int m_localPlayerId;
+
+    // CAPABILITY_* bits negotiated in the last HandshakeAccepted. written by
+    // the polling thread, read when sending
+    std::atomic<uint32_t> m_capabilities;
+
+    // our puppet keyframes (guarded by m_sendMutex) and the newest one the
+    // server has acked (-1 for none; written by the polling thread)
+    PuppetBaselineRing m_puppetSent;
+    uint8_t m_puppetNextBaselineId;
+    uint32_t m_puppetSinceKeyframe;
+    std::atomic<int> m_puppetAckedBaseline;
+
+    // other players' keyframes by player id, for rebuilding their deltas (polling thread only)
+    std::unordered_map<uint32_t, PuppetBaselineRing> m_puppetBaselines;
+
+    // the progress blobs as we last got them out, indexed from FileProgressFlags
+    // (game thread only). cleared when the polling thread sets m_progressResync
+    // after joining a new session, so the next send is the full blob again.
+    // reserved up front like the reliable pool's datagrams
+    std::array<std::vector<uint8_t>, PROGRESS_BLOB_KINDS> m_progressSent;
+    std::atomic<bool> m_progressResync;
+
+    // what the game had applied when it last hashed it for a FullSyncRequest,
+    // for comparing against the server's buckets. the game fills
+    // m_digestStaging (game thread only), swapped in when the request goes out
+    LobbyStateDigest m_lobbyDigest;
+    LobbyStateDigest m_digestStaging;
+    std::mutex m_lobbyDigestMutex;
+
+    // state changes waiting for the game thread
+    SpscRing<ConnectionStatus, 16> m_statusQueue;
+
     uint32_t m_lastPingTime;
-    uint32_t m_lastPacketSentTime;
+    uint32_t m_lastReceiveTime;
+    std::atomic<uint32_t> m_lastPacketSentTime;
     uint32_t m_reliableSeqCounter;
 
-    std::queue<NetEvent> m_eventQueue;
-    std::mutex m_queueMutex;
+    // reliable retransmission window (guarded by m_sendMutex).
+    // in-flight is capped, anything over the cap waits in the backlog.
+    // both hold indices into the preallocated pool, oldest first. the
+    // backlog is a ring over pool-sized storage, each queued slot taking
+    // one entry, so it never fills
+    std::vector<PendingReliable> m_reliablePool;
+    std::vector<uint16_t> m_reliableFreeSlots;
+    std::vector<uint16_t> m_reliableInFlight;
+    std::vector<uint16_t> m_reliableBacklog;
+    size_t m_reliableBacklogHead;
+    size_t m_reliableBacklogCount;
+    uint32_t m_srttMs;
+    uint32_t m_rttVarMs;
+    uint32_t m_rtoMs;
+    bool m_hasRttSample;
+
+    // where handlers decode incoming packets to, straight into a reserved slot
+    // by whichever thread polls the socket, for net_msg_poll_batch on the game thread
+    MessageQueue &m_messages;
+    // the message BeginMessage handed out, if it's a reserved slot rather than
+    // the back of the overflow (polling thread only)
+    bool m_messageReserved;
+    size_t m_messageTicket;
+    // producer-side spill for when the queue is full; owned by the polling thread
+    struct SpilledMessage
+    {
+        GameMessageHeader header;
+        std::vector<uint8_t> data;
+    };
+    std::deque<SpilledMessage> m_messageOverflow;
 
-    bool PerformLazyInit();
+    // duplicate suppression for incoming reliable packets, keyed by sender ip:port.
+    // owned by the polling thread
+    std::unordered_map<uint64_t, ReliableReceiveWindow> m_reliableRecvWindows;
+    uint32_t m_reliableDuplicatesDropped;
+
+    // session the server handed us at handshake (polling thread only).
+    // a reconnect presents the token and the last applied state seq, and
+    // the server replays just the lobby changes after it instead of a full sync.
+    // m_stateAhead holds seqs applied out of order above m_stateApplied
+    bool m_hasSession;
+    bool m_resumeRequested;
+    uint64_t m_sessionToken;
+    uint32_t m_stateApplied;
+    std::vector<uint32_t> m_stateAhead;
+
+    // outgoing fragment message ids, and incoming partial messages (polling thread only)
+    std::atomic<uint16_t> m_nextFragmentId;
+    std::vector<FragmentAssembly> m_fragments;
+    // where HandleCompressed unpacks to (polling thread only)
+    std::vector<uint8_t> m_unpackScratch;
+
+    // acks gathered since the last flush (guarded by m_sendMutex).
+    // sent once per poll, or earlier on the back of a puppet update
+    bool m_ackPending;
+    uint32_t m_ackHighest;
+    uint64_t m_ackMask;
+    uint32_t m_ackOldestUnsent;
+    uint32_t m_lastAckFlushTime;
+
+    // every non-reliable packet is serialized here before it's queued (guarded by m_sendMutex)
+    std::array<uint8_t, NET_MAX_DATAGRAM_SIZE> m_sendScratch;
+    // times the send path had to grow a buffer; should stay flat once a session is warm
+    std::atomic<uint32_t> m_sendAllocations;
+
+    // messages queued for this frame's bundle (guarded by m_sendMutex)
+    std::vector<uint8_t> m_outFrame;
+    uint32_t m_outFrameRecords;
+    uint32_t m_outFrameOpenedTime;
+
+    // guards the socket handle and everything on the send path,
+    // since the game thread sends while the io thread receives
+    std::mutex m_sendMutex;
+
+    std::thread m_ioThread;
+    std::atomic<bool> m_ioRunning;
+
+    void StartAddressLookup();
+    bool OpenSocket(const struct sockaddr_in& addr);
+    void SetState(ConnectionState state, uint32_t latencyMs = 0);
+    void BeginConnectAttempts(ConnectionState state, uint32_t now);
+    void SendHandshake();
+    void CloseSocket();
+    void Poll();
+    void IoThreadMain();
+    void StartIoThread();
+    void StopIoThread();
+    void WaitForSocket(uint32_t timeoutMs);
+    bool FlushMessageOverflow();
+    GameMessageHeader& BeginMessage(PacketType type, int playerId, const void* data = nullptr, size_t size = 0);
+    void FinishMessage();
     void SendRawPacket(PacketType type, const void* data, size_t size);
-    void SendReliablePacket(PacketType type, const void* data, size_t size);
-    bool IsReliableType(PacketType type);
+    bool SendReliablePacket(PacketType type, const void* data, size_t size);
+    bool SendBulkPacket(PacketType type, const void* data, size_t size);
+    template <typename T>
+    void SendEncoded(PacketType type, const T& packet, bool reliable);
+    PacketWriter BeginPacketLocked(PacketType type);
+    bool FinishPacketLocked(const PacketWriter& writer);
+    void ReleaseReliableSlotLocked(uint16_t slot);
+    bool SendDatagramLocked(const uint8_t* data, size_t size);
+    bool TransmitLocked(const uint8_t* data, size_t size);
+    bool FlushOutgoingLocked();
+    void HandleDatagram(const uint8_t* data, int len, const struct sockaddr_in& from, uint32_t now);
+    void HandleMessage(const uint8_t* data, int len, const struct sockaddr_in& from);
+    void DispatchPayload(PacketType type, const uint8_t* payload, int len);
+    bool SendFragmented(PacketType type, const void* data, size_t size);
+    void SendProgressBlob(PacketType type, const std::vector<uint8_t>& blob);
+    bool SendCollectiblesCompact(int x, int y, int z) const;
+    void ExpireFragments(uint32_t now);
+    bool AcceptStateSeq(uint32_t seq);
+    void FoldStateAhead();
+    void ResetSession();
+    void ResetReliableState();
+    void ResendReliablePackets(uint32_t now);
+    void QueueReliableLocked(PacketType type, const void* data, size_t size);
+    void PumpReliableBacklogLocked(uint32_t now);
+    void UpdateRtt(uint32_t sampleMs);
+    bool AcceptReliableSequence(const struct sockaddr_in& from, uint32_t seq);
+    void QueueReliableAck(const struct sockaddr_in& from, uint32_t seq);
+    void FlushPendingAcks();
+    void WritePuppetCompactLocked(PacketWriter& writer, const PuppetUpdatePacket& pak);
+    void WriteAckBlockLocked(PacketWriter& writer) const;
+    bool SendAckBlockLocked();
     void SendPing();
+
+    // packet handlers, dispatched through the packet table. each one can
+    // assume it got at least its row's minPayload bytes
+    void HandleReliableAck(const uint8_t* data, int len);
+    void HandleFragment(const uint8_t* data, int len);
+    void HandleHandshakeAccepted(const uint8_t* data, int len);
+    void HandleStateEvent(const uint8_t* data, int len);
+    void HandleCompressed(const uint8_t* data, int len);
     void HandlePlayerConnected(const uint8_t* data, int len);
     void HandlePlayerDisconnected(const uint8_t* data, int len);
     void HandleJiggyCollected(const uint8_t* data, int len);
     void HandleNoteCollected(const uint8_t* data, int len);
+    void HandleNoteCollectedCompact(const uint8_t* data, int len);
     void HandleNoteCollectedPos(const uint8_t* data, int len);
     void HandleNoteSaveData(const uint8_t* data, int len);
     void HandlePuppetUpdate(const uint8_t* data, int len);
+    void HandlePuppetUpdateCompact(const uint8_t* data, int len);
+    void HandlePuppetBaselineAck(const uint8_t* data, int len);
+    void PushPuppetMessage(uint32_t playerId, const PuppetUpdatePacket& pak);
     void HandleLevelOpened(const uint8_t* data, int len);
     void HandleFileProgressFlags(const uint8_t* data, int len);
     void HandleAbilityProgress(const uint8_t* data, int len);
     void HandleHoneycombScore(const uint8_t* data, int len);
     void HandleMumboScore(const uint8_t* data, int len);
+    void PushProgressBlobMessage(PacketType type, uint32_t playerId, const uint8_t* bytes, size_t size);
+    void HandleProgressBits(const uint8_t* data, int len);
+    void HandleStateDigestBuckets(const uint8_t* data, int len);
     void HandleHoneycombCollected(const uint8_t* data, int len);
     void HandleMumboTokenCollected(const uint8_t* data, int len);
+    void HandleHoneycombCollectedCompact(const uint8_t* data, int len);
+    void HandleMumboTokenCollectedCompact(const uint8_t* data, int len);
     void HandlePlayerInfoRequest(const uint8_t* data, int len);
     void HandlePlayerInfoResponse(const uint8_t* data, int len);
     void HandlePlayerListUpdate(const uint8_t* data, int len);
-    void EnqueueEvent(PacketType type, const std::string& text, const std::vector<int32_t>& data, int playerId = -1);
 
 public:
-    NetworkClient();
+    explicit NetworkClient(MessageQueue& messages);
     ~NetworkClient();
     void Configure(const std::string& host, const std::string& user, const std::string& lobby, const std::string& pass);
+    void SetThreaded(bool threaded);
+    bool IsThreaded() const { return m_threaded; }
+    ConnectionState GetConnectionState() const { return m_state.load(std::memory_order_acquire); }
+    bool PopStatus(ConnectionStatus& out) { return m_statusQueue.TryPop(out); }
+    uint32_t GetSendAllocationCount() const { return m_sendAllocations.load(std::memory_order_relaxed); }
     void Update();
-    bool HasEvents();
-    NetEvent PopEvent();
+    void FlushOutgoing();
     void SendJiggy(int jiggyEnumId, int collectedValue);
     void SendNote(int mapId, int levelId, bool isDynamic, int noteIndex);
     void SendNotePos(int mapId, int x, int y, int z);
@@ -90,6 +362,11 @@ public:
     void SendLevelOpened(int worldId, int jiggyCost);
     void SendPuppetUpdate(const PuppetUpdatePacket& packet);
     void RequestFullSync();
+    void BeginStateDigest();
+    void AddStateDigestItem(DigestCategory category, int32_t a, int32_t b);
+    void AddStateDigestBits(DigestCategory category, int32_t a, const std::vector<uint8_t>& bytes);
+    void AddStateDigestBlob(PacketType type, const std::vector<uint8_t>& blob);
+    void SendFullSyncRequest();
     uint32_t GetClockMS();
     
     void SendFileProgressFlags(const std::vector<uint8_t>& flags);
@@ -0,0 +1,323 @@
+#ifndef LIB_PACKET_CODEC_H
+#define LIB_PACKET_CODEC_H
+
+// =========================================================================== //
+// Wire layouts for the structs in lib_packets.h, and the one encoder/decoder
+// that works from them. A layout lists the struct's members in the order they
+// appear on the wire along with the packet's byte order. Sizes, bounds checks
+// and byte swaps are all worked out from that list at compile time, so a
+// packet with no strings or varints is bounds checked once, up front.
+//
+// Adding a packet: declare the struct in lib_packets.h, describe its wire
+// layout in protocol/packets.schema and run protocol/packetgen.py, which
+// writes the PacketLayout specialisations into lib_packet_schema.h.
+// =========================================================================== //
+
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+#include "lib_packets.h"
+#include "lib_packet_writer.h"
+
+enum class WireOrder
+{
+    Big,
+    Little,
+};
+
+inline uint8_t ByteSwap(uint8_t value) { return value; }
+
+inline uint16_t ByteSwap(uint16_t value)
+{
+#if defined(_MSC_VER)
+    return _byteswap_ushort(value);
+#else
+    return __builtin_bswap16(value);
+#endif
+}
+
+inline uint32_t ByteSwap(uint32_t value)
+{
+#if defined(_MSC_VER)
+    return _byteswap_ulong(value);
+#else
+    return __builtin_bswap32(value);
+#endif
+}
+
+inline uint64_t ByteSwap(uint64_t value)
+{
+#if defined(_MSC_VER)
+    return _byteswap_uint64(value);
+#else
+    return __builtin_bswap64(value);
+#endif
+}
+
+template <WireOrder Order>
+constexpr bool WIRE_NEEDS_SWAP = (Order == WireOrder::Big) != (std::endian::native == std::endian::big);
+
+// unaligned load/store of an unsigned integer in the given byte order
+template <WireOrder Order, typename U>
+inline U LoadWire(const uint8_t *src)
+{
+    static_assert(std::is_unsigned_v<U>, "wire loads are unsigned, cast afterwards");
+
+    U value;
+    std::memcpy(&value, src, sizeof(U));
+    if constexpr (WIRE_NEEDS_SWAP<Order>)
+    {
+        value = ByteSwap(value);
+    }
+    return value;
+}
+
+template <WireOrder Order, typename U>
+inline void StoreWire(uint8_t *dst, U value)
+{
+    static_assert(std::is_unsigned_v<U>, "wire stores are unsigned, cast beforehand");
+
+    if constexpr (WIRE_NEEDS_SWAP<Order>)
+    {
+        value = ByteSwap(value);
+    }
+    std::memcpy(dst, &value, sizeof(U));
+}
+
+// reads a PacketWriter::WriteVarU32 value and advances cursor past it.
+// false if it runs off the end or doesn't fit 32 bits
+inline bool ReadVarU32(const uint8_t *&cursor, const uint8_t *end, uint32_t &out)
+{
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35 && cursor < end; shift += 7)
+    {
+        uint8_t byte = *cursor++;
+        if (shift == 28 && byte > 0x0F)
+        {
+            return false;
+        }
+
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            out = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+// wire type for an unsigned LEB128 varint (PacketWriter::WriteVarU32),
+// 1 to 5 bytes. signed members go out as their u32 bits
+struct VarU32
+{
+};
+
+constexpr size_t VAR_U32_MAX_SIZE = 5;
+
+template <typename M>
+struct MemberTraits;
+
+template <typename C, typename T>
+struct MemberTraits<T C::*>
+{
+    using Struct = C;
+    using Type = T;
+};
+
+// One member of a layout, sent as Wire (by default the member's own type).
+// Wire may be any integer up to 64 bits, float, VarU32, or std::string for a
+// u32 length followed by the bytes.
+template <auto Member, typename Wire = typename MemberTraits<decltype(Member)>::Type>
+struct Field
+{
+    using Struct = typename MemberTraits<decltype(Member)>::Struct;
+    using Type = typename MemberTraits<decltype(Member)>::Type;
+
+    static constexpr bool STRING = std::is_same_v<Wire, std::string>;
+    static constexpr bool VARINT = std::is_same_v<Wire, VarU32>;
+    static constexpr bool VARIABLE = STRING || VARINT;
+
+    static_assert(VARIABLE || std::is_same_v<Wire, float> || (std::is_integral_v<Wire> && !std::is_same_v<Wire, bool>),
+                  "unsupported wire type, send bools as uint8_t");
+
+    // bytes always present; strings add their contents on top, varints up
+    // to MAX_SIZE in all
+    static constexpr size_t SIZE = STRING ? 4 : VARINT ? 1 : sizeof(Wire);
+    static constexpr size_t MAX_SIZE = VARINT ? VAR_U32_MAX_SIZE : SIZE;
+
+    using Bits = std::conditional_t<VARIABLE, uint32_t,
+                                    std::conditional_t<SIZE == 1, uint8_t,
+                                                       std::conditional_t<SIZE == 2, uint16_t,
+                                                                          std::conditional_t<SIZE == 4, uint32_t, uint64_t>>>>;
+
+    // Checked is set when an earlier string or varint means the up-front
+    // size check no longer covers this field
+    template <WireOrder Order, bool Checked>
+    static bool Read(const uint8_t *data, size_t len, size_t &pos, Struct &out)
+    {
+        if constexpr (VARINT)
+        {
+            const uint8_t *cursor = data + pos;
+            uint32_t value;
+            if (!ReadVarU32(cursor, data + len, value))
+            {
+                return false;
+            }
+            out.*Member = static_cast<Type>(value);
+            pos = (size_t)(cursor - data);
+            return true;
+        }
+        else
+        {
+            if constexpr (Checked)
+            {
+                if (len - pos < SIZE)
+                {
+                    return false;
+                }
+            }
+
+            Bits bits = LoadWire<Order, Bits>(data + pos);
+            pos += SIZE;
+
+            if constexpr (STRING)
+            {
+                if (len - pos < bits)
+                {
+                    return false;
+                }
+                (out.*Member).assign((const char *)(data + pos), bits);
+                pos += bits;
+            }
+            else if constexpr (std::is_same_v<Wire, float>)
+            {
+                out.*Member = static_cast<Type>(std::bit_cast<float>(bits));
+            }
+            else
+            {
+                out.*Member = static_cast<Type>(static_cast<Wire>(bits));
+            }
+            return true;
+        }
+    }
+
+    template <WireOrder Order>
+    static void Write(uint8_t *dst, const Struct &in)
+    {
+        if constexpr (std::is_same_v<Wire, float>)
+        {
+            StoreWire<Order>(dst, std::bit_cast<Bits>(static_cast<float>(in.*Member)));
+        }
+        else
+        {
+            StoreWire<Order>(dst, static_cast<Bits>(static_cast<Wire>(in.*Member)));
+        }
+    }
+
+    template <WireOrder Order>
+    static void WriteTo(PacketWriter &writer, const Struct &in)
+    {
+        if constexpr (VARINT)
+        {
+            writer.WriteVarU32(static_cast<uint32_t>(in.*Member));
+        }
+        else if constexpr (STRING)
+        {
+            const std::string &value = in.*Member;
+            if (uint8_t *out = writer.Claim(SIZE))
+            {
+                StoreWire<Order>(out, (uint32_t)value.size());
+            }
+            writer.WriteBytes(value.data(), value.size());
+        }
+        else if (uint8_t *out = writer.Claim(SIZE))
+        {
+            Write<Order>(out, in);
+        }
+    }
+};
+
+template <WireOrder Order, typename... Fields>
+struct Layout
+{
+    static constexpr WireOrder ORDER = Order;
+    static constexpr size_t FIXED_SIZE = (Fields::SIZE + ... + 0);
+    static constexpr bool VARIABLE = (Fields::VARIABLE || ...);
+    // without strings a packet never takes more than MAX_SIZE bytes
+    static constexpr bool BOUNDED = !(Fields::STRING || ...);
+    static constexpr size_t MAX_SIZE = (Fields::MAX_SIZE + ... + 0);
+
+    template <typename T>
+    static size_t Decode(const uint8_t *data, size_t len, T &out)
+    {
+        if (len < FIXED_SIZE)
+        {
+            return 0;
+        }
+
+        size_t pos = 0;
+        bool ok = (Fields::template Read<Order, VARIABLE>(data, len, pos, out) && ...);
+        return ok ? pos : 0;
+    }
+
+    template <typename T>
+    static bool Encode(PacketWriter &writer, const T &in)
+    {
+        if constexpr (VARIABLE)
+        {
+            (Fields::template WriteTo<Order>(writer, in), ...);
+        }
+        else if (uint8_t *out = writer.Claim(FIXED_SIZE))
+        {
+            size_t pos = 0;
+            ((Fields::template Write<Order>(out + pos, in), pos += Fields::SIZE), ...);
+        }
+        return writer.Ok();
+    }
+};
+
+template <typename T>
+struct PacketLayout;
+
+// bytes a packet takes on the wire, not counting string contents
+template <typename T>
+constexpr size_t WIRE_SIZE = PacketLayout<T>::FIXED_SIZE;
+
+// Decodes one T from the front of data. Returns the bytes it took up,
+// 0 if data is too short for it (nothing is left half-written but the
+// fields before the one that didn't fit).
+template <typename T>
+inline size_t DecodePacket(const uint8_t *data, size_t len, T &out)
+{
+    return PacketLayout<T>::Decode(data, len, out);
+}
+
+// Appends in to writer. False if it didn't fit (see PacketWriter::Ok)
+template <typename T>
+inline bool EncodePacket(PacketWriter &writer, const T &in)
+{
+    return PacketLayout<T>::Encode(writer, in);
+}
+
+// layouts and views generated from protocol/packets.schema
+#include "lib_packet_schema.h"
+
+static_assert(WIRE_SIZE<HandshakeAcceptedPacket> == HANDSHAKE_ACCEPTED_SIZE);
+static_assert(WIRE_SIZE<PuppetUpdatePacket> == 42);
+static_assert(WIRE_SIZE<PuppetUpdateCompactPacket> == PUPPET_COMPACT_SIZE);
+static_assert(WIRE_SIZE<NotePacket> == 13);
+static_assert(WIRE_SIZE<NotePacketPos> == 10);
+static_assert(WIRE_SIZE<HoneycombCollectedCompactPacket> == COLLECTIBLE_COMPACT_MIN_SIZE);
+static_assert(WIRE_SIZE<BroadcastHoneycombCompact> == 1 + COLLECTIBLE_COMPACT_MIN_SIZE);
+static_assert(WIRE_SIZE<BroadcastNoteCompact> == 1 + NOTE_COMPACT_MIN_SIZE);
+
+#endif
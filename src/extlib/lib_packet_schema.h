@@ -0,0 +1,648 @@
+#ifndef LIB_PACKET_SCHEMA_H
+#define LIB_PACKET_SCHEMA_H
+
+// =========================================================================== //
+// Generated by protocol/packetgen.py from protocol/packets.schema; edit that
+// and rerun the generator instead of changing this file.
+//
+// PacketLayouts for every packet in the schema, and for those made of fixed-size
+// fields a <Packet>View that reads each field straight out of the receive buffer.
+// Check Fits(len) before making one. Included at the bottom of lib_packet_codec.h.
+// =========================================================================== //
+
+template <>
+struct PacketLayout<JiggyPacket> : Layout<WireOrder::Little,
+                                          Field<&JiggyPacket::JiggyEnumId, int32_t>,
+                                          Field<&JiggyPacket::CollectedValue, int32_t>>
+{
+};
+
+template <>
+struct PacketLayout<NotePacket> : Layout<WireOrder::Little,
+                                         Field<&NotePacket::MapId, int32_t>,
+                                         Field<&NotePacket::LevelId, int32_t>,
+                                         Field<&NotePacket::IsDynamic, uint8_t>,
+                                         Field<&NotePacket::NoteIndex, int32_t>>
+{
+};
+
+template <>
+struct PacketLayout<NotePacketCompact> : Layout<WireOrder::Little,
+                                                Field<&NotePacket::MapId, VarU32>,
+                                                Field<&NotePacket::LevelId, VarU32>,
+                                                Field<&NotePacket::IsDynamic, uint8_t>,
+                                                Field<&NotePacket::NoteIndex, VarU32>>
+{
+};
+
+template <>
+struct PacketLayout<NotePacketPos> : Layout<WireOrder::Little,
+                                            Field<&NotePacketPos::MapId, int32_t>,
+                                            Field<&NotePacketPos::X, int16_t>,
+                                            Field<&NotePacketPos::Y, int16_t>,
+                                            Field<&NotePacketPos::Z, int16_t>>
+{
+};
+
+template <>
+struct PacketLayout<LevelOpenedPacket> : Layout<WireOrder::Little,
+                                                Field<&LevelOpenedPacket::WorldId, int32_t>,
+                                                Field<&LevelOpenedPacket::JiggyCost, int32_t>>
+{
+};
+
+template <>
+struct PacketLayout<HoneycombCollectedPacket> : Layout<WireOrder::Little,
+                                                       Field<&HoneycombCollectedPacket::MapId, int32_t>,
+                                                       Field<&HoneycombCollectedPacket::HoneycombId, int32_t>,
+                                                       Field<&HoneycombCollectedPacket::X, int32_t>,
+                                                       Field<&HoneycombCollectedPacket::Y, int32_t>,
+                                                       Field<&HoneycombCollectedPacket::Z, int32_t>>
+{
+};
+
+template <>
+struct PacketLayout<HoneycombCollectedCompactPacket> : Layout<WireOrder::Little,
+                                                              Field<&HoneycombCollectedPacket::MapId, VarU32>,
+                                                              Field<&HoneycombCollectedPacket::HoneycombId, VarU32>,
+                                                              Field<&HoneycombCollectedPacket::X, int16_t>,
+                                                              Field<&HoneycombCollectedPacket::Y, int16_t>,
+                                                              Field<&HoneycombCollectedPacket::Z, int16_t>>
+{
+};
+
+template <>
+struct PacketLayout<MumboTokenCollectedPacket> : Layout<WireOrder::Little,
+                                                        Field<&MumboTokenCollectedPacket::MapId, int32_t>,
+                                                        Field<&MumboTokenCollectedPacket::TokenId, int32_t>,
+                                                        Field<&MumboTokenCollectedPacket::X, int32_t>,
+                                                        Field<&MumboTokenCollectedPacket::Y, int32_t>,
+                                                        Field<&MumboTokenCollectedPacket::Z, int32_t>>
+{
+};
+
+template <>
+struct PacketLayout<MumboTokenCollectedCompactPacket> : Layout<WireOrder::Little,
+                                                               Field<&MumboTokenCollectedPacket::MapId, VarU32>,
+                                                               Field<&MumboTokenCollectedPacket::TokenId, VarU32>,
+                                                               Field<&MumboTokenCollectedPacket::X, int16_t>,
+                                                               Field<&MumboTokenCollectedPacket::Y, int16_t>,
+                                                               Field<&MumboTokenCollectedPacket::Z, int16_t>>
+{
+};
+
+template <>
+struct PacketLayout<LoginPacket> : Layout<WireOrder::Big,
+                                          Field<&LoginPacket::LobbyName, std::string>,
+                                          Field<&LoginPacket::Password, std::string>,
+                                          Field<&LoginPacket::Username, std::string>>
+{
+};
+
+template <>
+struct PacketLayout<HandshakeAcceptedPacket> : Layout<WireOrder::Big,
+                                                      Field<&HandshakeAcceptedPacket::player_id, uint32_t>,
+                                                      Field<&HandshakeAcceptedPacket::session_token, uint64_t>,
+                                                      Field<&HandshakeAcceptedPacket::state_seq, uint32_t>,
+                                                      Field<&HandshakeAcceptedPacket::resumed, uint8_t>>
+{
+};
+
+// level and map go out in the opposite order to the struct
+template <>
+struct PacketLayout<PuppetUpdatePacket> : Layout<WireOrder::Big,
+                                                 Field<&PuppetUpdatePacket::x, float>,
+                                                 Field<&PuppetUpdatePacket::y, float>,
+                                                 Field<&PuppetUpdatePacket::z, float>,
+                                                 Field<&PuppetUpdatePacket::yaw, float>,
+                                                 Field<&PuppetUpdatePacket::pitch, float>,
+                                                 Field<&PuppetUpdatePacket::roll, float>,
+                                                 Field<&PuppetUpdatePacket::anim_duration, float>,
+                                                 Field<&PuppetUpdatePacket::anim_timer, float>,
+                                                 Field<&PuppetUpdatePacket::level_id, int16_t>,
+                                                 Field<&PuppetUpdatePacket::map_id, int16_t>,
+                                                 Field<&PuppetUpdatePacket::anim_id, int16_t>,
+                                                 Field<&PuppetUpdatePacket::model_id, uint8_t>,
+                                                 Field<&PuppetUpdatePacket::flags, uint8_t>,
+                                                 Field<&PuppetUpdatePacket::playback_type, uint8_t>,
+                                                 Field<&PuppetUpdatePacket::playback_direction, uint8_t>>
+{
+};
+
+template <>
+struct PacketLayout<PuppetUpdateCompactPacket> : Layout<WireOrder::Big,
+                                                        Field<&PuppetUpdateCompactPacket::x, int16_t>,
+                                                        Field<&PuppetUpdateCompactPacket::y, int16_t>,
+                                                        Field<&PuppetUpdateCompactPacket::z, int16_t>,
+                                                        Field<&PuppetUpdateCompactPacket::yaw, uint16_t>,
+                                                        Field<&PuppetUpdateCompactPacket::anim_duration_ms, uint16_t>,
+                                                        Field<&PuppetUpdateCompactPacket::anim_timer, uint16_t>,
+                                                        Field<&PuppetUpdateCompactPacket::level_id, uint8_t>,
+                                                        Field<&PuppetUpdateCompactPacket::map_id, uint8_t>,
+                                                        Field<&PuppetUpdateCompactPacket::anim_id, uint16_t>,
+                                                        Field<&PuppetUpdateCompactPacket::model_id, uint8_t>,
+                                                        Field<&PuppetUpdateCompactPacket::flags, uint8_t>,
+                                                        Field<&PuppetUpdateCompactPacket::playback_type, uint8_t>,
+                                                        Field<&PuppetUpdateCompactPacket::playback_direction, uint8_t>>
+{
+};
+
+template <>
+struct PacketLayout<BroadcastJiggy> : Layout<WireOrder::Big,
+                                             Field<&BroadcastJiggy::player_id, uint32_t>,
+                                             Field<&BroadcastJiggy::jiggy_enum_id, int32_t>,
+                                             Field<&BroadcastJiggy::collected_value, int32_t>>
+{
+};
+
+template <>
+struct PacketLayout<BroadcastNote> : Layout<WireOrder::Big,
+                                            Field<&BroadcastNote::player_id, uint32_t>,
+                                            Field<&BroadcastNote::map_id, int32_t>,
+                                            Field<&BroadcastNote::level_id, int32_t>,
+                                            Field<&BroadcastNote::is_dynamic, int32_t>,
+                                            Field<&BroadcastNote::note_index, int32_t>>
+{
+};
+
+template <>
+struct PacketLayout<BroadcastNoteCompact> : Layout<WireOrder::Big,
+                                                   Field<&BroadcastNote::player_id, VarU32>,
+                                                   Field<&BroadcastNote::map_id, VarU32>,
+                                                   Field<&BroadcastNote::level_id, VarU32>,
+                                                   Field<&BroadcastNote::is_dynamic, uint8_t>,
+                                                   Field<&BroadcastNote::note_index, VarU32>>
+{
+};
+
+template <>
+struct PacketLayout<BroadcastNotePos> : Layout<WireOrder::Big,
+                                               Field<&BroadcastNotePos::player_id, uint32_t>,
+                                               Field<&BroadcastNotePos::map_id, int32_t>,
+                                               Field<&BroadcastNotePos::x, int32_t>,
+                                               Field<&BroadcastNotePos::y, int32_t>,
+                                               Field<&BroadcastNotePos::z, int32_t>>
+{
+};
+
+template <>
+struct PacketLayout<BroadcastLevelOpened> : Layout<WireOrder::Big,
+                                                   Field<&BroadcastLevelOpened::player_id, uint32_t>,
+                                                   Field<&BroadcastLevelOpened::world_id, int32_t>,
+                                                   Field<&BroadcastLevelOpened::jiggy_cost, int32_t>>
+{
+};
+
+template <>
+struct PacketLayout<BroadcastHoneycomb> : Layout<WireOrder::Big,
+                                                 Field<&BroadcastHoneycomb::player_id, uint32_t>,
+                                                 Field<&BroadcastHoneycomb::map_id, int32_t>,
+                                                 Field<&BroadcastHoneycomb::honeycomb_id, int32_t>,
+                                                 Field<&BroadcastHoneycomb::x, int32_t>,
+                                                 Field<&BroadcastHoneycomb::y, int32_t>,
+                                                 Field<&BroadcastHoneycomb::z, int32_t>>
+{
+};
+
+template <>
+struct PacketLayout<BroadcastHoneycombCompact> : Layout<WireOrder::Big,
+                                                        Field<&BroadcastHoneycomb::player_id, VarU32>,
+                                                        Field<&BroadcastHoneycomb::map_id, VarU32>,
+                                                        Field<&BroadcastHoneycomb::honeycomb_id, VarU32>,
+                                                        Field<&BroadcastHoneycomb::x, int16_t>,
+                                                        Field<&BroadcastHoneycomb::y, int16_t>,
+                                                        Field<&BroadcastHoneycomb::z, int16_t>>
+{
+};
+
+template <>
+struct PacketLayout<BroadcastMumboToken> : Layout<WireOrder::Big,
+                                                  Field<&BroadcastMumboToken::player_id, uint32_t>,
+                                                  Field<&BroadcastMumboToken::map_id, int32_t>,
+                                                  Field<&BroadcastMumboToken::token_id, int32_t>,
+                                                  Field<&BroadcastMumboToken::x, int32_t>,
+                                                  Field<&BroadcastMumboToken::y, int32_t>,
+                                                  Field<&BroadcastMumboToken::z, int32_t>>
+{
+};
+
+template <>
+struct PacketLayout<BroadcastMumboTokenCompact> : Layout<WireOrder::Big,
+                                                         Field<&BroadcastMumboToken::player_id, VarU32>,
+                                                         Field<&BroadcastMumboToken::map_id, VarU32>,
+                                                         Field<&BroadcastMumboToken::token_id, VarU32>,
+                                                         Field<&BroadcastMumboToken::x, int16_t>,
+                                                         Field<&BroadcastMumboToken::y, int16_t>,
+                                                         Field<&BroadcastMumboToken::z, int16_t>>
+{
+};
+
+template <>
+struct PacketLayout<PlayerConnectedBroadcast> : Layout<WireOrder::Big,
+                                                       Field<&PlayerConnectedBroadcast::player_id, uint32_t>,
+                                                       Field<&PlayerConnectedBroadcast::username, std::string>>
+{
+};
+
+template <>
+struct PacketLayout<PlayerDisconnectedBroadcast> : Layout<WireOrder::Big,
+                                                          Field<&PlayerDisconnectedBroadcast::player_id, uint32_t>,
+                                                          Field<&PlayerDisconnectedBroadcast::username, std::string>>
+{
+};
+
+template <>
+struct PacketLayout<PlayerInfoRequestPacket> : Layout<WireOrder::Big,
+                                                      Field<&PlayerInfoRequestPacket::target_player_id, uint32_t>,
+                                                      Field<&PlayerInfoRequestPacket::requester_player_id, uint32_t>>
+{
+};
+
+template <>
+struct PacketLayout<PlayerInfoResponsePacket> : Layout<WireOrder::Big,
+                                                       Field<&PlayerInfoResponsePacket::target_player_id, uint32_t>,
+                                                       Field<&PlayerInfoResponsePacket::map_id, int16_t>,
+                                                       Field<&PlayerInfoResponsePacket::level_id, int16_t>,
+                                                       Field<&PlayerInfoResponsePacket::x, float>,
+                                                       Field<&PlayerInfoResponsePacket::y, float>,
+                                                       Field<&PlayerInfoResponsePacket::z, float>,
+                                                       Field<&PlayerInfoResponsePacket::yaw, float>>
+{
+};
+
+// PlayerListUpdate is a u32 BE count followed by this many times over
+template <>
+struct PacketLayout<PlayerListEntryPacket> : Layout<WireOrder::Big,
+                                                    Field<&PlayerListEntryPacket::player_id, uint32_t>,
+                                                    Field<&PlayerListEntryPacket::username, std::string>>
+{
+};
+
+// =========================================================================== //
+// Views
+// =========================================================================== //
+
+class JiggyPacketView
+{
+public:
+    static constexpr size_t SIZE = 8;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit JiggyPacketView(const uint8_t *data) : m_data(data) {}
+
+    int32_t JiggyEnumId() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 0)); }
+    int32_t CollectedValue() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 4)); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(JiggyPacketView::SIZE == WIRE_SIZE<JiggyPacket>);
+
+class NotePacketView
+{
+public:
+    static constexpr size_t SIZE = 13;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit NotePacketView(const uint8_t *data) : m_data(data) {}
+
+    int32_t MapId() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 0)); }
+    int32_t LevelId() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 4)); }
+    uint8_t IsDynamic() const { return LoadWire<WireOrder::Little, uint8_t>(m_data + 8); }
+    int32_t NoteIndex() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 9)); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(NotePacketView::SIZE == WIRE_SIZE<NotePacket>);
+
+class NotePacketPosView
+{
+public:
+    static constexpr size_t SIZE = 10;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit NotePacketPosView(const uint8_t *data) : m_data(data) {}
+
+    int32_t MapId() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 0)); }
+    int16_t X() const { return static_cast<int16_t>(LoadWire<WireOrder::Little, uint16_t>(m_data + 4)); }
+    int16_t Y() const { return static_cast<int16_t>(LoadWire<WireOrder::Little, uint16_t>(m_data + 6)); }
+    int16_t Z() const { return static_cast<int16_t>(LoadWire<WireOrder::Little, uint16_t>(m_data + 8)); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(NotePacketPosView::SIZE == WIRE_SIZE<NotePacketPos>);
+
+class LevelOpenedPacketView
+{
+public:
+    static constexpr size_t SIZE = 8;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit LevelOpenedPacketView(const uint8_t *data) : m_data(data) {}
+
+    int32_t WorldId() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 0)); }
+    int32_t JiggyCost() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 4)); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(LevelOpenedPacketView::SIZE == WIRE_SIZE<LevelOpenedPacket>);
+
+class HoneycombCollectedPacketView
+{
+public:
+    static constexpr size_t SIZE = 20;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit HoneycombCollectedPacketView(const uint8_t *data) : m_data(data) {}
+
+    int32_t MapId() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 0)); }
+    int32_t HoneycombId() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 4)); }
+    int32_t X() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 8)); }
+    int32_t Y() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 12)); }
+    int32_t Z() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 16)); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(HoneycombCollectedPacketView::SIZE == WIRE_SIZE<HoneycombCollectedPacket>);
+
+class MumboTokenCollectedPacketView
+{
+public:
+    static constexpr size_t SIZE = 20;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit MumboTokenCollectedPacketView(const uint8_t *data) : m_data(data) {}
+
+    int32_t MapId() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 0)); }
+    int32_t TokenId() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 4)); }
+    int32_t X() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 8)); }
+    int32_t Y() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 12)); }
+    int32_t Z() const { return static_cast<int32_t>(LoadWire<WireOrder::Little, uint32_t>(m_data + 16)); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(MumboTokenCollectedPacketView::SIZE == WIRE_SIZE<MumboTokenCollectedPacket>);
+
+class HandshakeAcceptedPacketView
+{
+public:
+    static constexpr size_t SIZE = 17;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit HandshakeAcceptedPacketView(const uint8_t *data) : m_data(data) {}
+
+    uint32_t player_id() const { return LoadWire<WireOrder::Big, uint32_t>(m_data + 0); }
+    uint64_t session_token() const { return LoadWire<WireOrder::Big, uint64_t>(m_data + 4); }
+    uint32_t state_seq() const { return LoadWire<WireOrder::Big, uint32_t>(m_data + 12); }
+    uint8_t resumed() const { return LoadWire<WireOrder::Big, uint8_t>(m_data + 16); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(HandshakeAcceptedPacketView::SIZE == WIRE_SIZE<HandshakeAcceptedPacket>);
+
+class PuppetUpdatePacketView
+{
+public:
+    static constexpr size_t SIZE = 42;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit PuppetUpdatePacketView(const uint8_t *data) : m_data(data) {}
+
+    float x() const { return std::bit_cast<float>(LoadWire<WireOrder::Big, uint32_t>(m_data + 0)); }
+    float y() const { return std::bit_cast<float>(LoadWire<WireOrder::Big, uint32_t>(m_data + 4)); }
+    float z() const { return std::bit_cast<float>(LoadWire<WireOrder::Big, uint32_t>(m_data + 8)); }
+    float yaw() const { return std::bit_cast<float>(LoadWire<WireOrder::Big, uint32_t>(m_data + 12)); }
+    float pitch() const { return std::bit_cast<float>(LoadWire<WireOrder::Big, uint32_t>(m_data + 16)); }
+    float roll() const { return std::bit_cast<float>(LoadWire<WireOrder::Big, uint32_t>(m_data + 20)); }
+    float anim_duration() const { return std::bit_cast<float>(LoadWire<WireOrder::Big, uint32_t>(m_data + 24)); }
+    float anim_timer() const { return std::bit_cast<float>(LoadWire<WireOrder::Big, uint32_t>(m_data + 28)); }
+    int16_t level_id() const { return static_cast<int16_t>(LoadWire<WireOrder::Big, uint16_t>(m_data + 32)); }
+    int16_t map_id() const { return static_cast<int16_t>(LoadWire<WireOrder::Big, uint16_t>(m_data + 34)); }
+    int16_t anim_id() const { return static_cast<int16_t>(LoadWire<WireOrder::Big, uint16_t>(m_data + 36)); }
+    uint8_t model_id() const { return LoadWire<WireOrder::Big, uint8_t>(m_data + 38); }
+    uint8_t flags() const { return LoadWire<WireOrder::Big, uint8_t>(m_data + 39); }
+    uint8_t playback_type() const { return LoadWire<WireOrder::Big, uint8_t>(m_data + 40); }
+    uint8_t playback_direction() const { return LoadWire<WireOrder::Big, uint8_t>(m_data + 41); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(PuppetUpdatePacketView::SIZE == WIRE_SIZE<PuppetUpdatePacket>);
+
+class PuppetUpdateCompactPacketView
+{
+public:
+    static constexpr size_t SIZE = 20;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit PuppetUpdateCompactPacketView(const uint8_t *data) : m_data(data) {}
+
+    int16_t x() const { return static_cast<int16_t>(LoadWire<WireOrder::Big, uint16_t>(m_data + 0)); }
+    int16_t y() const { return static_cast<int16_t>(LoadWire<WireOrder::Big, uint16_t>(m_data + 2)); }
+    int16_t z() const { return static_cast<int16_t>(LoadWire<WireOrder::Big, uint16_t>(m_data + 4)); }
+    uint16_t yaw() const { return LoadWire<WireOrder::Big, uint16_t>(m_data + 6); }
+    uint16_t anim_duration_ms() const { return LoadWire<WireOrder::Big, uint16_t>(m_data + 8); }
+    uint16_t anim_timer() const { return LoadWire<WireOrder::Big, uint16_t>(m_data + 10); }
+    uint8_t level_id() const { return LoadWire<WireOrder::Big, uint8_t>(m_data + 12); }
+    uint8_t map_id() const { return LoadWire<WireOrder::Big, uint8_t>(m_data + 13); }
+    uint16_t anim_id() const { return LoadWire<WireOrder::Big, uint16_t>(m_data + 14); }
+    uint8_t model_id() const { return LoadWire<WireOrder::Big, uint8_t>(m_data + 16); }
+    uint8_t flags() const { return LoadWire<WireOrder::Big, uint8_t>(m_data + 17); }
+    uint8_t playback_type() const { return LoadWire<WireOrder::Big, uint8_t>(m_data + 18); }
+    uint8_t playback_direction() const { return LoadWire<WireOrder::Big, uint8_t>(m_data + 19); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(PuppetUpdateCompactPacketView::SIZE == WIRE_SIZE<PuppetUpdateCompactPacket>);
+
+class BroadcastJiggyView
+{
+public:
+    static constexpr size_t SIZE = 12;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit BroadcastJiggyView(const uint8_t *data) : m_data(data) {}
+
+    uint32_t player_id() const { return LoadWire<WireOrder::Big, uint32_t>(m_data + 0); }
+    int32_t jiggy_enum_id() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 4)); }
+    int32_t collected_value() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 8)); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(BroadcastJiggyView::SIZE == WIRE_SIZE<BroadcastJiggy>);
+
+class BroadcastNoteView
+{
+public:
+    static constexpr size_t SIZE = 20;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit BroadcastNoteView(const uint8_t *data) : m_data(data) {}
+
+    uint32_t player_id() const { return LoadWire<WireOrder::Big, uint32_t>(m_data + 0); }
+    int32_t map_id() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 4)); }
+    int32_t level_id() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 8)); }
+    int32_t is_dynamic() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 12)); }
+    int32_t note_index() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 16)); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(BroadcastNoteView::SIZE == WIRE_SIZE<BroadcastNote>);
+
+class BroadcastNotePosView
+{
+public:
+    static constexpr size_t SIZE = 20;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit BroadcastNotePosView(const uint8_t *data) : m_data(data) {}
+
+    uint32_t player_id() const { return LoadWire<WireOrder::Big, uint32_t>(m_data + 0); }
+    int32_t map_id() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 4)); }
+    int32_t x() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 8)); }
+    int32_t y() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 12)); }
+    int32_t z() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 16)); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(BroadcastNotePosView::SIZE == WIRE_SIZE<BroadcastNotePos>);
+
+class BroadcastLevelOpenedView
+{
+public:
+    static constexpr size_t SIZE = 12;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit BroadcastLevelOpenedView(const uint8_t *data) : m_data(data) {}
+
+    uint32_t player_id() const { return LoadWire<WireOrder::Big, uint32_t>(m_data + 0); }
+    int32_t world_id() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 4)); }
+    int32_t jiggy_cost() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 8)); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(BroadcastLevelOpenedView::SIZE == WIRE_SIZE<BroadcastLevelOpened>);
+
+class BroadcastHoneycombView
+{
+public:
+    static constexpr size_t SIZE = 24;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit BroadcastHoneycombView(const uint8_t *data) : m_data(data) {}
+
+    uint32_t player_id() const { return LoadWire<WireOrder::Big, uint32_t>(m_data + 0); }
+    int32_t map_id() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 4)); }
+    int32_t honeycomb_id() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 8)); }
+    int32_t x() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 12)); }
+    int32_t y() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 16)); }
+    int32_t z() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 20)); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(BroadcastHoneycombView::SIZE == WIRE_SIZE<BroadcastHoneycomb>);
+
+class BroadcastMumboTokenView
+{
+public:
+    static constexpr size_t SIZE = 24;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit BroadcastMumboTokenView(const uint8_t *data) : m_data(data) {}
+
+    uint32_t player_id() const { return LoadWire<WireOrder::Big, uint32_t>(m_data + 0); }
+    int32_t map_id() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 4)); }
+    int32_t token_id() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 8)); }
+    int32_t x() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 12)); }
+    int32_t y() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 16)); }
+    int32_t z() const { return static_cast<int32_t>(LoadWire<WireOrder::Big, uint32_t>(m_data + 20)); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(BroadcastMumboTokenView::SIZE == WIRE_SIZE<BroadcastMumboToken>);
+
+class PlayerInfoRequestPacketView
+{
+public:
+    static constexpr size_t SIZE = 8;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit PlayerInfoRequestPacketView(const uint8_t *data) : m_data(data) {}
+
+    uint32_t target_player_id() const { return LoadWire<WireOrder::Big, uint32_t>(m_data + 0); }
+    uint32_t requester_player_id() const { return LoadWire<WireOrder::Big, uint32_t>(m_data + 4); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(PlayerInfoRequestPacketView::SIZE == WIRE_SIZE<PlayerInfoRequestPacket>);
+
+class PlayerInfoResponsePacketView
+{
+public:
+    static constexpr size_t SIZE = 24;
+
+    static bool Fits(size_t len) { return len >= SIZE; }
+
+    explicit PlayerInfoResponsePacketView(const uint8_t *data) : m_data(data) {}
+
+    uint32_t target_player_id() const { return LoadWire<WireOrder::Big, uint32_t>(m_data + 0); }
+    int16_t map_id() const { return static_cast<int16_t>(LoadWire<WireOrder::Big, uint16_t>(m_data + 4)); }
+    int16_t level_id() const { return static_cast<int16_t>(LoadWire<WireOrder::Big, uint16_t>(m_data + 6)); }
+    float x() const { return std::bit_cast<float>(LoadWire<WireOrder::Big, uint32_t>(m_data + 8)); }
+    float y() const { return std::bit_cast<float>(LoadWire<WireOrder::Big, uint32_t>(m_data + 12)); }
+    float z() const { return std::bit_cast<float>(LoadWire<WireOrder::Big, uint32_t>(m_data + 16)); }
+    float yaw() const { return std::bit_cast<float>(LoadWire<WireOrder::Big, uint32_t>(m_data + 20)); }
+
+private:
+    const uint8_t *m_data;
+};
+
+static_assert(PlayerInfoResponsePacketView::SIZE == WIRE_SIZE<PlayerInfoResponsePacket>);
+
+#endif
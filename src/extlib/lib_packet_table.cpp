@@ -0,0 +1,115 @@
+#include "lib_packet_table.h"
+#include "lib_net.h"
+
+#include <array>
+
+// friend of NetworkClient so the rows can point at its private handlers
+struct PacketTable
+{
+    static constexpr PacketDescriptor ROWS[] = {
+        // type                              reliable  min  handler                                     message
+        {PacketType::Handshake,              false,    0,   nullptr,                                    MessageType::NONE},
+        {PacketType::PlayerConnected,        false,    8,   &NetworkClient::HandlePlayerConnected,      MessageType::PLAYER_CONNECTED},
+        {PacketType::PlayerDisconnected,     false,    8,   &NetworkClient::HandlePlayerDisconnected,   MessageType::PLAYER_DISCONNECTED},
+        {PacketType::Ping,                   false,    0,   nullptr,                                    MessageType::NONE},
+        {PacketType::Pong,                   false,    0,   nullptr,                                    MessageType::NONE},
+        {PacketType::HandshakeAccepted,      true,     HANDSHAKE_ACCEPTED_SIZE,
+                                                            &NetworkClient::HandleHandshakeAccepted,    MessageType::NONE},
+        {PacketType::StateDigestBuckets,     true,     1 + STATE_DIGEST_BUCKETS * STATE_DIGEST_SIZE,
+                                                            &NetworkClient::HandleStateDigestBuckets,   MessageType::NONE},
+        {PacketType::FullSyncBucketsRequest, true,     0,   nullptr,                                    MessageType::NONE},
+        // the game hashes what it has applied before we send one (RequestFullSync)
+        {PacketType::FullSyncRequest,        true,     0,   nullptr,                                    MessageType::STATE_DIGEST_REQUEST},
+        {PacketType::NoteSaveData,           true,     0,   &NetworkClient::HandleNoteSaveData,         MessageType::NOTE_SAVE_DATA},
+        {PacketType::InitialSaveDataRequest, false,    0,   nullptr,                                    MessageType::INITIAL_SAVE_DATA_REQUEST},
+        {PacketType::FileProgressFlags,      true,     4,   &NetworkClient::HandleFileProgressFlags,    MessageType::FILE_PROGRESS_FLAGS},
+        {PacketType::AbilityProgress,        true,     4,   &NetworkClient::HandleAbilityProgress,      MessageType::ABILITY_PROGRESS},
+        {PacketType::HoneycombScore,         true,     4,   &NetworkClient::HandleHoneycombScore,       MessageType::HONEYCOMB_SCORE},
+        {PacketType::MumboScore,             true,     4,   &NetworkClient::HandleMumboScore,           MessageType::MUMBO_SCORE},
+        {PacketType::HoneycombCollected,     true,     24,  &NetworkClient::HandleHoneycombCollected,   MessageType::HONEYCOMB_COLLECTED},
+        {PacketType::MumboTokenCollected,    true,     24,  &NetworkClient::HandleMumboTokenCollected,  MessageType::MUMBO_TOKEN_COLLECTED},
+        {PacketType::HoneycombCollectedCompact, true,  1 + COLLECTIBLE_COMPACT_MIN_SIZE,
+                                                            &NetworkClient::HandleHoneycombCollectedCompact, MessageType::NONE},
+        {PacketType::MumboTokenCollectedCompact, true, 1 + COLLECTIBLE_COMPACT_MIN_SIZE,
+                                                            &NetworkClient::HandleMumboTokenCollectedCompact, MessageType::NONE},
+        // inner type + unpacked size + at least one control byte; handed on as the inner packet
+        {PacketType::Compressed,             true,     COMPRESSED_HEADER_MIN_SIZE + 1,
+                                                            &NetworkClient::HandleCompressed,           MessageType::NONE},
+        // player id (4) + blob type + at least one bit; handed on as the blob's own event
+        {PacketType::ProgressBits,           true,     4 + PROGRESS_BITS_HEADER_SIZE + 1,
+                                                            &NetworkClient::HandleProgressBits,         MessageType::NONE},
+        // player id (4) + 42 byte puppet state
+        {PacketType::PuppetUpdate,           false,    46,  &NetworkClient::HandlePuppetUpdate,         MessageType::PUPPET_UPDATE},
+        {PacketType::PuppetSyncRequest,      false,    0,   nullptr,                                    MessageType::NONE},
+        {PacketType::PuppetUpdateAck,        false,    0,   nullptr,                                    MessageType::NONE},
+        // player id (4) + header + a keyframe or a delta, the shortest being an empty delta
+        {PacketType::PuppetUpdateCompact,    false,    4 + PUPPET_COMPACT_HEADER_SIZE + PUPPET_DELTA_MASK_SIZE,
+                                                            &NetworkClient::HandlePuppetUpdateCompact,  MessageType::PUPPET_UPDATE},
+        {PacketType::PuppetUpdateCompactAck, false,    0,   nullptr,                                    MessageType::NONE},
+        {PacketType::PuppetBaselineAck,      false,    1,   &NetworkClient::HandlePuppetBaselineAck,    MessageType::NONE},
+        {PacketType::PlayerPosition,         false,    0,   nullptr,                                    MessageType::NONE},
+        {PacketType::JiggyCollected,         true,     12,  &NetworkClient::HandleJiggyCollected,       MessageType::JIGGY_COLLECTED},
+        {PacketType::NoteCollected,          true,     20,  &NetworkClient::HandleNoteCollected,        MessageType::NOTE_COLLECTED},
+        {PacketType::NoteCollectedCompact,   true,     1 + NOTE_COMPACT_MIN_SIZE,
+                                                            &NetworkClient::HandleNoteCollectedCompact, MessageType::NONE},
+        {PacketType::NoteCollectedPos,       true,     20,  &NetworkClient::HandleNoteCollectedPos,     MessageType::NONE},
+        {PacketType::LevelOpened,            true,     12,  &NetworkClient::HandleLevelOpened,          MessageType::LEVEL_OPENED},
+        {PacketType::PlayerInfoRequest,      false,    8,   &NetworkClient::HandlePlayerInfoRequest,    MessageType::PLAYER_INFO_REQUEST},
+        {PacketType::PlayerInfoResponse,     false,    24,  &NetworkClient::HandlePlayerInfoResponse,   MessageType::PLAYER_INFO_RESPONSE},
+        {PacketType::PlayerListUpdate,       false,    4,   &NetworkClient::HandlePlayerListUpdate,     MessageType::PLAYER_LIST_UPDATE},
+        {PacketType::ReliableAck,            false,    4,   &NetworkClient::HandleReliableAck,          MessageType::NONE},
+        {PacketType::ReliableAckBatch,       false,    0,   nullptr,                                    MessageType::NONE},
+        // unpacked before dispatch, never reaches the table lookup
+        {PacketType::Bundle,                 false,    0,   nullptr,                                    MessageType::NONE},
+        {PacketType::Fragment,               true,     FRAGMENT_HEADER_SIZE + 1,
+                                                            &NetworkClient::HandleFragment,             MessageType::NONE},
+        {PacketType::StateEvent,             true,     STATE_EVENT_HEADER_SIZE + 1,
+                                                            &NetworkClient::HandleStateEvent,           MessageType::NONE},
+    };
+
+    // rows spread out by type byte. type 0 is unused, so a zeroed slot means unknown
+    static constexpr std::array<PacketDescriptor, 256> Build()
+    {
+        std::array<PacketDescriptor, 256> table{};
+        for (const PacketDescriptor &row : ROWS)
+        {
+            table[static_cast<uint8_t>(row.type)] = row;
+        }
+        return table;
+    }
+
+    static constexpr bool RowsAreUnique()
+    {
+        for (size_t i = 0; i < std::size(ROWS); i++)
+        {
+            for (size_t j = i + 1; j < std::size(ROWS); j++)
+            {
+                if (ROWS[i].type == ROWS[j].type)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+static_assert(PacketTable::RowsAreUnique(), "duplicate row in the packet table");
+
+static constexpr std::array<PacketDescriptor, 256> PACKETS_BY_TYPE = PacketTable::Build();
+
+const PacketDescriptor *FindPacketDescriptor(PacketType type)
+{
+    const PacketDescriptor &desc = PACKETS_BY_TYPE[static_cast<uint8_t>(type)];
+    return desc.type == type ? &desc : nullptr;
+}
+
+bool IsReliablePacketType(PacketType type)
+{
+    return PACKETS_BY_TYPE[static_cast<uint8_t>(type)].reliable;
+}
+
+MessageType PacketTypeToMessageType(PacketType type)
+{
+    return PACKETS_BY_TYPE[static_cast<uint8_t>(type)].messageType;
+}
@@ -0,0 +1,38 @@
+#ifndef LIB_PACKET_TABLE_H
+#define LIB_PACKET_TABLE_H
+
+// =========================================================================== //
+// Everything the client knows about each packet type, in one place.
+// Adding a packet type means adding one row to PacketTable::ROWS in
+// lib_packet_table.cpp (and the matching entry in the server's protocol.rs).
+// =========================================================================== //
+
+#include <cstdint>
+
+#include "lib_packets.h"
+#include "lib_message_queue.h"
+
+class NetworkClient;
+
+using PacketHandler = void (NetworkClient::*)(const uint8_t *data, int len);
+
+struct PacketDescriptor
+{
+    PacketType type;
+    // carries a 4-byte LE sequence after the type byte and must be acked
+    bool reliable;
+    // payload bytes required (after the reliable seq) before the handler runs
+    uint16_t minPayload;
+    // decodes the payload into events, nullptr if there's nothing to decode
+    PacketHandler handler;
+    // what the game sees for events of this type
+    MessageType messageType;
+};
+
+// O(1) lookup by type byte. nullptr for types we don't know about
+const PacketDescriptor *FindPacketDescriptor(PacketType type);
+
+bool IsReliablePacketType(PacketType type);
+MessageType PacketTypeToMessageType(PacketType type);
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef LIB_PACKET_WRITER_H
+#define LIB_PACKET_WRITER_H
+
+// =========================================================================== //
+// Serializes packet fields straight into a caller-owned buffer.
+// Never allocates: a write that doesn't fit marks the writer as overflowed
+// and is dropped, so check Ok() before sending what was written.
+// =========================================================================== //
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+class PacketWriter
+{
+private:
+    uint8_t *m_data;
+    size_t m_capacity;
+    size_t m_size;
+    bool m_overflow;
+
+public:
+    PacketWriter(uint8_t *buffer, size_t capacity)
+        : m_data(buffer), m_capacity(capacity), m_size(0), m_overflow(false)
+    {
+    }
+
+    // reserves count bytes for the caller to fill in, nullptr if they don't fit
+    uint8_t *Claim(size_t count)
+    {
+        if (m_overflow || count > m_capacity - m_size)
+        {
+            m_overflow = true;
+            return nullptr;
+        }
+
+        uint8_t *out = m_data + m_size;
+        m_size += count;
+        return out;
+    }
+
+    void WriteU8(uint8_t value)
+    {
+        if (uint8_t *out = Claim(1))
+        {
+            out[0] = value;
+        }
+    }
+
+    void WriteU16BE(uint16_t value)
+    {
+        if (uint8_t *out = Claim(2))
+        {
+            out[0] = (value >> 8) & 0xFF;
+            out[1] = value & 0xFF;
+        }
+    }
+
+    void WriteU32BE(uint32_t value)
+    {
+        if (uint8_t *out = Claim(4))
+        {
+            out[0] = (value >> 24) & 0xFF;
+            out[1] = (value >> 16) & 0xFF;
+            out[2] = (value >> 8) & 0xFF;
+            out[3] = value & 0xFF;
+        }
+    }
+
+    void WriteU64BE(uint64_t value)
+    {
+        WriteU32BE((uint32_t)(value >> 32));
+        WriteU32BE((uint32_t)value);
+    }
+
+    void WriteFloatBE(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        WriteU32BE(bits);
+    }
+
+    void WriteU16LE(uint16_t value)
+    {
+        if (uint8_t *out = Claim(2))
+        {
+            out[0] = value & 0xFF;
+            out[1] = (value >> 8) & 0xFF;
+        }
+    }
+
+    void WriteU32LE(uint32_t value)
+    {
+        if (uint8_t *out = Claim(4))
+        {
+            out[0] = value & 0xFF;
+            out[1] = (value >> 8) & 0xFF;
+            out[2] = (value >> 16) & 0xFF;
+            out[3] = (value >> 24) & 0xFF;
+        }
+    }
+
+    void WriteU64LE(uint64_t value)
+    {
+        WriteU32LE((uint32_t)value);
+        WriteU32LE((uint32_t)(value >> 32));
+    }
+
+    void WriteI32LE(int32_t value)
+    {
+        WriteU32LE((uint32_t)value);
+    }
+
+    void WriteBytes(const void *data, size_t count)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        if (uint8_t *out = Claim(count))
+        {
+            std::memcpy(out, data, count);
+        }
+    }
+
+    // LEB128: 7 bits a byte, low bits first, top bit set while more follow
+    void WriteVarU32(uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            WriteU8((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        WriteU8((uint8_t)value);
+    }
+
+    // length-prefixed (u32 BE) string, as used by the handshake
+    void WriteString32BE(const std::string &value)
+    {
+        WriteU32BE((uint32_t)value.size());
+        WriteBytes(value.data(), value.size());
+    }
+
+    bool Ok() const { return !m_overflow; }
+    size_t Size() const { return m_size; }
+    const uint8_t *Data() const { return m_data; }
+};
+
+#endif
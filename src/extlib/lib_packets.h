@@ -12,6 +12,9 @@ enum class PacketType : uint8_t
     PlayerDisconnected = 4,
     Ping = 5,
     Pong = 6,
+    HandshakeAccepted = 7,
+    StateDigestBuckets = 8,
+    FullSyncBucketsRequest = 9,
     FullSyncRequest = 10,
     NoteSaveData = 11,
     InitialSaveDataRequest = 12,
@@ -23,8 +26,16 @@ enum class PacketType : uint8_t
     MumboScore = 16,
     HoneycombCollected = 17,
     MumboTokenCollected = 18,
+    ProgressBits = 19,
     PuppetUpdate = 20,
     PuppetSyncRequest = 21,
+    PuppetUpdateAck = 22,
+    PuppetUpdateCompact = 23,
+    PuppetUpdateCompactAck = 24,
+    PuppetBaselineAck = 25,
+    HoneycombCollectedCompact = 26,
+    MumboTokenCollectedCompact = 27,
+    Compressed = 28,
     PlayerPosition = 50,
     JiggyCollected = 51,
     NoteCollected = 52,
@@ -34,10 +45,130 @@ enum class PacketType : uint8_t
     PlayerInfoRequest = 55,
     PlayerInfoResponse = 56,
     PlayerListUpdate = 57,
+    NoteCollectedCompact = 58,
 
     ReliableAck = 60,
+    ReliableAckBatch = 61,
+    Bundle = 62,
+    Fragment = 63,
+    StateEvent = 64,
 };
 
+// Coalesced reliable ack, sent as ReliableAckBatch or prefixed to a
+// PuppetUpdateAck (an ordinary puppet update carrying the frame's acks).
+// Little-endian like the reliable seq itself:
+//   [u32 highest seq received][u64 mask, bit N set => (highest - 1 - N) received]
+constexpr size_t RELIABLE_ACK_BLOCK_SIZE = 12;
+constexpr uint32_t RELIABLE_ACK_MASK_BITS = 64;
+
+// Several messages packed into one datagram:
+//   [Bundle][u16 LE len][datagram bytes]...
+// where each record is exactly what would otherwise have been sent on its
+// own (type byte, reliable seq if any, payload). Bundles don't nest.
+constexpr size_t BUNDLE_HEADER_SIZE = 1;
+constexpr size_t BUNDLE_RECORD_HEADER_SIZE = 2;
+
+// Reliable messages too big to share a bundle are split into Fragment packets:
+//   [u16 LE message id][u16 LE index][u16 LE count][chunk bytes]
+// Each fragment is its own reliable packet. Concatenating the chunks in index
+// order gives the original message as [type][payload], without a reliable seq.
+constexpr size_t FRAGMENT_HEADER_SIZE = 6;
+constexpr size_t FRAGMENT_CHUNK_SIZE = 1024;
+constexpr size_t FRAGMENT_MAX_MESSAGE_SIZE = 64 * 1024;
+
+// Lobby changes arrive wrapped in a StateEvent:
+//   [u32 LE state seq][type][payload]
+// numbered per session, so after a reconnect the handshake can tell the
+// server how far we got and it replays only what came after.
+constexpr size_t STATE_EVENT_HEADER_SIZE = 4;
+
+// FullSyncRequest can carry what we already have, as one [u64 LE digest] per
+// DigestCategory (lib_state_digest.h). The server skips the categories whose
+// digest matches its own; without the digests it sends everything.
+constexpr size_t STATE_DIGEST_CATEGORIES = 9;
+constexpr size_t STATE_DIGEST_SIZE = 8;
+
+// The set categories (all but the progress blobs) are also kept split into
+// buckets by the item's first half (level slot, map, ...). For each of those
+// whose digest differs, the server replies with StateDigestBuckets
+//   [u8 category][u64 LE digest per bucket]
+// and we ask for just the buckets that differ from ours with
+// FullSyncBucketsRequest [u8 category][u16 LE bucket mask].
+constexpr size_t STATE_DIGEST_BUCKETS = 16;
+
+// Our handshake (big-endian) is [u32 len][lobby][u32 len][password][u32 len][username]
+// [u64 session token to resume, 0 for none][u32 last applied state seq]
+// [u16 PROTOCOL_VERSION][u32 CAPABILITY_* bits we support].
+constexpr uint16_t PROTOCOL_VERSION = 1;
+
+// The server's reply to every handshake it lets in (big-endian):
+//   [u32 our player id][u64 session token][u32 state seq we're up to][u8 1 if our old session was resumed]
+// then [u8 low byte of the capabilities][u16 server protocol version][u32 capabilities], the
+// capabilities being the ones we both have. Servers from before versioning stop after the
+// byte, which then lists what they support; older ones still stop at 17 bytes.
+constexpr size_t HANDSHAKE_ACCEPTED_SIZE = 17;
+constexpr size_t HANDSHAKE_CAPABILITIES_SIZE = 7;
+
+// PuppetUpdateCompact is forwarded, so we can send it instead of PuppetUpdate
+constexpr uint32_t CAPABILITY_COMPACT_PUPPETS = 0x01;
+// ProgressBits is taken, so progress blobs can go up as deltas
+constexpr uint32_t CAPABILITY_PROGRESS_BITS = 0x02;
+// the *CollectedCompact packets are taken and sent to us in place of the full ones
+constexpr uint32_t CAPABILITY_COMPACT_COLLECTIBLES = 0x04;
+// bulk state can go either way as Compressed
+constexpr uint32_t CAPABILITY_COMPRESSION = 0x08;
+
+constexpr uint32_t CLIENT_CAPABILITIES = CAPABILITY_COMPACT_PUPPETS | CAPABILITY_PROGRESS_BITS | CAPABILITY_COMPACT_COLLECTIBLES |
+                                         CAPABILITY_COMPRESSION;
+
+// Note save data and whole progress blobs, in either direction, can go out
+// packed (see lib_bulk_compress.h) when that comes out smaller:
+//   [u8 inner packet type][varint unpacked payload size][packed payload]
+// It's handled exactly as the inner packet would have been, so the server
+// may also wrap it in a StateEvent or fragment it.
+constexpr size_t COMPRESSED_HEADER_MIN_SIZE = 2;
+
+// HoneycombCollectedCompact, MumboTokenCollectedCompact and NoteCollectedCompact
+// carry the same records as the full packets with ids as varints and
+// coordinates as s16 (a record whose coordinates don't fit goes out full):
+//   honeycomb/token  [varint map][varint id][s16 x][s16 y][s16 z]
+//   note             [varint map][varint level][u8 dynamic][varint note index]
+// The server's broadcasts put [varint player id] in front and are big-endian.
+constexpr size_t COLLECTIBLE_COMPACT_MIN_SIZE = 1 + 1 + 3 * 2;
+constexpr size_t NOTE_COMPACT_MIN_SIZE = 1 + 1 + 1 + 1;
+
+// ProgressBits lists the bits newly set in one of the progress blobs
+// (FileProgressFlags, AbilityProgress, HoneycombScore or MumboScore):
+//   [u8 blob packet type][varint first bit index][varint gap to the next bit - 1]...
+// with varints as PacketWriter::WriteVarU32. The server broadcasts it with
+// [u32 BE player id] in front. Progress is only ever ORed together, so bits
+// the game clears aren't sent; each session still starts with the full blob.
+constexpr size_t PROGRESS_BITS_HEADER_SIZE = 1;
+constexpr size_t PROGRESS_BLOB_MAX_SIZE = 64;
+constexpr size_t PROGRESS_BLOB_KINDS = 4;
+
+// PuppetUpdateCompact carries PuppetUpdatePacket quantized (big-endian):
+//   position as s16 world units (the same range as the level geometry),
+//   angles as u16 fractions of a turn, anim timer as a u16 fraction of the
+//   anim, duration in ms, level/map as u8; pitch and roll are two more u16
+//   angles. Together that's a fixed PUPPET_IMAGE_SIZE byte image.
+// On the wire: [u8 PUPPET_SHAPE_* bits][u8 baseline id] then either
+//   a keyframe: PuppetUpdateCompactPacket, then pitch/roll if PUPPET_SHAPE_TILT
+//   a delta (PUPPET_SHAPE_DELTA): [u16 field mask] then each field whose bit
+//     is set, as it sits in the image. Pitch and roll share the last bit.
+// The server answers each keyframe with PuppetBaselineAck [u8 baseline id],
+// and deltas are only ever taken against a keyframe it has acked.
+// PuppetUpdateCompactAck prefixes the ack block the same way PuppetUpdateAck does.
+constexpr size_t PUPPET_COMPACT_HEADER_SIZE = 2;
+constexpr size_t PUPPET_COMPACT_SIZE = 20;
+constexpr size_t PUPPET_COMPACT_TILT_SIZE = 4;
+constexpr size_t PUPPET_IMAGE_SIZE = PUPPET_COMPACT_SIZE + PUPPET_COMPACT_TILT_SIZE;
+constexpr size_t PUPPET_DELTA_MASK_SIZE = 2;
+constexpr uint8_t PUPPET_SHAPE_TILT = 0x01;
+constexpr uint8_t PUPPET_SHAPE_DELTA = 0x02;
+
+// Wire layouts for the structs below live in lib_packet_codec.h.
+
 struct FileProgressFlagsPacket
 {
     std::vector<uint8_t> Flags;
@@ -76,6 +207,15 @@ struct MumboTokenCollectedPacket
     int Z;
 };
 
+// the same records in the compact encoding, see CAPABILITY_COMPACT_COLLECTIBLES
+struct HoneycombCollectedCompactPacket : HoneycombCollectedPacket
+{
+};
+
+struct MumboTokenCollectedCompactPacket : MumboTokenCollectedPacket
+{
+};
+
 struct JiggyPacket
 {
     int JiggyEnumId;
@@ -90,6 +230,10 @@ struct NotePacket
     int NoteIndex;
 };
 
+struct NotePacketCompact : NotePacket
+{
+};
+
 struct NotePacketPos
 {
     int MapId;
@@ -117,6 +261,14 @@ struct LoginPacket
     std::string Username;
 };
 
+struct HandshakeAcceptedPacket
+{
+    uint32_t player_id;
+    uint64_t session_token;
+    uint32_t state_seq;
+    bool resumed;
+};
+
 #pragma pack(push, 1)
 struct PositionPacketRaw
 {
@@ -142,41 +294,95 @@ struct PuppetUpdatePacket
     uint8_t playback_direction;
 };
 
+struct PuppetUpdateCompactPacket
+{
+    int16_t x, y, z;
+    uint16_t yaw;
+    uint16_t anim_duration_ms;
+    uint16_t anim_timer;
+    uint8_t level_id;
+    uint8_t map_id;
+    uint16_t anim_id;
+    uint8_t model_id;
+    uint8_t flags;
+    uint8_t playback_type;
+    uint8_t playback_direction;
+};
+
 struct BroadcastJiggy
 {
+    uint32_t player_id;
     int jiggy_enum_id;
     int collected_value;
-    std::string collector;
 };
 
 struct BroadcastNote
 {
+    uint32_t player_id;
     int map_id;
     int level_id;
-    bool is_dynamic;
+    int is_dynamic;
     int note_index;
-    std::string collector;
+};
+
+struct BroadcastNoteCompact : BroadcastNote
+{
 };
 
 struct BroadcastNotePos
 {
+    uint32_t player_id;
+    int map_id;
+    int x;
+    int y;
+    int z;
+};
+
+struct BroadcastLevelOpened
+{
+    uint32_t player_id;
+    int world_id;
+    int jiggy_cost;
+};
+
+struct BroadcastHoneycomb
+{
+    uint32_t player_id;
+    int map_id;
+    int honeycomb_id;
+    int x;
+    int y;
+    int z;
+};
+
+struct BroadcastMumboToken
+{
+    uint32_t player_id;
     int map_id;
-    int16_t x;
-    int16_t y;
-    int16_t z;
-    std::string collector;
+    int token_id;
+    int x;
+    int y;
+    int z;
+};
+
+struct BroadcastHoneycombCompact : BroadcastHoneycomb
+{
+};
+
+struct BroadcastMumboTokenCompact : BroadcastMumboToken
+{
 };
 
 struct PlayerConnectedBroadcast
 {
-    std::string username;
     uint32_t player_id;
+    std::string username;
 };
 
 struct PlayerDisconnectedBroadcast
 {
-    std::string username;
     uint32_t player_id;
+    std::string username;
 };
 
 struct PlayerInfoRequestPacket
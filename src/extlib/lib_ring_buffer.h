@@ -0,0 +1,237 @@
+#ifndef LIB_RING_BUFFER_H
+#define LIB_RING_BUFFER_H
+
+// =========================================================================== //
+// Fixed-size lock-free ring buffers used to hand data between threads
+// without taking a lock or allocating on the hot path.
+// =========================================================================== //
+
+#include <atomic>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#ifndef RING_CACHE_LINE_SIZE
+#define RING_CACHE_LINE_SIZE 64
+#endif
+
+// Single-producer / single-consumer ring.
+// One thread may call TryPush, one (other) thread may call TryPop.
+// Capacity must be a power of two. Slots are preallocated and reused, so
+// element types that own heap memory (strings/vectors) keep their capacity
+// between uses.
+template <typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+
+    alignas(RING_CACHE_LINE_SIZE) std::atomic<size_t> m_head{0}; // next slot to write (producer)
+    alignas(RING_CACHE_LINE_SIZE) std::atomic<size_t> m_tail{0}; // next slot to read (consumer)
+    alignas(RING_CACHE_LINE_SIZE) std::array<T, Capacity> m_slots;
+
+public:
+    SpscRing() = default;
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    bool TryPush(T &&value)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= Capacity)
+        {
+            return false;
+        }
+
+        m_slots[head & MASK] = std::move(value);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T &out)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        out = std::move(m_slots[tail & MASK]);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+    }
+
+    size_t Size() const
+    {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t GetCapacity()
+    {
+        return Capacity;
+    }
+};
+
+// Multi-producer / single-consumer ring of variable-length records.
+// Any number of threads may claim and publish, one thread may pop.
+// Producers claim space by advancing m_head with a CAS, fill it in place,
+// then publish by stamping the record's header with its position; the
+// consumer owns m_tail outright and stops at the first unstamped record.
+// A record that would run past the end is preceded by a skip record
+// padding out to it, so every record is contiguous. A producer that stalls
+// between claiming and publishing holds up the consumer at that record but
+// never blocks the other producers. Capacity is in bytes and must be a
+// power of two.
+template <size_t Capacity>
+class MpscRecordRing
+{
+    static_assert(Capacity >= 64 && (Capacity & (Capacity - 1)) == 0, "MpscRecordRing capacity must be a power of two");
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+
+    // in front of every record; records start on RECORD_ALIGN boundaries
+    struct RecordHeader
+    {
+        uint64_t stamp; // position + 1 once published, accessed atomically
+        uint32_t size;
+        uint32_t skip;
+    };
+
+    static constexpr size_t RECORD_ALIGN = sizeof(RecordHeader);
+
+    static constexpr size_t Footprint(size_t size)
+    {
+        return (sizeof(RecordHeader) + size + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+    }
+
+    alignas(RING_CACHE_LINE_SIZE) std::atomic<size_t> m_head{0}; // next byte to claim (producers)
+    alignas(RING_CACHE_LINE_SIZE) std::atomic<size_t> m_tail{0}; // next record to read (consumer)
+    alignas(RING_CACHE_LINE_SIZE) std::array<uint8_t, Capacity> m_bytes{};
+
+    RecordHeader *At(size_t position)
+    {
+        return reinterpret_cast<RecordHeader *>(m_bytes.data() + (position & MASK));
+    }
+
+public:
+    // largest record that can ever be claimed
+    static constexpr size_t MAX_RECORD_SIZE = Capacity / 2 - sizeof(RecordHeader);
+
+    MpscRecordRing() = default;
+    MpscRecordRing(const MpscRecordRing &) = delete;
+    MpscRecordRing &operator=(const MpscRecordRing &) = delete;
+
+    // Claims size bytes for the caller to fill in place, or null if there
+    // isn't room. Every claimed record has to be handed to Publish with its
+    // ticket, or the consumer stops at it.
+    uint8_t *TryClaim(size_t size, size_t &ticket)
+    {
+        if (size > MAX_RECORD_SIZE)
+        {
+            return nullptr;
+        }
+
+        const size_t need = Footprint(size);
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t pad;
+
+        for (;;)
+        {
+            const size_t untilEnd = Capacity - (head & MASK);
+            pad = untilEnd < need ? untilEnd : 0;
+
+            if (head + pad + need - m_tail.load(std::memory_order_acquire) > Capacity)
+            {
+                return nullptr;
+            }
+
+            if (m_head.compare_exchange_weak(head, head + pad + need, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+
+        if (pad != 0)
+        {
+            RecordHeader *filler = At(head);
+            filler->size = (uint32_t)(pad - sizeof(RecordHeader));
+            filler->skip = 1;
+            std::atomic_ref<uint64_t>(filler->stamp).store(head + 1, std::memory_order_release);
+        }
+
+        ticket = head + pad;
+        RecordHeader *record = At(ticket);
+        record->size = (uint32_t)size;
+        record->skip = 0;
+        return reinterpret_cast<uint8_t *>(record + 1);
+    }
+
+    void Publish(size_t ticket)
+    {
+        std::atomic_ref<uint64_t>(At(ticket)->stamp).store(ticket + 1, std::memory_order_release);
+    }
+
+    // Hands the oldest published record to fn(data, size), which returns
+    // true to consume it or false to leave it for next time. False if
+    // there's nothing to hand over or fn left it.
+    template <typename Fn>
+    bool TryPop(Fn &&fn)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            RecordHeader *record = At(tail);
+            if (std::atomic_ref<uint64_t>(record->stamp).load(std::memory_order_acquire) != tail + 1)
+            {
+                return false;
+            }
+
+            const bool skip = record->skip != 0;
+            const size_t size = record->size;
+            if (!skip && !fn(reinterpret_cast<const uint8_t *>(record + 1), size))
+            {
+                return false;
+            }
+
+            // clear every spot a later record's header could land on, so
+            // leftover bytes are never mistaken for a stamp
+            const size_t footprint = Footprint(size);
+            for (size_t offset = 0; offset < footprint; offset += RECORD_ALIGN)
+            {
+                std::atomic_ref<uint64_t>(At(tail + offset)->stamp).store(0, std::memory_order_relaxed);
+            }
+
+            tail += footprint;
+            m_tail.store(tail, std::memory_order_release);
+
+            if (!skip)
+            {
+                return true;
+            }
+        }
+    }
+
+    // claimed records count even before they're published, so from another
+    // thread this is only a hint
+    bool Empty() const
+    {
+        return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t GetCapacity()
+    {
+        return Capacity;
+    }
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef LIB_STATE_DIGEST_H
+#define LIB_STATE_DIGEST_H
+
+// =========================================================================== //
+// The lobby's collection and progress state as the game has applied it,
+// kept as one order-independent hash per category so a FullSyncRequest can
+// tell the server which categories we already have. The game reads it back
+// out of its save and collection state (see native_state_digest_begin): a
+// digest that claims something the game doesn't have makes the server skip
+// it, so it can't come from what went over the wire.
+//
+// Each category is a set of (a, b) pairs:
+//   notes                    (level slot, bit in that level's note save data)
+//   progress blobs           (0, bit)
+//   jiggies                  (jiggy enum id, collected value)
+//   honeycombs/mumbo tokens  (map id, id), and (0, bit) for each score bit
+//   opened levels            (world id, 0), including those opened by file
+//                            progress flags 0x31 (MM) to 0x39 (CCW)
+// hashed as the wrapping sum of StateDigestItem over the set. The server
+// hashes its lobby the same way, so the sets only have to match, not the
+// order things arrived in. Each category is also summed per bucket of
+// StateDigestBucket(a), so a set that differs can be narrowed down to the
+// buckets that do without sending the rest.
+// =========================================================================== //
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_set>
+
+#include "lib_packets.h"
+
+enum class DigestCategory : uint8_t
+{
+    Notes,
+    FileProgress,
+    AbilityProgress,
+    HoneycombScore,
+    MumboScore,
+    Jiggies,
+    Honeycombs,
+    MumboTokens,
+    OpenedLevels,
+};
+
+static_assert((size_t)DigestCategory::OpenedLevels + 1 == STATE_DIGEST_CATEGORIES, "one digest per category");
+
+inline size_t StateDigestBucket(int32_t a)
+{
+    return (uint32_t)a % STATE_DIGEST_BUCKETS;
+}
+
+// splitmix64 of the pair packed into 64 bits
+inline uint64_t StateDigestItem(int32_t a, int32_t b)
+{
+    uint64_t z = ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+    z += 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+class LobbyStateDigest
+{
+private:
+    std::array<std::unordered_set<uint64_t>, STATE_DIGEST_CATEGORIES> m_items;
+    std::array<uint64_t, STATE_DIGEST_CATEGORIES> m_digests{};
+    std::array<std::array<uint64_t, STATE_DIGEST_BUCKETS>, STATE_DIGEST_CATEGORIES> m_buckets{};
+
+public:
+    void Add(DigestCategory category, int32_t a, int32_t b)
+    {
+        size_t index = (size_t)category;
+        uint64_t key = ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+
+        if (m_items[index].insert(key).second)
+        {
+            uint64_t hash = StateDigestItem(a, b);
+            m_digests[index] += hash;
+            m_buckets[index][StateDigestBucket(a)] += hash;
+        }
+    }
+
+    void AddBits(DigestCategory category, int32_t a, const uint8_t *bytes, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            for (uint8_t bits = bytes[i]; bits != 0; bits &= bits - 1)
+            {
+                Add(category, a, (int32_t)(i * 8) + std::countr_zero(bits));
+            }
+        }
+    }
+
+    // a progress blob also stands for the items the server derives from it
+    void AddProgressBlob(PacketType type, const uint8_t *bytes, size_t size)
+    {
+        switch (type)
+        {
+        case PacketType::FileProgressFlags:
+        {
+            AddBits(DigestCategory::FileProgress, 0, bytes, size);
+
+            const int32_t FILEPROG_31_MM_OPEN = 0x31;
+            const int32_t FILEPROG_39_CCW_OPEN = 0x39;
+            for (int32_t flag = FILEPROG_31_MM_OPEN; flag <= FILEPROG_39_CCW_OPEN; flag++)
+            {
+                if ((size_t)(flag / 8) < size && (bytes[flag / 8] & (1 << (flag % 8))))
+                {
+                    Add(DigestCategory::OpenedLevels, flag - FILEPROG_31_MM_OPEN + 1, 0);
+                }
+            }
+            break;
+        }
+        case PacketType::AbilityProgress:
+            AddBits(DigestCategory::AbilityProgress, 0, bytes, size);
+            break;
+        case PacketType::HoneycombScore:
+            AddBits(DigestCategory::HoneycombScore, 0, bytes, size);
+            AddBits(DigestCategory::Honeycombs, 0, bytes, size);
+            break;
+        case PacketType::MumboScore:
+            AddBits(DigestCategory::MumboScore, 0, bytes, size);
+            AddBits(DigestCategory::MumboTokens, 0, bytes, size);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void Clear()
+    {
+        for (std::unordered_set<uint64_t> &items : m_items)
+        {
+            items.clear();
+        }
+        m_digests.fill(0);
+        for (std::array<uint64_t, STATE_DIGEST_BUCKETS> &buckets : m_buckets)
+        {
+            buckets.fill(0);
+        }
+    }
+
+    const std::array<uint64_t, STATE_DIGEST_CATEGORIES> &Digests() const { return m_digests; }
+
+    const std::array<uint64_t, STATE_DIGEST_BUCKETS> &Buckets(DigestCategory category) const
+    {
+        return m_buckets[(size_t)category];
+    }
+};
+
+#endif
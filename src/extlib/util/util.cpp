@@ -1,11 +1,19 @@
 #include "util/util.h"
 #include "lib_recomp.hpp"
 #include "lib_message_queue.h"
-#include "lib_net.h"
 #include "lib_packets.h"
 #include <algorithm>
 
-extern uint8_t PacketTypeToMessageType(PacketType packetType);
+// UTIL_SWIZZLE_SCALAR sticks to the plain word loop whatever the target has,
+// so bench/ can time it next to the vector paths
+#if defined(UTIL_SWIZZLE_SCALAR)
+#elif defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define UTIL_SWIZZLE_SSSE3 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define UTIL_SWIZZLE_NEON 1
+#endif
 
 namespace util
 {
@@ -32,8 +40,48 @@ namespace util
                ((uint32_t)ptr[2] << 8) | ((uint32_t)ptr[3]);
     }
 
+    // Copies size bytes into guest memory at addr. rdram holds each aligned
+    // 32-bit word in host order, so past the first word boundary every four
+    // guest bytes go in as one byte-swapped store, sixteen at a time where
+    // there's a vector byte shuffle
+    static void WriteGuestBytes(uint8_t *rdram, int32_t addr, const uint8_t *src, size_t size)
+    {
+        size_t i = 0;
+        for (; i < size && ((addr + i) & 3) != 0; i++)
+        {
+            MEM_B(i, addr) = (int8_t)src[i];
+        }
+
+        uint8_t *dst = TO_PTR(uint8_t, addr + (int32_t)i);
+
+#if defined(UTIL_SWIZZLE_SSSE3)
+        const __m128i swap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        for (; size - i >= 16; i += 16, dst += 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+            _mm_storeu_si128((__m128i *)dst, _mm_shuffle_epi8(v, swap));
+        }
+#elif defined(UTIL_SWIZZLE_NEON)
+        for (; size - i >= 16; i += 16, dst += 16)
+        {
+            vst1q_u8(dst, vrev32q_u8(vld1q_u8(src + i)));
+        }
+#endif
+
+        for (; size - i >= 4; i += 4, dst += 4)
+        {
+            uint32_t word = SwapUint32(src + i);
+            memcpy(dst, &word, sizeof(word));
+        }
+
+        for (; i < size; i++)
+        {
+            MEM_B(i, addr) = (int8_t)src[i];
+        }
+    }
+
     template <typename PtrType>
-    void SerializeGameMessageToMemory(uint8_t *rdram, const GameMessage &msg, PtrType buffer_ptr)
+    void SerializeGameMessageToMemory(uint8_t *rdram, const GameMessageHeader &msg, const uint8_t *data, PtrType buffer_ptr)
     {
         MEM_B(0, buffer_ptr) = msg.type;
         MEM_W(4, buffer_ptr) = msg.playerId;
@@ -52,13 +100,12 @@ namespace util
 
         MEM_H(52, buffer_ptr) = msg.dataSize;
 
-        for (size_t i = 0; i < MAX_MESSAGE_DATA_SIZE; i++)
-        {
-            MEM_B(54 + i, buffer_ptr) = msg.data[i];
-        }
+        // then the payload and a terminator, so text can be read in place
+        WriteGuestBytes(rdram, buffer_ptr + (PtrType)GUEST_GAME_MESSAGE_HEADER_SIZE, data, msg.dataSize);
+        MEM_B(GUEST_GAME_MESSAGE_HEADER_SIZE + msg.dataSize, buffer_ptr) = 0;
     }
 
-    template void SerializeGameMessageToMemory<PTR(GameMessage)>(uint8_t *, const GameMessage &, PTR(GameMessage));
+    template void SerializeGameMessageToMemory<PTR(GameMessage)>(uint8_t *, const GameMessageHeader &, const uint8_t *, PTR(GameMessage));
 
     template <typename PtrType>
     std::vector<uint8_t> ReadByteBufferFromMemory(uint8_t *rdram, PtrType bufPtr, int size)
@@ -75,57 +122,29 @@ namespace util
     template std::vector<uint8_t> ReadByteBufferFromMemory<PTR(uint8_t)>(uint8_t *, PTR(uint8_t), int);
 
     template <typename PtrType>
-    void ReadFloatsFromMemory(uint8_t *rdram, PtrType posPtr, float *outFloats, int count)
+    void ReadByteBufferFromMemory(uint8_t *rdram, PtrType bufPtr, int size, std::vector<uint8_t> &out)
     {
-        for (int i = 0; i < count; i++)
+        out.resize((size_t)size);
+        for (int i = 0; i < size; i++)
         {
-            uint32_t bits = MEM_W(i * 4, posPtr);
-            outFloats[i] = BitsToFloat(bits);
+            out[(size_t)i] = MEM_B(i, bufPtr);
         }
     }
 
-    template void ReadFloatsFromMemory<PTR(float)>(uint8_t *, PTR(float), float *, int);
+    template void ReadByteBufferFromMemory<PTR(uint8_t)>(uint8_t *, PTR(uint8_t), int, std::vector<uint8_t> &);
 
-    void ConvertNetEventToGameMessage(const NetEvent &evt, GameMessage &msg)
+    template <typename PtrType>
+    void ReadFloatsFromMemory(uint8_t *rdram, PtrType posPtr, float *outFloats, int count)
     {
-        memset(&msg, 0, sizeof(GameMessage));
-
-        msg.type = ::PacketTypeToMessageType(evt.type);
-        msg.playerId = evt.playerId;
-
-        if (!evt.textData.empty())
+        for (int i = 0; i < count; i++)
         {
-            size_t copySize = std::min(evt.textData.size(), MAX_MESSAGE_DATA_SIZE - 1);
-            memcpy(msg.data, evt.textData.c_str(), copySize);
-            msg.data[copySize] = '\0';
-            msg.dataSize = (uint16_t)(copySize + 1);
+            uint32_t bits = MEM_W(i * 4, posPtr);
+            outFloats[i] = BitsToFloat(bits);
         }
-
-        if (evt.intData.size() > 0)
-            msg.param1 = evt.intData[0];
-        if (evt.intData.size() > 1)
-            msg.param2 = evt.intData[1];
-        if (evt.intData.size() > 2)
-            msg.param3 = evt.intData[2];
-        if (evt.intData.size() > 3)
-            msg.param4 = evt.intData[3];
-        if (evt.intData.size() > 4)
-            msg.param5 = evt.intData[4];
-        if (evt.intData.size() > 5)
-            msg.param6 = evt.intData[5];
-
-        if (evt.floatData.size() > 0)
-            msg.paramF1 = evt.floatData[0];
-        if (evt.floatData.size() > 1)
-            msg.paramF2 = evt.floatData[1];
-        if (evt.floatData.size() > 2)
-            msg.paramF3 = evt.floatData[2];
-        if (evt.floatData.size() > 3)
-            msg.paramF4 = evt.floatData[3];
-        if (evt.floatData.size() > 4)
-            msg.paramF5 = evt.floatData[4];
     }
 
+    template void ReadFloatsFromMemory<PTR(float)>(uint8_t *, PTR(float), float *, int);
+
     void DeserializePuppetData(const void *puppet_data, PuppetUpdatePacket &pak)
     {
         const uint8_t *byte_ptr = (const uint8_t *)puppet_data;
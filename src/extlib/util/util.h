@@ -10,8 +10,7 @@
 #include <vector>
 
 // Forward declarations
-struct GameMessage;
-struct NetEvent;
+struct GameMessageHeader;
 struct PuppetUpdatePacket;
 
 namespace util
@@ -36,15 +35,17 @@ namespace util
     }
 
     template <typename PtrType>
-    void SerializeGameMessageToMemory(uint8_t *rdram, const GameMessage &msg, PtrType buffer_ptr);
+    void SerializeGameMessageToMemory(uint8_t *rdram, const GameMessageHeader &msg, const uint8_t *data, PtrType buffer_ptr);
 
     template <typename PtrType>
     std::vector<uint8_t> ReadByteBufferFromMemory(uint8_t *rdram, PtrType bufPtr, int size);
 
+    // same, but reuses out's storage so repeated reads don't allocate
     template <typename PtrType>
-    void ReadFloatsFromMemory(uint8_t *rdram, PtrType posPtr, float *outFloats, int count);
+    void ReadByteBufferFromMemory(uint8_t *rdram, PtrType bufPtr, int size, std::vector<uint8_t> &out);
 
-    void ConvertNetEventToGameMessage(const NetEvent &evt, GameMessage &msg);
+    template <typename PtrType>
+    void ReadFloatsFromMemory(uint8_t *rdram, PtrType posPtr, float *outFloats, int count);
 
     void DeserializePuppetData(const void *puppet_data, PuppetUpdatePacket &pak);
 }
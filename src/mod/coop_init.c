@@ -39,6 +39,10 @@ static enum map_e s_last_map = 0;
 static int s_frames_in_current_map = 0;
 static const s32 MIN_FRAMES_BEFORE_NETWORK = 10;
 
+// queued network messages handled per frame, fetched in one native call
+#define MAX_MESSAGES_PER_FRAME 100
+#define MESSAGE_BUFFER_SIZE (16 * 1024)
+
 static int is_real_map(enum map_e map)
 {
     return (map > 0 && map <= 0x90);
@@ -148,14 +152,14 @@ void mainLoop(void)
             return;
         }
 
-        static GameMessage msg;
-        int messagesProcessed = 0;
-        const int MAX_MESSAGES_PER_FRAME = 100;
+        static u32 messageBuffer[MESSAGE_BUFFER_SIZE / 4];
+        int count = poll_queue_messages(messageBuffer, MESSAGE_BUFFER_SIZE, MAX_MESSAGES_PER_FRAME);
 
-        while (messagesProcessed < MAX_MESSAGES_PER_FRAME && poll_queue_message(&msg))
+        const GameMessage *msg = (const GameMessage *)messageBuffer;
+        for (int i = 0; i < count; i++)
         {
-            process_queue_message(&msg);
-            messagesProcessed++;
+            process_queue_message(msg);
+            msg = message_queue_next(msg);
         }
     }
 }
@@ -65,12 +65,12 @@ void handle_player_list_update(const void *vmsg)
 {
     const GameMessage *msg = (const GameMessage *)vmsg;
     u32 player_id = (u32)msg->playerId;
-    char username[MAX_MESSAGE_DATA_SIZE + 1];
+    char username[MAX_MESSAGE_TEXT_SIZE + 1];
     int n = (int)msg->dataSize;
     if (n < 0)
         n = 0;
-    if (n > MAX_MESSAGE_DATA_SIZE)
-        n = MAX_MESSAGE_DATA_SIZE;
+    if (n > MAX_MESSAGE_TEXT_SIZE)
+        n = MAX_MESSAGE_TEXT_SIZE;
 
     memcpy(username, msg->data, (size_t)n);
     username[n] = '\0';
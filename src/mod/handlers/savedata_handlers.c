@@ -8,6 +8,7 @@
 #include "bkrecomp_api.h"
 #include "network/coop_network.h"
 #include "blob/blob_sender.h"
+#include "../sync/sync.h"
 
 typedef struct ApplyFpCtx
 {
@@ -258,7 +259,9 @@ void handle_note_save_data(const void *vmsg)
 {
     const GameMessage *msg = (const GameMessage *)vmsg;
     int levelSlot = msg->param1;
-    int size = (int)msg->dataSize;
+    int size = msg->param2;
+    if (size > (int)msg->dataSize)
+        size = (int)msg->dataSize;
     int levelId = note_level_slot_to_level_id(levelSlot);
 
     if (levelId != 0 && size == 32 && bkrecomp_note_saving_active())
@@ -280,3 +283,99 @@ void handle_note_save_data(const void *vmsg)
         }
     }
 }
+
+extern void ability_getSizeAndPtr(s32 *sizeOut, void **ptrOut);
+extern void honeycombscore_getSizeAndPtr(s32 *sizeOut, void **ptrOut);
+extern void mumboscore_getSizeAndPtr(s32 *sizeOut, void **ptrOut);
+
+static void add_blob_to_state_digest(int category, void (*getSizeAndPtr)(s32 *, void **))
+{
+    void *ptr = NULL;
+    s32 size = 0;
+    getSizeAndPtr(&size, &ptr);
+    if (ptr != NULL && size > 0)
+    {
+        native_state_digest_add_blob(category, ptr, size);
+    }
+}
+
+// The extlib is about to ask the server for a full sync and needs to say
+// what we already have. Hashes what the game has actually applied, read
+// back out of the save rather than from what came over the network: a
+// category we claim but don't have would be skipped by the server
+void handle_state_digest_request(const void *vmsg)
+{
+    (void)vmsg;
+
+    extern void fileProgressFlag_getSizeAndPtr(s32 * size, u8 * *addr);
+    extern int jiggyscore_isCollected(int levelid, int jiggy_id);
+    extern bool honeycombscore_get(enum honeycomb_e indx);
+    extern bool mumboscore_get(enum mumbotoken_e indx);
+
+    native_state_digest_begin();
+
+    // same slots and bits as NoteSaveData, as far as note saving has stored them
+    if (bkrecomp_note_saving_active())
+    {
+        for (int levelSlot = 0; levelSlot < 9; levelSlot++)
+        {
+            int levelId = note_level_slot_to_level_id(levelSlot);
+            u8 bits[32] = {0};
+
+            for (int noteIndex = 0; noteIndex < 256; noteIndex++)
+            {
+                if (bkrecomp_is_note_collected(0, (enum level_e)levelId, (u8)noteIndex))
+                {
+                    bits[noteIndex / 8] |= (u8)(1 << (noteIndex % 8));
+                }
+            }
+
+            native_state_digest_add_bits(DIGEST_NOTES, levelSlot, bits, sizeof(bits));
+        }
+    }
+
+    {
+        u8 *ptr = NULL;
+        s32 size = 0;
+        fileProgressFlag_getSizeAndPtr(&size, &ptr);
+        if (ptr != NULL && size > 0)
+        {
+            native_state_digest_add_blob(DIGEST_FILE_PROGRESS, ptr, size);
+        }
+    }
+
+    add_blob_to_state_digest(DIGEST_ABILITY_PROGRESS, ability_getSizeAndPtr);
+    add_blob_to_state_digest(DIGEST_HONEYCOMB_SCORE, honeycombscore_getSizeAndPtr);
+    add_blob_to_state_digest(DIGEST_MUMBO_SCORE, mumboscore_getSizeAndPtr);
+
+    // the collectibles we know the ids of, if the game still has them
+    // (a reloaded save keeps g_collection_state but not the collectibles)
+    for (int i = 0; i < g_collection_state.jiggy_count; i++)
+    {
+        const JiggyIdentifier *jiggy = &g_collection_state.collected_jiggies[i];
+        if (jiggyscore_isCollected(jiggy->level_id, jiggy->jiggy_id))
+        {
+            native_state_digest_add_item(DIGEST_JIGGIES, jiggy->level_id, jiggy->jiggy_id);
+        }
+    }
+
+    for (int i = 0; i < g_collection_state.honeycomb_count; i++)
+    {
+        const ActorCollectibleIdentifier *honeycomb = &g_collection_state.collected_honeycombs[i];
+        if (honeycombscore_get((enum honeycomb_e)honeycomb->actor_id))
+        {
+            native_state_digest_add_item(DIGEST_HONEYCOMBS, honeycomb->map_id, honeycomb->actor_id);
+        }
+    }
+
+    for (int i = 0; i < g_collection_state.token_count; i++)
+    {
+        const ActorCollectibleIdentifier *token = &g_collection_state.collected_tokens[i];
+        if (mumboscore_get((enum mumbotoken_e)token->actor_id))
+        {
+            native_state_digest_add_item(DIGEST_MUMBO_TOKENS, token->map_id, token->actor_id);
+        }
+    }
+
+    native_state_digest_send();
+}
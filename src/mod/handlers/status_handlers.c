@@ -12,34 +12,43 @@ extern void player_list_ui_show(void);
 void handle_connection_status(const void *vmsg)
 {
     const GameMessage *msg = (const GameMessage *)vmsg;
-    char statusBuf[MAX_MESSAGE_DATA_SIZE + 1];
+    char statusBuf[MAX_MESSAGE_TEXT_SIZE + 1];
     int n = (int)msg->dataSize;
     if (n < 0)
         n = 0;
-    if (n > MAX_MESSAGE_DATA_SIZE)
-        n = MAX_MESSAGE_DATA_SIZE;
+    if (n > MAX_MESSAGE_TEXT_SIZE)
+        n = MAX_MESSAGE_TEXT_SIZE;
 
     memcpy(statusBuf, msg->data, (size_t)n);
     statusBuf[n] = '\0';
 
-    if (statusBuf[0] != '\0')
+    switch (msg->param1)
     {
-        toast_show_immediate_custom("Connected!", TOAST_DEFAULT_DURATION,
+    case CONN_STATE_CONNECTED:
+        toast_show_immediate_custom(statusBuf[0] != '\0' ? statusBuf : "Connected!", TOAST_DEFAULT_DURATION,
                                     TOAST_POS_TOP_RIGHT, TOAST_SIZE_MEDIUM, TOAST_STYLE_SUCCESS);
 
         player_list_ui_show();
+        break;
+
+    case CONN_STATE_RESUMING:
+        toast_warning(statusBuf);
+        break;
+
+    default:
+        break;
     }
 }
 
 void handle_connection_error(const void *vmsg)
 {
     const GameMessage *msg = (const GameMessage *)vmsg;
-    char errBuf[MAX_MESSAGE_DATA_SIZE + 1];
+    char errBuf[MAX_MESSAGE_TEXT_SIZE + 1];
     int n = (int)msg->dataSize;
     if (n < 0)
         n = 0;
-    if (n > MAX_MESSAGE_DATA_SIZE)
-        n = MAX_MESSAGE_DATA_SIZE;
+    if (n > MAX_MESSAGE_TEXT_SIZE)
+        n = MAX_MESSAGE_TEXT_SIZE;
 
     memcpy(errBuf, msg->data, (size_t)n);
     errBuf[n] = '\0';
@@ -5,18 +5,16 @@
 #include "handlers/player_handlers.h"
 #include "handlers/status_handlers.h"
 
-RECOMP_IMPORT(".", int net_msg_poll(void *buffer));
+RECOMP_IMPORT(".", int net_msg_poll_batch(void *buffer, int buffer_size, int max_count));
 
-static GameMessage s_poll_buf;
-
-int poll_queue_message(GameMessage *out_message)
+int poll_queue_messages(void *buffer, int buffer_size, int max_count)
 {
-    if (!out_message)
+    if (!buffer || buffer_size <= 0 || max_count <= 0)
     {
         return 0;
     }
 
-    return net_msg_poll(out_message);
+    return net_msg_poll_batch(buffer, buffer_size, max_count);
 }
 
 void process_queue_message(const GameMessage *msg)
@@ -58,6 +56,10 @@ void process_queue_message(const GameMessage *msg)
         handle_note_save_data(msg);
         break;
 
+    case MSG_STATE_DIGEST_REQUEST:
+        handle_state_digest_request(msg);
+        break;
+
     case MSG_FILE_PROGRESS_FLAGS:
         handle_file_progress_flags(msg);
         break;
@@ -26,10 +26,29 @@ typedef enum
     MSG_PLAYER_LIST_UPDATE = 19,
     MSG_CONSOLE_KEY = 20,
     MSG_CONSOLE_TOGGLE = 21,
+    MSG_STATE_DIGEST_REQUEST = 22,
 } MessageType;
 
-#define MAX_MESSAGE_DATA_SIZE 256
+// param1 of MSG_CONNECTION_STATUS, mirrors ConnectionState in the extlib.
+// playerId is ours once connected, param2 the connect latency in ms
+typedef enum
+{
+    CONN_STATE_IDLE = 0,
+    CONN_STATE_RESOLVING = 1,
+    CONN_STATE_HANDSHAKING = 2,
+    CONN_STATE_CONNECTED = 3,
+    CONN_STATE_RESUMING = 4,
+    CONN_STATE_FAILED = 5,
+} ConnectionState;
+
+// longest text (a username or status line) handlers copy out of a message
+#define MAX_MESSAGE_TEXT_SIZE 256
+
+// bytes of GameMessage before data
+#define GAME_MESSAGE_HEADER_SIZE 54
 
+// One message as net_msg_poll_batch packs them: the fields, then dataSize
+// bytes of data and a NUL, padded to a word before the next message starts
 typedef struct
 {
     unsigned char type;
@@ -46,10 +65,18 @@ typedef struct
     float paramF4;
     float paramF5;
     unsigned short dataSize;
-    unsigned char data[MAX_MESSAGE_DATA_SIZE];
+    unsigned char data[];
 } GameMessage;
 
-int poll_queue_message(GameMessage *out_message);
+// packs up to max_count queued messages into buffer (word aligned,
+// buffer_size bytes), returns how many. walk them with message_queue_next
+int poll_queue_messages(void *buffer, int buffer_size, int max_count);
+
+static inline const GameMessage *message_queue_next(const GameMessage *msg)
+{
+    unsigned int size = (GAME_MESSAGE_HEADER_SIZE + msg->dataSize + 1 + 3) & ~3u;
+    return (const GameMessage *)((const unsigned char *)msg + size);
+}
 
 static inline const char *message_queue_get_string(const GameMessage *msg)
 {
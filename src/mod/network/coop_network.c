@@ -96,6 +96,11 @@ void coop_try_connect_if_ready(enum map_e current_map, int frames_in_map)
         password = "";
     }
 
+    {
+        char *threaded = recomp_get_config_string("network_thread");
+        native_set_network_threaded(threaded != NULL && threaded[0] == '1');
+    }
+
     toast_info("Co-op: connecting...");
     console_log_info("Co-op: connecting...");
     native_connect_to_server(host, username, lobby_name, password);
@@ -49,6 +49,8 @@ typedef struct
     int jinjo_count;
 } CollectionState;
 
+extern CollectionState g_collection_state;
+
 void sync_init(void);
 void sync_clear(void);
 